@@ -345,4 +345,30 @@ namespace ART_unsynchronized {
             }
         }
     }
+
+    void N::getChildrenReverse(const N *node, uint8_t start, uint8_t end, std::tuple<uint8_t, N *> children[],
+                               uint32_t &childrenCount) {
+        switch (node->getType()) {
+            case NTypes::N4: {
+                auto n = static_cast<const N4 *>(node);
+                n->getChildrenReverse(start, end, children, childrenCount);
+                return;
+            }
+            case NTypes::N16: {
+                auto n = static_cast<const N16 *>(node);
+                n->getChildrenReverse(start, end, children, childrenCount);
+                return;
+            }
+            case NTypes::N48: {
+                auto n = static_cast<const N48 *>(node);
+                n->getChildrenReverse(start, end, children, childrenCount);
+                return;
+            }
+            case NTypes::N256: {
+                auto n = static_cast<const N256 *>(node);
+                n->getChildrenReverse(start, end, children, childrenCount);
+                return;
+            }
+        }
+    }
 }
\ No newline at end of file
@@ -11,7 +11,8 @@
 #include <string.h>
 #include "../Key.h"
 #include "../Epoche.h"
-#include <tbb/tbb.h>
+#include "../NodeAllocator.h"
+#include "../NodeScan.h"
 
 using namespace ART;
 
@@ -61,6 +62,14 @@ namespace ART_unsynchronized {
 
     public:
 
+        static void *operator new(std::size_t size) {
+            return NodeAllocator::allocate(size);
+        }
+
+        static void operator delete(void *p) {
+            NodeAllocator::deallocate(p);
+        }
+
         NTypes getType() const;
 
         uint32_t getCount() const;
@@ -107,6 +116,10 @@ namespace ART_unsynchronized {
 
         static void getChildren(const N *node, uint8_t start, uint8_t end, std::tuple<uint8_t, N *> children[],
                                 uint32_t &childrenCount);
+
+        // like getChildren, but in descending keyslice order
+        static void getChildrenReverse(const N *node, uint8_t start, uint8_t end, std::tuple<uint8_t, N *> children[],
+                                       uint32_t &childrenCount);
     };
 
     class N4 : public N {
@@ -139,6 +152,9 @@ namespace ART_unsynchronized {
 
         void getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
+
+        void getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                uint32_t &childrenCount) const;
     };
 
     class N16 : public N {
@@ -191,6 +207,9 @@ namespace ART_unsynchronized {
 
         void getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
+
+        void getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                uint32_t &childrenCount) const;
     };
 
     class N48 : public N {
@@ -222,6 +241,9 @@ namespace ART_unsynchronized {
 
         void getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
+
+        void getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                uint32_t &childrenCount) const;
     };
 
     class N256 : public N {
@@ -250,6 +272,9 @@ namespace ART_unsynchronized {
 
         void getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
+
+        void getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                uint32_t &childrenCount) const;
     };
 }
 #endif //ARTVERSION1_ARTVERSION_H
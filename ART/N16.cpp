@@ -97,17 +97,25 @@ namespace ART_unsynchronized {
     void N16::getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                           uint32_t &childrenCount) const {
         childrenCount = 0;
-        auto startPos = getChildPos(start);
-        auto endPos = getChildPos(end);
-        if (startPos == nullptr) {
-            startPos = this->children;
-        }
-        if (endPos == nullptr) {
-            endPos = this->children + (count - 1);
+        // start and end don't have to be keys of the node
+        for (int i = 0; i < count; ++i) {
+            uint8_t key = flipSign(keys[i]);
+            if (key >= start && key <= end) {
+                children[childrenCount] = std::make_tuple(key, this->children[i]);
+                childrenCount++;
+            }
         }
-        for (auto p = startPos; p <= endPos; ++p) {
-            children[childrenCount] = std::make_tuple(flipSign(keys[p - this->children]), *p);
-            childrenCount++;
+    }
+
+    void N16::getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                 uint32_t &childrenCount) const {
+        childrenCount = 0;
+        for (int i = count - 1; i >= 0; --i) {
+            uint8_t key = flipSign(keys[i]);
+            if (key >= start && key <= end) {
+                children[childrenCount] = std::make_tuple(key, this->children[i]);
+                childrenCount++;
+            }
         }
     }
 }
\ No newline at end of file
@@ -5,12 +5,11 @@
 namespace ART_unsynchronized {
 
     void N256::deleteChildren() {
-        for (uint64_t i = 0; i < 256; ++i) {
-            if (children[i] != nullptr) {
-                N::deleteChildren(children[i]);
-                N::deleteNode(children[i]);
-            }
-        }
+        NodeScan::forEachChild(children, 0, 255, [&](unsigned i) {
+            N::deleteChildren(children[i]);
+            N::deleteNode(children[i]);
+            return true;
+        });
     }
 
     bool N256::insert(uint8_t key, N *val) {
@@ -62,11 +61,20 @@ namespace ART_unsynchronized {
     void N256::getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                            uint32_t &childrenCount) const {
         childrenCount = 0;
-        for (unsigned i = start; i <= end; i++) {
-            if (this->children[i] != nullptr) {
-                children[childrenCount] = std::make_tuple(i, this->children[i]);
-                childrenCount++;
-            }
-        }
+        NodeScan::forEachChild(this->children, start, end, [&](unsigned i) {
+            children[childrenCount] = std::make_tuple(i, this->children[i]);
+            childrenCount++;
+            return true;
+        });
+    }
+
+    void N256::getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                  uint32_t &childrenCount) const {
+        childrenCount = 0;
+        NodeScan::forEachChildReverse(this->children, start, end, [&](unsigned i) {
+            children[childrenCount] = std::make_tuple(i, this->children[i]);
+            childrenCount++;
+            return true;
+        });
     }
 }
\ No newline at end of file
@@ -104,4 +104,18 @@ namespace ART_unsynchronized {
             return std::get<0>(first) < std::get<0>(second);
         });
     }
+
+    void N4::getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                uint32_t &childrenCount) const {
+        childrenCount = 0;
+        for (uint32_t i = 0; i < 4; ++i) {
+            if (this->children[i] != nullptr && this->keys[i] >= start && this->keys[i] <= end) {
+                children[childrenCount] = std::make_tuple(this->keys[i], this->children[i]);
+                childrenCount++;
+            }
+        }
+        std::sort(children, children + childrenCount, [](auto first, auto second) {
+            return std::get<0>(first) > std::get<0>(second);
+        });
+    }
 }
\ No newline at end of file
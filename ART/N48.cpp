@@ -66,22 +66,30 @@ namespace ART_unsynchronized {
     }
 
     void N48::deleteChildren() {
-        for (unsigned i = 0; i < 256; i++) {
-            if (childIndex[i] != emptyMarker) {
-                N::deleteChildren(children[childIndex[i]]);
-                N::deleteNode(children[childIndex[i]]);
-            }
-        }
+        NodeScan::forEachIndex(childIndex, emptyMarker, 0, 255, [&](unsigned i) {
+            N::deleteChildren(children[childIndex[i]]);
+            N::deleteNode(children[childIndex[i]]);
+            return true;
+        });
     }
 
     void N48::getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                           uint32_t &childrenCount) const {
         childrenCount = 0;
-        for (unsigned i = start; i <= end; i++) {
-            if (this->childIndex[i] != emptyMarker) {
-                children[childrenCount] = std::make_tuple(i, this->children[this->childIndex[i]]);
-                childrenCount++;
-            }
-        }
+        NodeScan::forEachIndex(childIndex, emptyMarker, start, end, [&](unsigned i) {
+            children[childrenCount] = std::make_tuple(i, this->children[this->childIndex[i]]);
+            childrenCount++;
+            return true;
+        });
+    }
+
+    void N48::getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                 uint32_t &childrenCount) const {
+        childrenCount = 0;
+        NodeScan::forEachIndexReverse(childIndex, emptyMarker, start, end, [&](unsigned i) {
+            children[childrenCount] = std::make_tuple(i, this->children[this->childIndex[i]]);
+            childrenCount++;
+            return true;
+        });
     }
 }
\ No newline at end of file
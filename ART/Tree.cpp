@@ -1,7 +1,10 @@
 #include <assert.h>
 #include <algorithm>
+#include <atomic>
+#include <thread>
 #include <iostream>
 #include "Tree.h"
+#include "../BulkLoad.h"
 #include "../Epoche.cpp"
 #include "N.cpp"
 
@@ -10,7 +13,51 @@ namespace ART_unsynchronized {
     Tree::Tree(LoadKeyFunction loadKey) : root(new N256(nullptr, 0)), loadKey(loadKey) {
     }
 
+    static N *newBulkLoadNode(unsigned childrenCount, const uint8_t *prefix, uint32_t prefixLength) {
+        if (childrenCount <= 4) {
+            return new N4(prefix, prefixLength);
+        } else if (childrenCount <= 16) {
+            return new N16(prefix, prefixLength);
+        } else if (childrenCount <= 48) {
+            return new N48(prefix, prefixLength);
+        }
+        return new N256(prefix, prefixLength);
+    }
+
+    static void insertBulkLoaded(N *node, uint8_t key, N *child) {
+        switch (node->getType()) {
+            case NTypes::N4:
+                static_cast<N4 *>(node)->insert(key, child);
+                return;
+            case NTypes::N16:
+                static_cast<N16 *>(node)->insert(key, child);
+                return;
+            case NTypes::N48:
+                static_cast<N48 *>(node)->insert(key, child);
+                return;
+            case NTypes::N256:
+                static_cast<N256 *>(node)->insert(key, child);
+                return;
+        }
+    }
+
+    Tree::Tree(LoadKeyFunction loadKey, const Key keys[], const TID tids[], std::size_t n, unsigned threads)
+            : Tree(loadKey) {
+        ART::bulkLoad(root, keys, n, threads, [&](std::size_t i) { return N::setLeaf(tids[i]); },
+                      [](unsigned childrenCount, uint32_t, const uint8_t *prefix, uint32_t prefixLength) {
+                          return newBulkLoadNode(childrenCount, prefix, prefixLength);
+                      },
+                      insertBulkLoaded);
+    }
+
+    Tree::Tree(Tree &&t) : root(t.root), loadKey(t.loadKey) {
+        t.root = nullptr;
+    }
+
     Tree::~Tree() {
+        if (root == nullptr) {
+            return;
+        }
         N::deleteChildren(root);
         N::deleteNode(root);
     }
@@ -50,216 +97,128 @@ namespace ART_unsynchronized {
         }
     }
 
-    bool Tree::lookupRange(const Key &, const Key &, Key &, TID [],
-                                std::size_t , std::size_t &) const {
-        return false;
-        /*for (uint32_t i = 0; i < std::min(start.getKeyLen(), end.getKeyLen()); ++i) {
-            if (start[i] > end[i]) {
-                resultsFound = 0;
-                return false;
-            } else if (start[i] < end[i]) {
-                break;
-            }
+    static void copyKey(Key &to, const Key &from) {
+        if (from.getKeyLen() == 0) {
+            to.setKeyLen(0);
+        } else {
+            to.set(reinterpret_cast<const char *>(&from[0]), from.getKeyLen());
+        }
+    }
+
+    static int compareKeys(const Key &a, const Key &b) {
+        uint32_t len = std::min(a.getKeyLen(), b.getKeyLen());
+        int c = len > 0 ? memcmp(&a[0], &b[0], len) : 0;
+        if (c != 0) {
+            return c;
         }
-        TID toContinue = 0;
-        std::function<void(const N *)> copy = [&result, &resultSize, &resultsFound, &toContinue, &copy](const N *node) {
-            if (N::isLeaf(node)) {
-                if (resultsFound == resultSize) {
-                    toContinue = N::getLeaf(node);
+        return (a.getKeyLen() > b.getKeyLen()) - (a.getKeyLen() < b.getKeyLen());
+    }
+
+    void Tree::copyRange(N *node, uint32_t level, bool onStartPath, bool onEndPath, RangeScan &scan) const {
+        if (N::isLeaf(node)) {
+            if (onStartPath || onEndPath) {
+                Key kt;
+                loadKey(N::getLeaf(node), kt);
+                if ((onStartPath && compareKeys(kt, scan.start) < 0) || (onEndPath && compareKeys(kt, scan.end) >= 0)) {
                     return;
                 }
-                result[resultsFound] = N::getLeaf(node);
-                resultsFound++;
-            } else {
-                std::tuple<uint8_t, N *> children[256];
-                uint32_t childrenCount = 0;
-                N::getChildren(node, 0u, 255u, children, childrenCount);
-                for (uint32_t i = 0; i < childrenCount; ++i) {
-                    const N *n = std::get<1>(children[i]);
-                    copy(n);
-                    if (toContinue != 0) {
-                        break;
-                    }
-                }
             }
-        };
-        std::function<void(const N *, uint32_t)> findStart = [&copy, &start, &findStart, &toContinue, &restart, this](
-                const N *node, uint32_t level) {
-            if (N::isLeaf(node)) {
-                copy(node);
+            if (scan.resultsFound == scan.resultSize) {
+                scan.toContinue = N::getLeaf(node);
                 return;
             }
-
-            uint64_t v;
-            PCCompareResults prefixResult;
-            do {
-                v = node->startReading();
-                prefixResult = checkPrefixCompare(node, start, level, loadKey);
-            } while (!node->stopReading(v));
-            switch (prefixResult) {
+            scan.result[scan.resultsFound] = N::getLeaf(node);
+            scan.resultsFound++;
+            return;
+        }
+        if (onStartPath) {
+            uint32_t prefixLevel = level;
+            switch (checkPrefixCompare(node, scan.start, prefixLevel, loadKey)) {
+                case PCCompareResults::Smaller:
+                    return;
                 case PCCompareResults::Bigger:
-                    copy(node);
-                    break;
-                case PCCompareResults::Equal: {
-                    uint8_t startLevel = (start.getKeyLen() > level) ? start[level] : 0;
-                    std::tuple<uint8_t, N *> children[256];
-                    uint32_t childrenCount = 0;
-                    N::getChildren(node, startLevel, 255, children, childrenCount);
-                    for (uint32_t i = 0; i < childrenCount; ++i) {
-                        const uint8_t k = std::get<0>(children[i]);
-                        const N *n = std::get<1>(children[i]);
-                        if (k == startLevel) {
-                            findStart(n, level + 1);
-                        } else if (k > startLevel) {
-                            copy(n);
-                        }
-                        if (toContinue != 0 || restart) {
-                            break;
-                        }
-                    }
-                    break;
-                }
-                case PCCompareResults::SkippedLevel:
-                    restart = true;
+                    onStartPath = false;
                     break;
-                case PCCompareResults::Smaller:
+                case PCCompareResults::Equal:
                     break;
             }
-        };
-        std::function<void(const N *, uint32_t)> findEnd = [&copy, &end, &toContinue, &restart, &findEnd, this](
-                const N *node, uint32_t level) {
-            if (N::isLeaf(node)) {
-                return;
-            }
-            uint64_t v;
-            PCCompareResults prefixResult;
-            do {
-                v = node->startReading();
-                prefixResult = checkPrefixCompare(node, end, level, loadKey);
-            } while (!node->stopReading(v));
-
-            switch (prefixResult) {
-                case PCCompareResults::Smaller:
-                    copy(node);
-                    break;
-                case PCCompareResults::Equal: {
-                    uint8_t endLevel = (end.getKeyLen() > level) ? end[level] : 255;
-                    std::tuple<uint8_t, N *> children[256];
-                    uint32_t childrenCount = 0;
-                    N::getChildren(node, 0, endLevel, children, childrenCount);
-                    for (uint32_t i = 0; i < childrenCount; ++i) {
-                        const uint8_t k = std::get<0>(children[i]);
-                        const N *n = std::get<1>(children[i]);
-                        if (k == endLevel) {
-                            findEnd(n, level + 1);
-                        } else if (k < endLevel) {
-                            copy(n);
-                        }
-                        if (toContinue != 0 || restart) {
-                            break;
-                        }
-                    }
-                    break;
-                }
+        }
+        if (onEndPath) {
+            uint32_t prefixLevel = level;
+            switch (checkPrefixCompare(node, scan.end, prefixLevel, loadKey)) {
                 case PCCompareResults::Bigger:
+                    return;
+                case PCCompareResults::Smaller:
+                    onEndPath = false;
                     break;
-                case PCCompareResults::SkippedLevel:
-                    restart = true;
+                case PCCompareResults::Equal:
                     break;
             }
-        };
+        }
+        level += node->getPrefixLength();
+        if (onStartPath && scan.start.getKeyLen() <= level) {
+            onStartPath = false;
+        }
+        if (onEndPath && scan.end.getKeyLen() <= level) {
+            return;
+        }
+        uint8_t startLevel = onStartPath ? scan.start[level] : 0;
+        uint8_t endLevel = onEndPath ? scan.end[level] : 255;
+        std::tuple<uint8_t, N *> children[256];
+        uint32_t childrenCount = 0;
+        if (scan.reverse) {
+            N::getChildrenReverse(node, startLevel, endLevel, children, childrenCount);
+        } else {
+            N::getChildren(node, startLevel, endLevel, children, childrenCount);
+        }
+        for (uint32_t i = 0; i < childrenCount; ++i) {
+            const uint8_t k = std::get<0>(children[i]);
+            N *n = std::get<1>(children[i]);
+            copyRange(n, level + 1, onStartPath && k == startLevel, onEndPath && k == endLevel, scan);
+            if (scan.toContinue != 0) {
+                break;
+            }
+        }
+    }
 
-        restart:
-        restart = false;
+    bool Tree::lookupRangeReverse(const Key &start, const Key &end, Key &continueKey, TID result[],
+                                  std::size_t resultSize, std::size_t &resultsFound) const {
         resultsFound = 0;
-
-        uint32_t level = 0;
-        N *node = nullptr;
-        N *nextNode = root;
-
-        while (true) {
-            node = nextNode;
-            uint64_t v;
-            PCEqualsResults prefixResult;
-            do {
-                v = node->startReading();
-                prefixResult = checkPrefixEquals(node, level, start, end, loadKey);
-            } while (!node->stopReading(v));
-            switch (prefixResult) {
-                case PCEqualsResults::SkippedLevel:
-                    goto restart;
-                case PCEqualsResults::NoMatch: {
-                    return false;
-                }
-                case PCEqualsResults::Contained: {
-                    copy(node);
-                    break;
-                }
-                case PCEqualsResults::StartMatch: {
-                    uint8_t startLevel = (start.getKeyLen() > level) ? start[level] : 0;
-                    std::tuple<uint8_t, N *> children[256];
-                    uint32_t childrenCount = 0;
-                    N::getChildren(node, startLevel, 255, children, childrenCount);
-                    for (uint32_t i = 0; i < childrenCount; ++i) {
-                        const uint8_t k = std::get<0>(children[i]);
-                        const N *n = std::get<1>(children[i]);
-                        if (k == startLevel) {
-                            findStart(n, level + 1);
-                        } else if (k > startLevel) {
-                            copy(n);
-                        }
-                        if (restart) {
-                            goto restart;
-                        }
-                        if (toContinue) {
-                            break;
-                        }
-                    }
-                    break;
-                }
-                case PCEqualsResults::BothMatch: {
-                    uint8_t startLevel = (start.getKeyLen() > level) ? start[level] : 0;
-                    uint8_t endLevel = (end.getKeyLen() > level) ? end[level] : 255;
-                    if (startLevel != endLevel) {
-                        std::tuple<uint8_t, N *> children[256];
-                        uint32_t childrenCount = 0;
-                        N::getChildren(node, startLevel, endLevel, children, childrenCount);
-                        for (uint32_t i = 0; i < childrenCount; ++i) {
-                            const uint8_t k = std::get<0>(children[i]);
-                            const N *n = std::get<1>(children[i]);
-                            if (k == startLevel) {
-                                findStart(n, level + 1);
-                            } else if (k > startLevel && k < endLevel) {
-                                copy(n);
-                            } else if (k == endLevel) {
-                                findEnd(n, level + 1);
-                            }
-                            if (restart) {
-                                goto restart;
-                            }
-                            if (toContinue) {
-                                break;
-                            }
-                        }
-                    } else {
-                        nextNode = N::getChild(startLevel, node);
-                        if (!node->stopReading(v)) {
-                            goto restart;
-                        }
-                        level++;
-                        continue;
-                    }
-                    break;
-                }
-            }
-            break;
+        // an empty end is no bound
+        bool hasEnd = end.getKeyLen() > 0;
+        if (hasEnd && compareKeys(start, end) >= 0) {
+            return false;
         }
-        if (toContinue != 0) {
-            loadKey(toContinue, continueKey);
-            return true;
+        RangeScan scan{start, end, result, resultSize, 0, 0, true};
+        copyRange(root, 0, true, hasEnd, scan);
+        resultsFound = scan.resultsFound;
+        if (scan.toContinue == 0) {
+            return false;
+        }
+        if (resultsFound == 0) {
+            copyKey(continueKey, end);
         } else {
+            loadKey(result[resultsFound - 1], continueKey);
+        }
+        return true;
+    }
+
+    bool Tree::lookupRange(const Key &start, const Key &end, Key &continueKey, TID result[],
+                           std::size_t resultSize, std::size_t &resultsFound) const {
+        resultsFound = 0;
+        // an empty end is no bound
+        bool hasEnd = end.getKeyLen() > 0;
+        if (hasEnd && compareKeys(start, end) >= 0) {
+            return false;
+        }
+        RangeScan scan{start, end, result, resultSize, 0, 0, false};
+        copyRange(root, 0, true, hasEnd, scan);
+        resultsFound = scan.resultsFound;
+        if (scan.toContinue == 0) {
             return false;
-        }*/
+        }
+        loadKey(scan.toContinue, continueKey);
+        return true;
     }
 
 
@@ -478,32 +437,4 @@ namespace ART_unsynchronized {
         return PCCompareResults::Equal;
     }
 
-    typename Tree::PCEqualsResults Tree::checkPrefixEquals(N *n, uint32_t &level, const Key &start, const Key &end,
-                                                      LoadKeyFunction loadKey) {
-        if (n->hasPrefix()) {
-            bool endMatches = true;
-            Key kt;
-            for (uint32_t i = 0; i < n->getPrefixLength(); ++i) {
-                if (i == maxStoredPrefixLength) {
-                    loadKey(N::getAnyChildTid(n), kt);
-                }
-                uint8_t startLevel = (start.getKeyLen() > level) ? start[level] : 0;
-                uint8_t endLevel = (end.getKeyLen() > level) ? end[level] : 0;
-
-                uint8_t curKey = i >= maxStoredPrefixLength ? kt[level] : n->getPrefix()[i];
-                if (curKey > startLevel && curKey < endLevel) {
-                    return PCEqualsResults::Contained;
-                } else if (curKey < startLevel || curKey > endLevel) {
-                    return PCEqualsResults::NoMatch;
-                } else if (curKey != endLevel) {
-                    endMatches = false;
-                }
-                ++level;
-            }
-            if (!endMatches) {
-                return PCEqualsResults::StartMatch;
-            }
-        }
-        return PCEqualsResults::BothMatch;
-    }
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #ifndef ARTVERSION1_TREE_H
 #define ARTVERSION1_TREE_H
+#include <vector>
 #include "N.h"
 
 using namespace ART;
@@ -16,7 +17,8 @@ namespace ART_unsynchronized {
 
     private:
 
-        N *const root;
+        // nullptr once the tree is moved from
+        N *root;
 
         TID checkKey(const TID tid, const Key &k) const;
 
@@ -38,12 +40,6 @@ namespace ART_unsynchronized {
             Equal,
             Bigger,
         };
-        enum class PCEqualsResults : uint8_t {
-            StartMatch,
-            BothMatch,
-            Contained,
-            NoMatch,
-        };
         static CheckPrefixResult checkPrefix(N* n, const Key &k, uint32_t &level);
 
         static CheckPrefixPessimisticResult checkPrefixPessimistic(N *n, const Key &k, uint32_t &level,
@@ -53,23 +49,53 @@ namespace ART_unsynchronized {
 
         static PCCompareResults checkPrefixCompare(N* n, const Key &k, uint32_t &level, LoadKeyFunction loadKey);
 
-        static PCEqualsResults checkPrefixEquals(N* n, uint32_t &level, const Key &start, const Key &end, LoadKeyFunction loadKey);
+        // state of lookupRange and lookupRangeReverse
+        struct RangeScan {
+            const Key &start;
+            const Key &end;
+            TID *result;
+            std::size_t resultSize;
+            std::size_t resultsFound;
+            // first TID that did not fit into result
+            TID toContinue;
+            bool reverse;
+        };
+
+        // copies the TIDs of node in [start, end) in key order, descending if reverse, onStartPath/onEndPath tell
+        // whether the keys of the node share start's/end's bytes up to level
+        void copyRange(N *node, uint32_t level, bool onStartPath, bool onEndPath, RangeScan &scan) const;
 
     public:
 
         Tree(LoadKeyFunction loadKey);
 
+        // Builds the tree from the n keys in ascending order without duplicates, tids[i] being the TID of keys[i].
+        // Nodes are created at their final size, the subtrees below the top levels are built by the given
+        // number of threads. Throws std::invalid_argument if the keys are not ascending or have duplicates, see
+        // BulkLoad.h.
+        Tree(LoadKeyFunction loadKey, const Key keys[], const TID tids[], std::size_t n, unsigned threads = 1);
+
         Tree(const Tree &) = delete;
 
-        Tree(Tree &&t) : root(t.root), loadKey(t.loadKey) { }
+        // takes over the nodes of t, which is left without a root and may only be destroyed
+        Tree(Tree &&t);
 
         ~Tree();
 
         TID lookup(const Key &k) const;
 
+        // Finds the TIDs of the keys in [start, end) in ascending key order, of all keys >= start if end is empty.
+        // Returns true if there are more than resultLen of them, continueKey is then set to the first key that did
+        // not fit, which is the start for the next call.
         bool lookupRange(const Key &start, const Key &end, Key &continueKey, TID result[], std::size_t resultLen,
                          std::size_t &resultCount) const;
 
+        // Finds the TIDs of the keys in [start, end) in descending key order, of all keys >= start if end is empty.
+        // Returns true if there are more than resultLen of them, continueKey is then set to the last key in result,
+        // which is the end for the next call.
+        bool lookupRangeReverse(const Key &start, const Key &end, Key &continueKey, TID result[], std::size_t resultLen,
+                                std::size_t &resultCount) const;
+
         void insert(const Key &k, TID tid);
 
         void remove(const Key &k, TID tid);
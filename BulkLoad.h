@@ -0,0 +1,202 @@
+//
+// Builds the nodes of a tree from sorted keys, for the bulk-load constructors of all tree variants.
+//
+
+#ifndef ART_BULKLOAD_H
+#define ART_BULKLOAD_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "Key.h"
+
+namespace ART {
+
+    // whether a sorts before b, a shorter key before the longer ones it is a prefix of. Compares 8 bytes at a time
+    // inline, a memcmp call per key costs as much as a quarter of a bulk load of integer keys.
+    inline bool bulkLoadKeyLess(const Key &a, const Key &b) {
+        KeyLen common = std::min(a.getKeyLen(), b.getKeyLen());
+        KeyLen i = 0;
+        for (; i + sizeof(uint64_t) <= common; i += sizeof(uint64_t)) {
+            uint64_t wordA, wordB;
+            memcpy(&wordA, &a[i], sizeof(wordA));
+            memcpy(&wordB, &b[i], sizeof(wordB));
+            if (wordA != wordB) {
+                return __builtin_bswap64(wordA) < __builtin_bswap64(wordB);
+            }
+        }
+        for (; i < common; ++i) {
+            if (a[i] != b[i]) {
+                return a[i] < b[i];
+            }
+        }
+        return a.getKeyLen() < b.getKeyLen();
+    }
+
+    /**
+     * Fills the root of a tree with the n keys and throws std::invalid_argument if they are not in ascending order
+     * without duplicates. Each key is compared with the one before when its leaf is created, while both are still
+     * cached, instead of in a pass of its own over the keys. Keys out of order only leave the tree incomplete until
+     * the build ends, so that the root can be deleted as usual.
+     * The variant provides the nodes through three callbacks:
+     *   NODE *newLeaf(std::size_t i), the leaf of keys[i]
+     *   NODE *newNode(unsigned childrenCount, uint32_t level, const uint8_t *prefix, uint32_t prefixLength), an
+     *     inner node big enough for its children at level, below a prefix
+     *   void insert(NODE *node, uint8_t key, NODE *child)
+     * The levels above subtrees of at most n / (threads * 16) keys are built right away, the subtrees by the given
+     * number of threads.
+     */
+    template<typename NODE, typename NEW_LEAF, typename NEW_NODE, typename INSERT>
+    class BulkLoader {
+        const Key *const keys;
+        NEW_LEAF newLeaf;
+        NEW_NODE newNode;
+        INSERT insert;
+        std::size_t grain;
+        std::atomic<bool> invalid{false};
+
+        // a subtree that is left to the threads
+        struct Task {
+            NODE *parent;
+            uint8_t key;
+            std::size_t begin;
+            std::size_t end;
+            uint32_t level;
+            NODE *child;
+        };
+
+        static uint8_t keySlice(const Key &k, uint32_t level) {
+            return (k.getKeyLen() > level) ? k[level] : 0;
+        }
+
+        // end of the keys starting at i that share the slice at level with keys[i], found by galloping since the
+        // slices are ascending within the range
+        std::size_t groupEnd(std::size_t i, std::size_t end, uint32_t level) const {
+            uint8_t key = keySlice(keys[i], level);
+            std::size_t low = i + 1, step = 1;
+            while (low < end && keySlice(keys[low], level) == key) {
+                low = i + 1 + step;
+                step *= 2;
+            }
+            std::size_t high = std::min(low, end);
+            low = i + 1 + step / 4;
+            while (low < high) {
+                std::size_t mid = low + (high - low) / 2;
+                if (keySlice(keys[mid], level) == key) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            return low;
+        }
+
+        // ends of the groups of keys in [begin, end) that share the slice at level, one per child of their node,
+        // so that the keys are only scanned once per level. Keys out of order can repeat a slice or make more than
+        // 256 groups, the groups from there on are left out.
+        unsigned groups(std::size_t begin, std::size_t end, uint32_t level, std::size_t groupEnds[256]) {
+            unsigned groupCount = 0;
+            for (std::size_t i = begin; i < end; i = groupEnds[groupCount++]) {
+                if (groupCount > 0 &&
+                    (groupCount == 256 || keySlice(keys[i], level) <= keySlice(keys[i - 1], level))) {
+                    invalid = true;
+                    break;
+                }
+                groupEnds[groupCount] = groupEnd(i, end, level);
+            }
+            return groupCount;
+        }
+
+        NODE *subtree(std::size_t begin, std::size_t end, uint32_t level, std::vector<Task> *tasks) {
+            // the keys are sorted, so the first and the last one share the prefix of all of them
+            const Key &first = keys[begin];
+            const Key &last = keys[end - 1];
+            uint32_t prefixLength = 0;
+            while (level + prefixLength < first.getKeyLen() && level + prefixLength < last.getKeyLen() &&
+                   first[level + prefixLength] == last[level + prefixLength]) {
+                prefixLength++;
+            }
+            uint32_t nodeLevel = level + prefixLength;
+            std::size_t groupEnds[256];
+            unsigned childrenCount = groups(begin, end, nodeLevel, groupEnds);
+            if (childrenCount < 2) {
+                // duplicates, or keys that only differ by trailing 0 bytes, which the tree can't tell apart
+                invalid = true;
+                return newLeaf(begin);
+            }
+            NODE *node = newNode(childrenCount, nodeLevel, prefixLength > 0 ? &first[level] : nullptr, prefixLength);
+            children(node, begin, groupEnds, childrenCount, nodeLevel, tasks);
+            return node;
+        }
+
+        // groupEnds[g] is the end of the keys of the g-th child
+        void children(NODE *node, std::size_t begin, const std::size_t groupEnds[], unsigned groupCount,
+                      uint32_t level, std::vector<Task> *tasks) {
+            std::size_t i = begin;
+            for (unsigned g = 0; g < groupCount; ++g) {
+                uint8_t key = keySlice(keys[i], level);
+                std::size_t j = groupEnds[g];
+                if (j - i == 1) {
+                    if (i > 0 && !bulkLoadKeyLess(keys[i - 1], keys[i])) {
+                        invalid = true;
+                    }
+                    insert(node, key, newLeaf(i));
+                } else if (tasks != nullptr && j - i <= grain) {
+                    tasks->push_back(Task{node, key, i, j, level + 1, nullptr});
+                } else {
+                    insert(node, key, subtree(i, j, level + 1, tasks));
+                }
+                i = j;
+            }
+        }
+
+    public:
+        BulkLoader(const Key keys[], NEW_LEAF newLeaf, NEW_NODE newNode, INSERT insert)
+                : keys(keys), newLeaf(newLeaf), newNode(newNode), insert(insert) { }
+
+        void load(NODE *root, std::size_t n, unsigned threads) {
+            std::vector<Task> tasks;
+            grain = threads > 1 ? std::max<std::size_t>(n / (threads * 16), 2) : n;
+            std::size_t groupEnds[256];
+            unsigned groupCount = groups(0, n, 0, groupEnds);
+            children(root, 0, groupEnds, groupCount, 0, threads > 1 ? &tasks : nullptr);
+            build(tasks, threads);
+            if (invalid) {
+                throw std::invalid_argument("bulk load: the keys are not in ascending order or have duplicates");
+            }
+        }
+
+    private:
+        void build(std::vector<Task> &tasks, unsigned threads) {
+            if (tasks.empty()) {
+                return;
+            }
+            std::atomic<std::size_t> nextTask{0};
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; ++t) {
+                workers.emplace_back([&]() {
+                    for (std::size_t i = nextTask++; i < tasks.size(); i = nextTask++) {
+                        tasks[i].child = subtree(tasks[i].begin, tasks[i].end, tasks[i].level, nullptr);
+                    }
+                });
+            }
+            for (auto &worker : workers) {
+                worker.join();
+            }
+            for (auto &task : tasks) {
+                insert(task.parent, task.key, task.child);
+            }
+        }
+    };
+
+    template<typename NODE, typename NEW_LEAF, typename NEW_NODE, typename INSERT>
+    void bulkLoad(NODE *root, const Key keys[], std::size_t n, unsigned threads, NEW_LEAF newLeaf, NEW_NODE newNode,
+                  INSERT insert) {
+        BulkLoader<NODE, NEW_LEAF, NEW_NODE, INSERT>(keys, newLeaf, newNode, insert).load(root, n, threads);
+    }
+}
+
+#endif //ART_BULKLOAD_H
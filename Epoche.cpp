@@ -5,8 +5,12 @@
 #define EPOCHE_CPP
 
 #include <assert.h>
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <new>
 #include "Epoche.h"
+#include "NodeAllocator.h"
 using namespace ART;
 
 
@@ -21,8 +25,22 @@ inline DeletionList::~DeletionList() {
     freeLabelDeletes = nullptr;
 }
 
-inline std::size_t DeletionList::size() {
-    return deletitionListCount;
+inline std::size_t DeletionList::size() const {
+    return deletitionListCount.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+inline void DeletionList::increase(std::atomic<T> &counter, T value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+template<typename T>
+inline void DeletionList::decrease(std::atomic<T> &counter, T value) {
+    counter.store(counter.load(std::memory_order_relaxed) - value, std::memory_order_relaxed);
+}
+
+inline void DeletionList::addElements(int64_t delta) {
+    increase(elements, delta);
 }
 
 inline void DeletionList::remove(LabelDelete *label, LabelDelete *prev) {
@@ -31,15 +49,16 @@ inline void DeletionList::remove(LabelDelete *label, LabelDelete *prev) {
     } else {
         prev->next = label->next;
     }
-    deletitionListCount -= label->nodesCount;
+    decrease(deletitionListCount, label->nodesCount);
+    decrease(pendingBytes, label->bytes);
 
     label->next = freeLabelDeletes;
     freeLabelDeletes = label;
-    deleted += label->nodesCount;
+    increase(deleted, static_cast<uint64_t>(label->nodesCount));
 }
 
-inline void DeletionList::add(void *n, uint64_t globalEpoch) {
-    deletitionListCount++;
+inline void DeletionList::add(void *n, uint64_t globalEpoch, std::size_t bytes) {
+    increase(deletitionListCount, static_cast<std::size_t>(1));
     LabelDelete *label;
     if (headDeletionList != nullptr && headDeletionList->nodesCount < headDeletionList->nodes.size()) {
         label = headDeletionList;
@@ -51,99 +70,595 @@ inline void DeletionList::add(void *n, uint64_t globalEpoch) {
             label = new LabelDelete();
         }
         label->nodesCount = 0;
+        label->bytes = 0;
         label->next = headDeletionList;
         headDeletionList = label;
     }
     label->nodes[label->nodesCount] = n;
     label->nodesCount++;
+    label->bytes += bytes;
     label->epoche = globalEpoch;
+    increase(pendingBytes, bytes);
+    if (globalEpoch != newestEpoche) {
+        newestEpoche = globalEpoch;
+        newestEpocheBytes = 0;
+    }
+    newestEpocheBytes += bytes;
 
-    added++;
+    increase(added, static_cast<uint64_t>(1));
 }
 
 inline LabelDelete *DeletionList::head() {
     return headDeletionList;
 }
 
+inline LabelDelete *DeletionList::takeAll() {
+    LabelDelete *labels = headDeletionList;
+    headDeletionList = nullptr;
+    increase(deleted, static_cast<uint64_t>(deletitionListCount.load(std::memory_order_relaxed)));
+    deletitionListCount.store(0, std::memory_order_relaxed);
+    pendingBytes.store(0, std::memory_order_relaxed);
+    return labels;
+}
+
+inline void DeletionList::addFreeLabels(LabelDelete *labels) {
+    while (labels != nullptr) {
+        LabelDelete *next = labels->next;
+        labels->next = freeLabelDeletes;
+        freeLabelDeletes = labels;
+        labels = next;
+    }
+}
+
+inline bool DeletionList::hasFreeLabels() const {
+    return freeLabelDeletes != nullptr;
+}
+
+inline Epoche::Epoche(size_t startGCThreshhold, ReclaimMode reclaimMode, ReclaimScheme reclaimScheme)
+        : startGCThreshhold(startGCThreshhold), reclaimMode(reclaimMode), reclaimScheme(reclaimScheme) {
+    if (reclaimMode == ReclaimMode::Background) {
+        reclaimer = std::thread([this]() { reclaim(); });
+    }
+}
+
+inline ReclaimMode Epoche::getReclaimMode() const {
+    return reclaimMode;
+}
+
+inline ReclaimScheme Epoche::getReclaimScheme() const {
+    return reclaimScheme;
+}
+
+inline uint64_t Epoche::getEpocheAdvances() const {
+    return currentEpoche.load(std::memory_order_relaxed);
+}
+
+inline std::size_t Epoche::getPendingBytes() const {
+    std::size_t bytes = handedOffBytes.load(std::memory_order_relaxed);
+    forEachDeletionList([&](const DeletionList &d) {
+        bytes += d.pendingBytes.load(std::memory_order_relaxed);
+    });
+    return bytes;
+}
+
+inline int64_t Epoche::getElementCount() const {
+    int64_t elements = 0;
+    forEachDeletionList([&](const DeletionList &d) {
+        elements += d.elements.load(std::memory_order_relaxed);
+    });
+    return elements;
+}
+
+inline void Epoche::setRetiredBudget(std::size_t bytes) {
+    retiredBudget.store(bytes, std::memory_order_relaxed);
+}
+
+inline std::size_t Epoche::getRetiredBudget() const {
+    return retiredBudget.load(std::memory_order_relaxed);
+}
+
+inline EpocheStats Epoche::getStats() const {
+    EpocheStats stats{};
+    stats.currentEpoche = currentEpoche.load();
+    stats.oldestEpoche = stats.currentEpoche;
+    stats.pendingNodes = handedOffNodes.load(std::memory_order_relaxed);
+    stats.pendingBytes = handedOffBytes.load(std::memory_order_relaxed);
+    forEachDeletionList([&](const DeletionList &d) {
+        EpocheThreadStats thread{d.owner.load(std::memory_order_relaxed), d.localEpoche.load(), d.size(),
+                                 d.pendingBytes.load(std::memory_order_relaxed),
+                                 d.added.load(std::memory_order_relaxed), d.deleted.load(std::memory_order_relaxed)};
+        if (thread.thread == std::thread::id() && thread.pendingNodes == 0) {
+            return;
+        }
+        if (thread.epoche < stats.oldestEpoche) {
+            stats.oldestEpoche = thread.epoche;
+            stats.oldestThread = thread.thread;
+        }
+        stats.pendingNodes += thread.pendingNodes;
+        stats.pendingBytes += thread.pendingBytes;
+        stats.threads.push_back(thread);
+    });
+    stats.epocheLag = stats.currentEpoche - stats.oldestEpoche;
+    stats.reclaimPasses = reclaimPasses.load(std::memory_order_relaxed);
+    stats.reclaimedNodes = reclaimedNodes.load(std::memory_order_relaxed);
+    stats.reclaimNs = reclaimNs.load(std::memory_order_relaxed);
+    stats.lastPassNodes = lastPassNodes.load(std::memory_order_relaxed);
+    stats.lastPassNs = lastPassNs.load(std::memory_order_relaxed);
+    stats.maxPassNs = maxPassNs.load(std::memory_order_relaxed);
+    stats.retiredBudget = retiredBudget.load(std::memory_order_relaxed);
+    stats.throttledOperations = throttledOperations.load(std::memory_order_relaxed);
+    stats.throttleNs = throttleNs.load(std::memory_order_relaxed);
+    stats.lastBlockingThread = lastBlockingThread.load(std::memory_order_relaxed);
+    return stats;
+}
+
+inline uint64_t Epoche::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline void Epoche::tryAdvance(uint64_t epoche) {
+    if (advancing.load(std::memory_order_relaxed) || advancing.exchange(true, std::memory_order_acquire)) {
+        return;
+    }
+    // the reclaimer thread advances it too, without the flag
+    if (currentEpoche.compare_exchange_strong(epoche, epoche + 1)) {
+        lastAdvance.store(now(), std::memory_order_relaxed);
+    }
+    advancing.store(false, std::memory_order_release);
+}
+
 inline void Epoche::enterEpoche(ThreadInfo &epocheInfo) {
+    DeletionList &deletionList = epocheInfo.getDeletionList();
+    if (deletionList.pinDepth > 0) {
+        if (canReclaim(deletionList) && ++deletionList.sessionOperations >= deletionList.sessionRepinInterval) {
+            continueSession(deletionList);
+        }
+        return;
+    }
+    if (reclaimScheme == ReclaimScheme::QuiescentState) {
+        return;
+    }
     unsigned long curEpoche = currentEpoche.load(std::memory_order_relaxed);
-    epocheInfo.getDeletionList().localEpoche.store(curEpoche, std::memory_order_release);
+    deletionList.localEpoche.store(curEpoche, std::memory_order_release);
 }
 
 inline void Epoche::markNodeForDeletion(void *n, ThreadInfo &epocheInfo) {
-    epocheInfo.getDeletionList().add(n, currentEpoche.load());
+    epocheInfo.getDeletionList().add(n, currentEpoche.load(), NodeAllocator::blockSize(n));
     epocheInfo.getDeletionList().thresholdCounter++;
 }
 
 inline void Epoche::exitEpocheAndCleanup(ThreadInfo &epocheInfo) {
     DeletionList &deletionList = epocheInfo.getDeletionList();
+    if (reclaimMode == ReclaimMode::Background) {
+        if (deletionList.thresholdCounter > startGCThreshhold) {
+            handOff(deletionList);
+            deletionList.thresholdCounter = 0;
+            enforceBudget(deletionList);
+        }
+        return;
+    }
+#if ART_EPOCHE_ADAPTIVE
+    if (deletionList.size() == 0) {
+        deletionList.thresholdCounter = 0;
+        return;
+    }
+    // the clock is read every 16 operations with retired nodes, so that threads that retire few of them still
+    // advance the epoche and reclaim them after about reclaimInterval
+    const uint64_t interval = std::chrono::nanoseconds(reclaimInterval).count();
+    bool timeDue = false;
+    uint64_t curTime = 0;
+    if ((++deletionList.exitsSinceCheck & (16 - 1)) == 0) {
+        curTime = now();
+        timeDue = curTime - deletionList.lastCleanup >= interval;
+    }
+    // the epoche only has to move on if this thread retired nodes in the current one, otherwise another thread
+    // already did it
+    uint64_t curEpoche = currentEpoche.load(std::memory_order_relaxed);
+    if (deletionList.newestEpoche == curEpoche &&
+        (deletionList.newestEpocheBytes >= advanceBytes ||
+         (timeDue && curTime - lastAdvance.load(std::memory_order_relaxed) >= interval))) {
+        tryAdvance(curEpoche);
+    }
+    if ((deletionList.thresholdCounter > startGCThreshhold || timeDue) && canReclaim(deletionList)) {
+        leaveEpocheAndCleanup(deletionList);
+        deletionList.thresholdCounter = 0;
+        deletionList.lastCleanup = curTime != 0 ? curTime : now();
+        enforceBudget(deletionList);
+    }
+#else
     if ((deletionList.thresholdCounter & (64 - 1)) == 1) {
         currentEpoche++;
     }
-    if (deletionList.thresholdCounter > startGCThreshhold) {
+    if (deletionList.thresholdCounter > startGCThreshhold && canReclaim(deletionList)) {
         if (deletionList.size() == 0) {
             deletionList.thresholdCounter = 0;
             return;
         }
-        deletionList.localEpoche.store(std::numeric_limits<uint64_t>::max());
+        leaveEpocheAndCleanup(deletionList);
+        deletionList.thresholdCounter = 0;
+        enforceBudget(deletionList);
+    }
+#endif
+}
 
-        uint64_t oldestEpoche = std::numeric_limits<uint64_t>::max();
-        for (auto &epoche : deletionLists) {
-            auto e = epoche.localEpoche.load();
-            if (e < oldestEpoche) {
-                oldestEpoche = e;
+inline void Epoche::enforceBudget(DeletionList &deletionList) {
+    std::size_t budget = retiredBudget.load(std::memory_order_relaxed);
+    if (budget == 0 || !canReclaim(deletionList) || getPendingBytes() <= budget) {
+        return;
+    }
+    // throttled writers must not hold back each other
+    leaveEpoche(deletionList);
+    uint64_t start = now();
+    const uint64_t deadline = start + std::chrono::nanoseconds(maxThrottle).count();
+    std::chrono::microseconds backoff{10};
+    uint64_t blockedEpoche = currentEpoche.load();
+    bool waited = false;
+    while (true) {
+        if (reclaimMode == ReclaimMode::Background) {
+            reclaimerWakeup.notify_one();
+        } else {
+            tryAdvance(currentEpoche.load());
+            cleanup(deletionList);
+        }
+        if (getPendingBytes() <= budget) {
+            break;
+        }
+        // waiting only helps if a thread is in an operation that started before the epoche moved on, the nodes
+        // of threads that are not in one are freed by them later
+        std::thread::id blocker;
+        if (getOldestEpoche(&blocker) > blockedEpoche || now() >= deadline) {
+            break;
+        }
+        lastBlockingThread.store(blocker, std::memory_order_relaxed);
+        waited = true;
+        std::this_thread::sleep_for(backoff);
+        backoff = std::min<std::chrono::microseconds>(backoff * 2, reclaimInterval);
+    }
+    if (deletionList.pinDepth > 0) {
+        continueSession(deletionList);
+    }
+    if (waited) {
+        throttledOperations.fetch_add(1, std::memory_order_relaxed);
+        throttleNs.fetch_add(now() - start, std::memory_order_relaxed);
+    }
+}
+
+template<typename F>
+inline void Epoche::forEachDeletionList(F f) const {
+    for (DeletionListBlock *block = deletionListBlocks.load(std::memory_order_acquire); block != nullptr;
+         block = block->next) {
+        std::size_t used = block->used.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < used; ++i) {
+            f(block->deletionLists[i]);
+        }
+    }
+}
+
+inline uint64_t Epoche::getOldestEpoche(std::thread::id *thread) const {
+    uint64_t oldestEpoche = std::numeric_limits<uint64_t>::max();
+    forEachDeletionList([&](const DeletionList &deletionList) {
+        auto e = deletionList.localEpoche.load();
+        if (e < oldestEpoche) {
+            oldestEpoche = e;
+            if (thread != nullptr) {
+                *thread = deletionList.owner.load(std::memory_order_relaxed);
             }
         }
+    });
+    return oldestEpoche;
+}
+
+inline void Epoche::cleanup(DeletionList &deletionList) {
+    uint64_t start = now();
+    uint64_t oldestEpoche = getOldestEpoche();
+    uint64_t freedNodes = 0;
+    LabelDelete *cur = deletionList.head(), *next, *prev = nullptr;
+    while (cur != nullptr) {
+        next = cur->next;
 
-        LabelDelete *cur = deletionList.head(), *next, *prev = nullptr;
+        if (cur->epoche < oldestEpoche) {
+            for (std::size_t i = 0; i < cur->nodesCount; ++i) {
+                NodeAllocator::deallocate(cur->nodes[i]);
+            }
+            freedNodes += cur->nodesCount;
+            deletionList.remove(cur, prev);
+        } else {
+            prev = cur;
+        }
+        cur = next;
+    }
+    recordPass(freedNodes, now() - start);
+}
+
+inline void Epoche::recordPass(uint64_t nodes, uint64_t ns) {
+    reclaimPasses.fetch_add(1, std::memory_order_relaxed);
+    reclaimedNodes.fetch_add(nodes, std::memory_order_relaxed);
+    reclaimNs.fetch_add(ns, std::memory_order_relaxed);
+    lastPassNodes.store(nodes, std::memory_order_relaxed);
+    lastPassNs.store(ns, std::memory_order_relaxed);
+    uint64_t maxNs = maxPassNs.load(std::memory_order_relaxed);
+    while (ns > maxNs && !maxPassNs.compare_exchange_weak(maxNs, ns, std::memory_order_relaxed));
+}
+
+inline void Epoche::push(std::atomic<LabelDelete *> &labels, LabelDelete *first) {
+    LabelDelete *last = first;
+    while (last->next != nullptr) {
+        last = last->next;
+    }
+    LabelDelete *head = labels.load(std::memory_order_relaxed);
+    do {
+        last->next = head;
+    } while (!labels.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+}
+
+inline void Epoche::handOff(DeletionList &deletionList) {
+    handedOffNodes.fetch_add(deletionList.size(), std::memory_order_relaxed);
+    handedOffBytes.fetch_add(deletionList.pendingBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    LabelDelete *labels = deletionList.takeAll();
+    if (labels != nullptr) {
+        push(handedOff, labels);
+    }
+    if (!deletionList.hasFreeLabels()) {
+        deletionList.addFreeLabels(freeLabels.exchange(nullptr, std::memory_order_acquire));
+    }
+}
+
+inline void Epoche::handOffDetached() {
+    for (DeletionListBlock *block = deletionListBlocks.load(std::memory_order_acquire); block != nullptr;
+         block = block->next) {
+        std::size_t used = block->used.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < used; ++i) {
+            DeletionList &deletionList = block->deletionLists[i];
+            if (deletionList.size() == 0 || deletionList.attached.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            // the slot is taken while its nodes are handed off, so that no thread attaches to it meanwhile
+            bool attached = false;
+            if (deletionList.attached.compare_exchange_strong(attached, true, std::memory_order_acquire)) {
+                handOff(deletionList);
+                deletionList.attached.store(false, std::memory_order_release);
+            }
+        }
+    }
+}
+
+inline void Epoche::reclaim() {
+    std::unique_lock<std::mutex> lock(reclaimerMutex);
+    while (!stopReclaimer) {
+        reclaimerWakeup.wait_for(lock, reclaimInterval);
+        lock.unlock();
+        uint64_t start = now();
+        handOffDetached();
+
+        // labels that are handed off after the increment carry the new epoche, the ones before are older.
+        // Without retired nodes there is no reason to advance it.
+        if (pending != nullptr || handedOff.load(std::memory_order_relaxed) != nullptr) {
+            currentEpoche++;
+        }
+        LabelDelete *labels = handedOff.exchange(nullptr, std::memory_order_acquire);
+        if (labels != nullptr) {
+            LabelDelete *last = labels;
+            while (last->next != nullptr) {
+                last = last->next;
+            }
+            last->next = pending;
+            pending = labels;
+        }
+
+        bool scanned = pending != nullptr;
+        uint64_t oldestEpoche = getOldestEpoche();
+        LabelDelete *cur = pending, *next, *prev = nullptr, *freed = nullptr;
+        uint64_t freedNodes = 0;
+        std::size_t freedBytes = 0;
         while (cur != nullptr) {
             next = cur->next;
-
             if (cur->epoche < oldestEpoche) {
                 for (std::size_t i = 0; i < cur->nodesCount; ++i) {
-                    operator delete(cur->nodes[i]);
+                    NodeAllocator::deallocate(cur->nodes[i]);
                 }
-                deletionList.remove(cur, prev);
+                freedNodes += cur->nodesCount;
+                freedBytes += cur->bytes;
+                if (prev == nullptr) {
+                    pending = next;
+                } else {
+                    prev->next = next;
+                }
+                cur->next = freed;
+                freed = cur;
             } else {
                 prev = cur;
             }
             cur = next;
         }
-        deletionList.thresholdCounter = 0;
+        if (freed != nullptr) {
+            push(freeLabels, freed);
+            handedOffNodes.fetch_sub(freedNodes, std::memory_order_relaxed);
+            handedOffBytes.fetch_sub(freedBytes, std::memory_order_relaxed);
+        }
+        if (scanned) {
+            recordPass(freedNodes, now() - start);
+        }
+
+        lock.lock();
+    }
+}
+
+inline DeletionList &Epoche::attach() {
+    while (true) {
+        DeletionListBlock *first = deletionListBlocks.load(std::memory_order_acquire);
+        for (DeletionListBlock *block = first; block != nullptr; block = block->next) {
+            for (auto &deletionList : block->deletionLists) {
+                if (deletionList.attached.load(std::memory_order_relaxed)) {
+                    continue;
+                }
+                // the scans stop at used, so it covers the slot before the slot is taken and can enter an epoche
+                std::size_t slot = &deletionList - block->deletionLists.data();
+                std::size_t used = block->used.load();
+                while (used <= slot && !block->used.compare_exchange_weak(used, slot + 1));
+                bool attached = false;
+                if (deletionList.attached.compare_exchange_strong(attached, true, std::memory_order_acquire)) {
+                    deletionList.threadInfos.store(1, std::memory_order_relaxed);
+                    deletionList.owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+                    if (reclaimScheme == ReclaimScheme::QuiescentState) {
+                        // the thread can read nodes from now on without storing its epoche
+                        deletionList.localEpoche.store(currentEpoche.load());
+                    }
+                    return deletionList;
+                }
+            }
+        }
+        // all slots are taken, the new block goes in front unless another thread was faster
+        void *memory = aligned_alloc(alignof(DeletionListBlock), sizeof(DeletionListBlock));
+        auto block = new(memory) DeletionListBlock();
+        block->next = first;
+        if (!deletionListBlocks.compare_exchange_strong(first, block, std::memory_order_acq_rel)) {
+            block->~DeletionListBlock();
+            free(memory);
+        }
     }
 }
 
 inline Epoche::~Epoche() {
-    uint64_t oldestEpoche = std::numeric_limits<uint64_t>::max();
-    for (auto &epoche : deletionLists) {
-        auto e = epoche.localEpoche.load();
-        if (e < oldestEpoche) {
-            oldestEpoche = e;
+    if (reclaimer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(reclaimerMutex);
+            stopReclaimer = true;
         }
+        reclaimerWakeup.notify_one();
+        reclaimer.join();
+    }
+    // no thread uses the tree anymore, everything that is still handed off can be freed
+    for (LabelDelete *labels : {pending, handedOff.load()}) {
+        while (labels != nullptr) {
+            LabelDelete *next = labels->next;
+            for (std::size_t i = 0; i < labels->nodesCount; ++i) {
+                NodeAllocator::deallocate(labels->nodes[i]);
+            }
+            delete labels;
+            labels = next;
+        }
+    }
+    for (LabelDelete *labels = freeLabels.load(), *next; labels != nullptr; labels = next) {
+        next = labels->next;
+        delete labels;
     }
-    for (auto &d : deletionLists) {
-        LabelDelete *cur = d.head(), *next, *prev = nullptr;
-        while (cur != nullptr) {
-            next = cur->next;
 
-            assert(cur->epoche < oldestEpoche);
-            for (std::size_t i = 0; i < cur->nodesCount; ++i) {
-                operator delete(cur->nodes[i]);
+    uint64_t oldestEpoche = getOldestEpoche();
+    DeletionListBlock *block = deletionListBlocks.load(), *next;
+    while (block != nullptr) {
+        for (auto &d : block->deletionLists) {
+            LabelDelete *cur = d.head(), *nextLabel, *prev = nullptr;
+            while (cur != nullptr) {
+                nextLabel = cur->next;
+
+                assert(cur->epoche < oldestEpoche);
+                for (std::size_t i = 0; i < cur->nodesCount; ++i) {
+                    NodeAllocator::deallocate(cur->nodes[i]);
+                }
+                d.remove(cur, prev);
+                cur = nextLabel;
             }
-            d.remove(cur, prev);
-            cur = next;
         }
+        next = block->next;
+        block->~DeletionListBlock();
+        free(block);
+        block = next;
+    }
+    (void) oldestEpoche;
+}
+
+inline void Epoche::pinEpoche(ThreadInfo &epocheInfo) {
+    enterEpoche(epocheInfo);
+    epocheInfo.getDeletionList().pinDepth++;
+}
+
+inline void Epoche::quiescent(ThreadInfo &epocheInfo) {
+    DeletionList &deletionList = epocheInfo.getDeletionList();
+    if (reclaimScheme == ReclaimScheme::QuiescentState && deletionList.pinDepth == 0) {
+        deletionList.localEpoche.store(currentEpoche.load(std::memory_order_relaxed), std::memory_order_release);
+    }
+}
+
+inline void Epoche::leaveEpoche(DeletionList &deletionList) {
+    // the operation is over, with QSBR the thread stays online but has passed a quiescent state
+    if (reclaimScheme == ReclaimScheme::QuiescentState) {
+        deletionList.localEpoche.store(currentEpoche.load(std::memory_order_relaxed), std::memory_order_release);
+    } else {
+        deletionList.localEpoche.store(std::numeric_limits<uint64_t>::max());
+    }
+}
+
+inline bool Epoche::canReclaim(const DeletionList &deletionList) {
+    return deletionList.pinDepth == 0 || (deletionList.pinDepth == 1 && deletionList.sessionRepinInterval != 0);
+}
+
+inline void Epoche::leaveEpocheAndCleanup(DeletionList &deletionList) {
+    leaveEpoche(deletionList);
+
+    cleanup(deletionList);
+    if (deletionList.pinDepth > 0) {
+        continueSession(deletionList);
+    }
+}
+
+inline void Epoche::continueSession(DeletionList &deletionList) {
+    deletionList.sessionOperations = 0;
+    deletionList.localEpoche.store(currentEpoche.load(std::memory_order_relaxed), std::memory_order_release);
+}
+
+inline uint32_t Epoche::beginSession(ThreadInfo &epocheInfo, uint32_t repinInterval) {
+    assert(repinInterval > 0);
+    pinEpoche(epocheInfo);
+    DeletionList &deletionList = epocheInfo.getDeletionList();
+    uint32_t outerRepinInterval = deletionList.sessionRepinInterval;
+    deletionList.sessionRepinInterval = repinInterval;
+    deletionList.sessionOperations = 0;
+    return outerRepinInterval;
+}
+
+inline void Epoche::endSession(ThreadInfo &epocheInfo, uint32_t outerRepinInterval) {
+    DeletionList &deletionList = epocheInfo.getDeletionList();
+    deletionList.sessionRepinInterval = outerRepinInterval;
+    unpinEpoche(epocheInfo);
+    if (deletionList.pinDepth == 0) {
+        // the thread is between operations, it must not hold back reclamation until its next one
+        leaveEpoche(deletionList);
     }
 }
 
+inline void Epoche::unpinEpoche(ThreadInfo &epocheInfo) {
+    assert(epocheInfo.getDeletionList().pinDepth > 0);
+    epocheInfo.getDeletionList().pinDepth--;
+}
+
+inline bool Epoche::repinEpoche(ThreadInfo &epocheInfo) {
+    DeletionList &deletionList = epocheInfo.getDeletionList();
+    assert(deletionList.pinDepth > 0);
+    if (deletionList.pinDepth > 1) {
+        return false;
+    }
+    deletionList.pinDepth = 0;
+    if (reclaimScheme == ReclaimScheme::QuiescentState) {
+        quiescent(epocheInfo);
+    } else {
+        enterEpoche(epocheInfo);
+    }
+    deletionList.pinDepth = 1;
+    return true;
+}
+
 inline void Epoche::showDeleteRatio() {
-    for (auto &d : deletionLists) {
+    forEachDeletionList([](const DeletionList &d) {
         std::cout << "deleted " << d.deleted << " of " << d.added << std::endl;
+    });
+    if (reclaimMode == ReclaimMode::Background) {
+        std::cout << "reclaimer freed " << reclaimedNodes.load() << std::endl;
     }
 }
 
 inline ThreadInfo::ThreadInfo(Epoche &epoche)
-        : epoche(epoche), deletionList(epoche.deletionLists.local()) { }
+        : epoche(epoche), deletionList(epoche.attach()) { }
 
 inline DeletionList &ThreadInfo::getDeletionList() const {
     return deletionList;
@@ -153,4 +668,8 @@ inline Epoche &ThreadInfo::getEpoche() const {
     return epoche;
 }
 
+inline void ThreadInfo::addElements(int64_t delta) {
+    deletionList.addElements(delta);
+}
+
 #endif //EPOCHE_CPP
\ No newline at end of file
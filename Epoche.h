@@ -3,8 +3,17 @@
 
 #include <atomic>
 #include <array>
-#include "tbb/enumerable_thread_specific.h"
-#include "tbb/combinable.h"
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// build with -DART_EPOCHE_ADAPTIVE=0 to advance the epoche every 64 retired nodes of a thread instead
+#ifndef ART_EPOCHE_ADAPTIVE
+#define ART_EPOCHE_ADAPTIVE 1
+#endif
 
 namespace ART {
 
@@ -12,29 +21,144 @@ namespace ART {
         std::array<void*, 32> nodes;
         uint64_t epoche;
         std::size_t nodesCount;
+        std::size_t bytes;
         LabelDelete *next;
     };
 
-    class DeletionList {
+    // the slot of one attached thread in the registry of an Epoche, on cache lines of its own
+    class alignas(64) DeletionList {
         LabelDelete *headDeletionList = nullptr;
         LabelDelete *freeLabelDeletes = nullptr;
-        std::size_t deletitionListCount = 0;
+        std::atomic<std::size_t> deletitionListCount{0};
+
+        // the counters are only written by the thread of the list, but read by others for the stats
+        template<typename T>
+        static void increase(std::atomic<T> &counter, T value);
+
+        template<typename T>
+        static void decrease(std::atomic<T> &counter, T value);
 
     public:
-        std::atomic<uint64_t> localEpoche;
+        std::atomic<uint64_t> localEpoche{std::numeric_limits<uint64_t>::max()};
         size_t thresholdCounter{0};
+        // > 0 while the thread is pinned to localEpoche by pinEpoche
+        size_t pinDepth{0};
+        // set by an EpocheSession, which moves on to the current epoche every this many operations while it is the
+        // only pin
+        uint32_t sessionRepinInterval{0};
+        uint32_t sessionOperations{0};
+
+        // bytes of the nodes in the list, only written by the thread
+        std::atomic<std::size_t> pendingBytes{0};
+        // epoche of the last retired node and the bytes retired in it
+        uint64_t newestEpoche = 0;
+        std::size_t newestEpocheBytes = 0;
+        uint32_t exitsSinceCheck = 0;
+        uint64_t lastCleanup = 0;
+
+        void addElements(int64_t delta);
 
         ~DeletionList();
         LabelDelete *head();
 
-        void add(void *n, uint64_t globalEpoch);
+        void add(void *n, uint64_t globalEpoch, std::size_t bytes);
 
         void remove(LabelDelete *label, LabelDelete *prev);
 
-        std::size_t size();
+        std::size_t size() const;
+
+        // removes all labels from the list and returns them, the reclaimer thread frees them
+        LabelDelete *takeAll();
+
+        // gives the list labels to reuse, e.g. the ones the reclaimer thread has freed
+        void addFreeLabels(LabelDelete *labels);
+
+        bool hasFreeLabels() const;
+
+        std::atomic<std::uint64_t> deleted{0};
+        std::atomic<std::uint64_t> added{0};
+
+        // set while a thread is attached to the slot
+        std::atomic<bool> attached{false};
+        // ThreadInfos that share the slot, the last one detaches the thread
+        std::atomic<uint32_t> threadInfos{0};
+        std::atomic<std::thread::id> owner{std::thread::id()};
+
+        // keys the threads of the slot added to the tree minus the ones they removed, summed by
+        // Epoche::getElementCount. Only the attached thread writes it, so it takes no atomic read-modify-write. It
+        // is last and on a cache line of its own, its writes don't evict the localEpoche that the other threads read.
+        alignas(64) std::atomic<int64_t> elements{0};
+    };
+
+    // fixed number of slots, the registry is a list of them that only grows
+    struct DeletionListBlock {
+        static constexpr std::size_t size = 64;
+
+        std::array<DeletionList, size> deletionLists;
+        // slots that have ever been attached, the scans stop there
+        std::atomic<std::size_t> used{0};
+        DeletionListBlock *next = nullptr;
+    };
+
+    // Inline: the thread whose deletion list passes the threshold frees the nodes that no thread can see anymore.
+    // Background: it hands them to a reclaimer thread of the Epoche, which also advances the epoche.
+    enum class ReclaimMode : uint8_t {
+        Inline,
+        Background
+    };
+
+    // EpochBased: every operation stores the current epoche of its thread when it starts, nodes are freed once
+    // all threads that are in an operation have started after they were retired.
+    // QuiescentState: operations don't store anything, a thread stores the current epoche only when it calls
+    // quiescent() at a point where it holds no nodes, e.g. between requests, or when it reclaims nodes. Nodes are
+    // freed once all threads have passed such a point after they were retired, so every thread that has a
+    // ThreadInfo has to call quiescent() regularly.
+    enum class ReclaimScheme : uint8_t {
+        EpochBased,
+        QuiescentState
+    };
+
+    // retired nodes of one thread and the epoche it is in
+    struct EpocheThreadStats {
+        // id() if the thread has detached, its nodes are left to the next thread in the slot
+        std::thread::id thread;
+        // max if the thread is not in an operation
+        uint64_t epoche;
+        std::size_t pendingNodes;
+        std::size_t pendingBytes;
+        uint64_t retiredNodes;
+        // nodes freed or handed to the reclaimer thread
+        uint64_t freedNodes;
+    };
 
-        std::uint64_t deleted = 0;
-        std::uint64_t added = 0;
+    struct EpocheStats {
+        uint64_t currentEpoche;
+        // nodes retired in or after the oldest epoche of a thread can't be freed yet, currentEpoche if no thread
+        // is in an operation
+        uint64_t oldestEpoche;
+        uint64_t epocheLag;
+        // the thread in oldestEpoche, which holds back reclamation
+        std::thread::id oldestThread;
+        // retired nodes that are not freed yet, of all threads and the reclaimer thread
+        std::size_t pendingNodes;
+        std::size_t pendingBytes;
+        // passes of cleanup or of the reclaimer thread over retired nodes
+        uint64_t reclaimPasses;
+        uint64_t reclaimedNodes;
+        uint64_t reclaimNs;
+        uint64_t lastPassNodes;
+        uint64_t lastPassNs;
+        uint64_t maxPassNs;
+        // 0 if there is none, see Epoche::setRetiredBudget
+        std::size_t retiredBudget;
+        // operations whose writer waited for reclamation because pendingBytes was over the budget, and the time
+        // they waited
+        uint64_t throttledOperations;
+        uint64_t throttleNs;
+        // the thread in the oldest epoche when a writer was last throttled
+        std::thread::id lastBlockingThread;
+        // the attached threads and the detached ones that left retired nodes
+        std::vector<EpocheThreadStats> threads;
     };
 
     class Epoche;
@@ -53,24 +177,118 @@ namespace ART {
         ThreadInfo(Epoche &epoche);
 
         ThreadInfo(const ThreadInfo &ti) : epoche(ti.epoche), deletionList(ti.deletionList) {
+            deletionList.threadInfos++;
         }
 
         ~ThreadInfo();
 
         Epoche & getEpoche() const;
+
+        // counts keys added (delta > 0) or removed (delta < 0) by the thread, see Epoche::getElementCount
+        void addElements(int64_t delta);
     };
 
     class Epoche {
         friend class ThreadInfo;
         std::atomic<uint64_t> currentEpoche{0};
 
-        tbb::enumerable_thread_specific<DeletionList> deletionLists;
+        std::atomic<DeletionListBlock *> deletionListBlocks{nullptr};
 
         size_t startGCThreshhold;
 
+        const ReclaimMode reclaimMode;
+
+        const ReclaimScheme reclaimScheme;
+
+        // labels handed to the reclaimer thread by exitEpocheAndCleanup
+        std::atomic<LabelDelete *> handedOff{nullptr};
+        // labels whose nodes the reclaimer thread has freed, the threads take them all at once to reuse them
+        std::atomic<LabelDelete *> freeLabels{nullptr};
+        // labels the reclaimer thread has taken but not freed yet
+        LabelDelete *pending = nullptr;
+        std::atomic<std::size_t> handedOffNodes{0};
+        std::atomic<std::size_t> handedOffBytes{0};
+
+        std::atomic<uint64_t> reclaimPasses{0};
+        std::atomic<uint64_t> reclaimedNodes{0};
+        std::atomic<uint64_t> reclaimNs{0};
+        std::atomic<uint64_t> lastPassNodes{0};
+        std::atomic<uint64_t> lastPassNs{0};
+        std::atomic<uint64_t> maxPassNs{0};
+
+        std::atomic<std::size_t> retiredBudget{0};
+        std::atomic<uint64_t> throttledOperations{0};
+        std::atomic<uint64_t> throttleNs{0};
+        std::atomic<std::thread::id> lastBlockingThread{std::thread::id()};
+
+        // set while a thread advances the epoche
+        std::atomic<bool> advancing{false};
+        std::atomic<uint64_t> lastAdvance{0};
+        // a thread that retired this many bytes in the current epoche advances it
+        const std::size_t advanceBytes = 16 * 1024;
+
+        std::thread reclaimer;
+        std::mutex reclaimerMutex;
+        std::condition_variable reclaimerWakeup;
+        bool stopReclaimer = false;
+
+        // the reclaimer thread runs this often, threads with retired nodes advance the epoche and clean up at
+        // least this often
+        const std::chrono::milliseconds reclaimInterval{1};
+
+        // a writer waits at most this long per operation for the retired nodes to get under the budget
+        const std::chrono::milliseconds maxThrottle{100};
+
+        // loop of the reclaimer thread, every reclaimInterval it advances the epoche and frees what it can
+        void reclaim();
+
+        void handOff(DeletionList &deletionList);
+
+        // hands off the nodes that threads left in their slots when they detached, for the reclaimer thread
+        void handOffDetached();
+
+        // moves currentEpoche from epoche to the next one unless another thread is doing it
+        void tryAdvance(uint64_t epoche);
+
+        // over the budget the writer advances the epoche and reclaims, or wakes the reclaimer thread, and waits
+        // until the retired nodes fit into the budget again
+        void enforceBudget(DeletionList &deletionList);
+
+        static uint64_t now();
+
+        static void push(std::atomic<LabelDelete *> &labels, LabelDelete *first);
+
+        // finds a free slot for a thread, adds a block if there is none
+        DeletionList &attach();
+
+        void detach(DeletionList &deletionList);
+
+        // frees the nodes of deletionList that were marked before the oldest epoche of all threads
+        void cleanup(DeletionList &deletionList);
+
+        void recordPass(uint64_t nodes, uint64_t ns);
+
+        // the thread is done with its operation before it reclaims nodes
+        void leaveEpoche(DeletionList &deletionList);
+
+        // between operations a thread that is only pinned by a session holds no nodes either
+        static bool canReclaim(const DeletionList &deletionList);
+
+        void leaveEpocheAndCleanup(DeletionList &deletionList);
+
+        // stores the current epoche for the rest of a session
+        void continueSession(DeletionList &deletionList);
+
+        // thread is set to the thread in the oldest epoche
+        uint64_t getOldestEpoche(std::thread::id *thread = nullptr) const;
+
+        template<typename F>
+        void forEachDeletionList(F f) const;
+
 
     public:
-        Epoche(size_t startGCThreshhold) : startGCThreshhold(startGCThreshhold) { }
+        Epoche(size_t startGCThreshhold, ReclaimMode reclaimMode = ReclaimMode::Inline,
+               ReclaimScheme reclaimScheme = ReclaimScheme::EpochBased);
 
         ~Epoche();
 
@@ -80,8 +298,50 @@ namespace ART {
 
         void exitEpocheAndCleanup(ThreadInfo &info);
 
+        // Keeps the thread in its current epoche until the matching unpinEpoche, also across the
+        // enter/exit of operations in between. Nodes are not reclaimed by a pinned thread.
+        void pinEpoche(ThreadInfo &epocheInfo);
+
+        void unpinEpoche(ThreadInfo &epocheInfo);
+
+        // Moves a thread that is pinned once to the current epoche, e.g. a long scan at a point where it holds no
+        // nodes. Returns false if an outer pinEpoche keeps it where it is.
+        bool repinEpoche(ThreadInfo &epocheInfo);
+
+        // with ReclaimScheme::QuiescentState the thread holds no nodes, nothing to do for a pinned thread
+        void quiescent(ThreadInfo &epocheInfo);
+
+        // Pins the thread for the operations until endSession, which then don't store their epoche. Every
+        // repinInterval operations, and when the thread reclaims nodes, the session moves on to the current
+        // epoche, unless another pin (e.g. a cursor) is open. Returns the interval of an outer session.
+        uint32_t beginSession(ThreadInfo &epocheInfo, uint32_t repinInterval);
+
+        void endSession(ThreadInfo &epocheInfo, uint32_t outerRepinInterval);
+
         void showDeleteRatio();
 
+        ReclaimMode getReclaimMode() const;
+
+        ReclaimScheme getReclaimScheme() const;
+
+        // number of times the epoche was advanced
+        uint64_t getEpocheAdvances() const;
+
+        // bytes of the retired nodes that are not freed yet
+        std::size_t getPendingBytes() const;
+
+        // Bytes of retired nodes that may wait to be freed, 0 for no limit. Over it writers reclaim at the end of
+        // every operation and wait for the threads that hold back reclamation, up to maxThrottle per operation.
+        void setRetiredBudget(std::size_t bytes);
+
+        std::size_t getRetiredBudget() const;
+
+        EpocheStats getStats() const;
+
+        // Sum of the elements of all slots, i.e. the keys of the tree, in O(slots). Concurrent operations may be
+        // missing from it, or only some of them, while they run.
+        int64_t getElementCount() const;
+
     };
 
     class EpocheGuard {
@@ -97,6 +357,34 @@ namespace ART {
         }
     };
 
+    /**
+     * Keeps the thread of a ThreadInfo pinned from its construction to its destruction, so that the operations in
+     * between save the store to the thread's epoche. No nodes must be held from one operation to the next, except
+     * by a cursor.
+     */
+    class EpocheSession {
+        ThreadInfo *threadEpocheInfo;
+        uint32_t outerRepinInterval;
+    public:
+
+        EpocheSession(ThreadInfo &threadEpocheInfo, uint32_t repinInterval) : threadEpocheInfo(&threadEpocheInfo) {
+            outerRepinInterval = threadEpocheInfo.getEpoche().beginSession(threadEpocheInfo, repinInterval);
+        }
+
+        EpocheSession(const EpocheSession &) = delete;
+
+        EpocheSession(EpocheSession &&s) : threadEpocheInfo(s.threadEpocheInfo),
+                                           outerRepinInterval(s.outerRepinInterval) {
+            s.threadEpocheInfo = nullptr;
+        }
+
+        ~EpocheSession() {
+            if (threadEpocheInfo != nullptr) {
+                threadEpocheInfo->getEpoche().endSession(*threadEpocheInfo, outerRepinInterval);
+            }
+        }
+    };
+
     class EpocheGuardReadonly {
     public:
 
@@ -109,7 +397,21 @@ namespace ART {
     };
 
     inline ThreadInfo::~ThreadInfo() {
+        if (--deletionList.threadInfos == 0) {
+            epoche.detach(deletionList);
+        } else if (deletionList.pinDepth == 0 && epoche.reclaimScheme == ReclaimScheme::EpochBased) {
+            // with QSBR the other copies may still read nodes without storing their epoche
+            deletionList.localEpoche.store(std::numeric_limits<uint64_t>::max());
+        }
+    }
+
+    inline void Epoche::detach(DeletionList &deletionList) {
+        // the nodes that are still in the list are reclaimed by the next thread in the slot or by ~Epoche, with
+        // ReclaimMode::Background by the reclaimer thread
+        deletionList.pinDepth = 0;
         deletionList.localEpoche.store(std::numeric_limits<uint64_t>::max());
+        deletionList.owner.store(std::thread::id(), std::memory_order_relaxed);
+        deletionList.attached.store(false, std::memory_order_release);
     }
 }
 
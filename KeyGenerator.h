@@ -0,0 +1,239 @@
+//
+// Key and request generators for the benchmark drivers.
+//
+
+#ifndef ART_KEYGENERATOR_H
+#define ART_KEYGENERATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "Key.h"
+
+namespace ART {
+
+    // fmix64 of MurmurHash3, a bijection of the 64 bit numbers
+    inline uint64_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ull;
+        x ^= x >> 33;
+        return x;
+    }
+
+    // per-thread xorshift generator
+    struct Random {
+        uint64_t state;
+
+        explicit Random(uint64_t seed) : state(mix(seed) | 1) { }
+
+        uint64_t next() {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+
+        double nextDouble() {
+            return (next() >> 11) * (1.0 / (1ull << 53));
+        }
+    };
+
+    // ranks 0..n-1 with P(i) ~ 1 / (i + 1)^theta, Gray et al., "Quickly generating billion-record synthetic databases"
+    class Zipfian {
+        uint64_t n;
+        double theta, alpha, zetan, eta;
+
+        // sum of 1 / i^theta for i = 1..n, exact for the first terms and by Euler-Maclaurin above, so that it
+        // costs the same for any n
+        static double zeta(uint64_t n, double theta) {
+            const uint64_t exactTerms = 1 << 16;
+            double sum = 0;
+            for (uint64_t i = 1; i <= std::min(n, exactTerms); ++i) {
+                sum += 1.0 / std::pow(static_cast<double>(i), theta);
+            }
+            if (n > exactTerms) {
+                double m = static_cast<double>(exactTerms), x = static_cast<double>(n);
+                auto f = [theta](double i) { return std::pow(i, -theta); };
+                auto df = [theta](double i) { return -theta * std::pow(i, -theta - 1); };
+                sum += (std::pow(x, 1 - theta) - std::pow(m, 1 - theta)) / (1 - theta) + (f(x) - f(m)) / 2 +
+                       (df(x) - df(m)) / 12;
+            }
+            return sum;
+        }
+
+    public:
+        // 0 < theta < 1, YCSB uses 0.99, n >= 2. Computes the normalization once, the generator can be shared by
+        // all threads.
+        Zipfian(uint64_t n, double theta) : n(n), theta(theta) {
+            if (!(theta > 0 && theta < 1) || n < 2) {
+                throw std::invalid_argument("zipfian needs 0 < theta < 1 and at least 2 items");
+            }
+            alpha = 1.0 / (1.0 - theta);
+            zetan = zeta(n, theta);
+            eta = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta(2, theta) / zetan);
+        }
+
+        uint64_t next(Random &random) const {
+            double u = random.nextDouble();
+            double uz = u * zetan;
+            if (uz < 1.0) {
+                return 0;
+            }
+            if (uz < 1.0 + std::pow(0.5, theta)) {
+                return 1;
+            }
+            return std::min<uint64_t>(n - 1, static_cast<uint64_t>(n * std::pow(eta * u - eta + 1.0, alpha)));
+        }
+    };
+
+    enum class KeyType : uint8_t {
+        // 8 byte integers 1..n
+        Dense,
+        // 8 byte integers, 63 bit hashes of 1..n
+        Sparse,
+        // 8 byte ns timestamps, 1 us apart on average with up to 1 us of jitter, strictly increasing
+        Timestamp,
+        // firstname.lastname<n>@domain, with the terminating 0
+        Email,
+        // https://www.<site>/<section>/<page>-<n>.html, with the terminating 0
+        Url,
+        // random bytes 1..255 with the terminating 0, of 6 to maxLength bytes, the last 4 before the 0 encode n
+        Binary
+    };
+
+    /**
+     * Key of record i, computed from i alone so that any thread can create it and loadKey needs no table of the
+     * keys. The keys of different records are different and none is a prefix of another. The TID of record i can
+     * be i + 1, see load().
+     */
+    class KeyGenerator {
+    public:
+        KeyGenerator(KeyType type, uint32_t maxLength = 256) : type(type), maxLength(maxLength) {
+            if (type == KeyType::Binary && maxLength < 6) {
+                throw std::invalid_argument("binary keys have at least 6 bytes");
+            }
+        }
+
+        KeyType getType() const {
+            return type;
+        }
+
+        void key(uint64_t i, Key &k) const {
+            switch (type) {
+                case KeyType::Dense:
+                    setInteger(i + 1, k);
+                    break;
+                case KeyType::Sparse:
+                    setInteger((mix(i + 1) >> 1) | 1, k);
+                    break;
+                case KeyType::Timestamp:
+                    setInteger(epochNs + i * 1000 + mix(i) % 1000, k);
+                    break;
+                case KeyType::Email:
+                    setEmail(i, k);
+                    break;
+                case KeyType::Url:
+                    setUrl(i, k);
+                    break;
+                case KeyType::Binary:
+                    setBinary(i, k);
+                    break;
+            }
+        }
+
+        // loads the key of TID i + 1
+        void load(uint64_t tid, Key &k) const {
+            key(tid - 1, k);
+        }
+
+        static KeyType parse(const std::string &name) {
+            static const char *names[] = {"dense", "sparse", "timestamp", "email", "url", "binary"};
+            for (unsigned t = 0; t < sizeof(names) / sizeof(names[0]); ++t) {
+                if (name == names[t]) {
+                    return static_cast<KeyType>(t);
+                }
+            }
+            throw std::invalid_argument("unknown keys " + name);
+        }
+
+    private:
+        // 2020-01-01
+        static constexpr uint64_t epochNs = 1577836800ull * 1000000000ull;
+
+        KeyType type;
+        uint32_t maxLength;
+
+        static void setInteger(uint64_t value, Key &k) {
+            k.setKeyLen(sizeof(value));
+            reinterpret_cast<uint64_t *>(&k[0])[0] = __builtin_bswap64(value);
+        }
+
+        // the words and numbers fit, a longer key would not be unique after truncation
+        template<std::size_t N>
+        static void setString(const char (&buffer)[N], int length, Key &k) {
+            if (length < 0 || static_cast<std::size_t>(length) >= N) {
+                throw std::length_error("generated key does not fit into its buffer");
+            }
+            k.set(buffer, static_cast<std::size_t>(length) + 1);
+        }
+
+        // a few common parts, so that the keys share prefixes of very different lengths
+        template<std::size_t N>
+        static const char *pick(const char *const (&words)[N], uint64_t hash) {
+            return words[hash % N];
+        }
+
+        static void setEmail(uint64_t i, Key &k) {
+            static const char *const first[] = {"anna", "ben", "carla", "david", "emma", "felix", "hannah", "jonas",
+                                                "julia", "lukas", "maria", "max", "paul", "sarah", "sophie", "tom"};
+            static const char *const last[] = {"becker", "fischer", "hoffmann", "koch", "meyer", "mueller",
+                                               "schmidt", "schneider", "schulz", "wagner", "weber", "wolf"};
+            static const char *const domains[] = {"gmail.com", "yahoo.com", "outlook.com", "gmx.de", "web.de",
+                                                  "tum.de", "example.org"};
+            uint64_t h = mix(i);
+            char buffer[128];
+            int length = snprintf(buffer, sizeof(buffer), "%s.%s%lu@%s", pick(first, h), pick(last, h >> 16),
+                                  static_cast<unsigned long>(i), pick(domains, h >> 32));
+            setString(buffer, length, k);
+        }
+
+        static void setUrl(uint64_t i, Key &k) {
+            static const char *const sites[] = {"https://www.wikipedia.org", "https://github.com",
+                                                "https://news.ycombinator.com", "https://www.db.in.tum.de",
+                                                "https://stackoverflow.com"};
+            static const char *const sections[] = {"wiki", "questions", "item", "teaching", "research", "blob/master",
+                                                   "users", "tags"};
+            static const char *const pages[] = {"adaptive-radix-tree", "optimistic-lock-coupling", "rowex",
+                                                "index", "concurrency", "b-tree", "hash-table", "memory-reclamation"};
+            uint64_t h = mix(i);
+            char buffer[128];
+            int length = snprintf(buffer, sizeof(buffer), "%s/%s/%s-%lu.html", pick(sites, h),
+                                  pick(sections, h >> 16), pick(pages, h >> 32), static_cast<unsigned long>(i));
+            setString(buffer, length, k);
+        }
+
+        void setBinary(uint64_t i, Key &k) const {
+            uint64_t h = mix(i);
+            uint32_t length = 6 + static_cast<uint32_t>(h % (maxLength - 5));
+            k.setKeyLen(length);
+            Random random(h);
+            for (uint32_t b = 0; b < length - 5; ++b) {
+                k[b] = static_cast<uint8_t>(1 + random.next() % 255);
+            }
+            // base 255 digits + 1, never 0
+            for (uint32_t b = length - 5, n = static_cast<uint32_t>(i); b < length - 1; ++b, n /= 255) {
+                k[b] = static_cast<uint8_t>(1 + n % 255);
+            }
+            k[length - 1] = 0;
+        }
+    };
+}
+
+#endif //ART_KEYGENERATOR_H
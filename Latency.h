@@ -0,0 +1,158 @@
+//
+// Cheap timestamps and log-linear latency histograms for the benchmark drivers.
+//
+
+#ifndef ART_LATENCY_H
+#define ART_LATENCY_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace ART {
+
+    /**
+     * Timestamps in ticks of the time stamp counter on x86, which costs a few ns to read, and in ns of steady_clock
+     * on other CPUs. calibrate() measures the ticks per ns once against steady_clock, it assumes an invariant TSC
+     * that all cores share, which is what x86 CPUs of the last decade have.
+     */
+    class Clock {
+    public:
+        static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+
+        // measures for the given time, called before any thread converts ticks
+        static void calibrate(std::chrono::milliseconds duration = std::chrono::milliseconds(20)) {
+#if defined(__x86_64__) || defined(__i386__)
+            auto start = std::chrono::steady_clock::now();
+            uint64_t startTicks = now();
+            std::this_thread::sleep_for(duration);
+            uint64_t ticks = now() - startTicks;
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            ticksPerNsValue() = ticks / ns;
+#else
+            (void) duration;
+#endif
+        }
+
+        static double ticksPerNs() {
+            return ticksPerNsValue();
+        }
+
+        static double toNs(uint64_t ticks) {
+            return ticks / ticksPerNsValue();
+        }
+
+    private:
+        static double &ticksPerNsValue() {
+            static double ticksPerNs = 1.0;
+            return ticksPerNs;
+        }
+    };
+
+    /**
+     * HDR-style histogram of values up to 2^64: values below 2^subBucketBits have a bucket each, above the buckets
+     * of each power of two split it into 2^(subBucketBits - 1) equal parts, so that a percentile is at most 1/32
+     * above the recorded value. Recording is a count of leading zeros and an increment, each thread records into
+     * its own histogram and they are merged at the end.
+     */
+    class LatencyHistogram {
+    public:
+        static constexpr unsigned subBucketBits = 6;
+        static constexpr uint64_t subBucketCount = 1ull << subBucketBits;
+        static constexpr uint64_t subBucketHalf = subBucketCount / 2;
+        static constexpr std::size_t bucketCount = (64 - subBucketBits + 2) * subBucketHalf;
+
+        LatencyHistogram() : counts(bucketCount, 0) { }
+
+        void record(uint64_t value) {
+            counts[bucketOf(value)]++;
+            count++;
+            sum += value;
+            max = std::max(max, value);
+        }
+
+        void merge(const LatencyHistogram &other) {
+            for (std::size_t i = 0; i < bucketCount; ++i) {
+                counts[i] += other.counts[i];
+            }
+            count += other.count;
+            sum += other.sum;
+            max = std::max(max, other.max);
+        }
+
+        void reset() {
+            std::fill(counts.begin(), counts.end(), 0);
+            count = sum = max = 0;
+        }
+
+        uint64_t getCount() const {
+            return count;
+        }
+
+        uint64_t getMax() const {
+            return max;
+        }
+
+        double getMean() const {
+            return count == 0 ? 0 : static_cast<double>(sum) / count;
+        }
+
+        // highest value of the bucket the fraction p of the values lies in, at most the maximum
+        uint64_t percentile(double p) const {
+            if (count == 0) {
+                return 0;
+            }
+            uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * count + 0.5));
+            uint64_t seen = 0;
+            for (std::size_t i = 0; i < bucketCount; ++i) {
+                seen += counts[i];
+                if (seen >= rank) {
+                    return std::min(max, highestOf(i));
+                }
+            }
+            return max;
+        }
+
+        static std::size_t bucketOf(uint64_t value) {
+            if (value < subBucketCount) {
+                return value;
+            }
+            unsigned msb = 63 - __builtin_clzll(value);
+            unsigned shift = msb - subBucketBits + 1;
+            return (shift + 1) * subBucketHalf + ((value >> shift) - subBucketHalf);
+        }
+
+        static uint64_t lowestOf(std::size_t bucket) {
+            if (bucket < subBucketCount) {
+                return bucket;
+            }
+            unsigned shift = static_cast<unsigned>(bucket / subBucketHalf - 1);
+            return (subBucketHalf + bucket % subBucketHalf) << shift;
+        }
+
+        static uint64_t highestOf(std::size_t bucket) {
+            return bucket + 1 < bucketCount ? lowestOf(bucket + 1) - 1 : UINT64_MAX;
+        }
+
+    private:
+        std::vector<uint64_t> counts;
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+    };
+}
+
+#endif //ART_LATENCY_H
@@ -0,0 +1,446 @@
+//
+// Size-class allocator for the nodes of all tree variants.
+//
+
+#ifndef ART_NODEALLOCATOR_H
+#define ART_NODEALLOCATOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "Numa.h"
+
+// build with -DART_NODE_ALLOCATOR=0 to allocate nodes with plain new/delete
+#ifndef ART_NODE_ALLOCATOR
+#define ART_NODE_ALLOCATOR 1
+#endif
+
+// build with -DART_NUMA=0 to share the free blocks among the memory nodes and not to place chunks on the node of
+// their thread
+#ifndef ART_NUMA
+#define ART_NUMA 1
+#endif
+
+// build with -DART_NUMA_STATS=1 to count the allocations whose block is on another node than the thread
+#ifndef ART_NUMA_STATS
+#define ART_NUMA_STATS 0
+#endif
+
+#if !ART_NODE_ALLOCATOR
+#include <malloc.h>
+#endif
+
+namespace ART {
+
+    struct NodeAllocatorStats {
+        uint64_t allocations;
+        uint64_t deallocations;
+        // memory obtained from the system for chunks (0 without ART_NODE_ALLOCATOR)
+        uint64_t chunkBytes;
+        // with ART_NUMA_STATS, allocations of blocks on the node the thread runs on and on another one
+        uint64_t localAllocations;
+        uint64_t remoteAllocations;
+        // blocks freed by a thread of another node, they go back to the pool of their node
+        uint64_t remoteDeallocations;
+    };
+
+    /**
+     * Nodes are carved from large chunks, one size class per 16 bytes. Freed nodes go to a free list of
+     * the freeing thread (one list per size class) and are moved in batches to a global pool when a thread
+     * collects too many of them, e.g. because it reclaims nodes that other threads allocated.
+     * Chunks are never given back to the system.
+     * With ART_NUMA every memory node has a pool of its own. A thread takes its chunks from the node it first
+     * allocated or freed a block on, and blocks it frees of chunks of another node go back to that node's pool.
+     */
+    class NodeAllocator {
+    public:
+        static constexpr std::size_t chunkSize = 256 * 1024;
+        static constexpr std::size_t chunkHeaderSize = 64;
+        static constexpr std::size_t granularity = 16;
+        static constexpr std::size_t maxBlockSize = 4096;
+        static constexpr std::size_t sizeClasses = maxBlockSize / granularity + 1;
+
+        static void *allocate(std::size_t size);
+
+        static void deallocate(void *p);
+
+        // usable size of a block returned by allocate
+        static std::size_t blockSize(const void *p);
+
+        static NodeAllocatorStats getStats();
+
+    private:
+        // at the start of every chunk, blocks bigger than maxBlockSize get a chunk of their own
+        struct ChunkHeader {
+            std::size_t blockSize;
+            // memory node of the thread that allocated the chunk
+            uint32_t node;
+        };
+
+        struct FreeBlock {
+            FreeBlock *next;
+        };
+
+        struct Batch {
+            FreeBlock *head;
+            uint32_t count;
+        };
+
+        // trivially constructible, so that it stays usable after the thread's destructors have run
+        struct ThreadCache {
+            FreeBlock *freeList[sizeClasses];
+            uint32_t freeCount[sizeClasses];
+            char *bumpCur[sizeClasses];
+            char *bumpEnd[sizeClasses];
+            // freed blocks of other nodes, they go back to their pools in batches
+            FreeBlock *remoteList[sizeClasses];
+            uint32_t remoteCount[sizeClasses];
+            uint64_t allocations;
+            uint64_t deallocations;
+            uint64_t localAllocations;
+            uint64_t remoteAllocations;
+            uint64_t remoteDeallocations;
+            uint32_t node;
+            bool registered;
+            bool exited;
+        };
+
+        struct CacheFlusher {
+            ~CacheFlusher();
+        };
+
+        struct NodePool {
+            std::mutex mutex;
+            std::vector<Batch> batches[sizeClasses];
+        };
+
+        struct GlobalPool {
+            // one per memory node with ART_NUMA, else one for all
+            std::vector<NodePool> nodePools;
+            std::atomic<uint64_t> allocations{0};
+            std::atomic<uint64_t> deallocations{0};
+            std::atomic<uint64_t> chunkBytes{0};
+            std::atomic<uint64_t> localAllocations{0};
+            std::atomic<uint64_t> remoteAllocations{0};
+            std::atomic<uint64_t> remoteDeallocations{0};
+
+            GlobalPool(unsigned nodes) : nodePools(nodes) { }
+        };
+
+        static constexpr uint64_t counterFlushInterval = 1024;
+
+        static ThreadCache &threadCache();
+
+        static GlobalPool &globalPool();
+
+        static void registerThread(ThreadCache &cache);
+
+        // the pool of the blocks of a chunk on node
+        static NodePool &nodePool(uint32_t node);
+
+        static bool isLocal(const ThreadCache &cache, const ChunkHeader *chunk);
+
+        static std::size_t sizeClass(std::size_t size);
+
+        static uint32_t batchSize(std::size_t sc);
+
+        static ChunkHeader *chunkOf(const void *p);
+
+        static void *allocateChunk(std::size_t blockSize, std::size_t bytes, uint32_t node);
+
+        static void *refill(ThreadCache &cache, std::size_t sc);
+
+        static void spill(ThreadCache &cache, std::size_t sc, uint32_t count);
+
+        // returns the blocks of remoteList to the pools of their nodes
+        static void spillRemote(ThreadCache &cache, std::size_t sc);
+
+        static void flushCounters(ThreadCache &cache);
+    };
+
+    inline NodeAllocator::ThreadCache &NodeAllocator::threadCache() {
+        static thread_local ThreadCache cache;
+        return cache;
+    }
+
+    inline NodeAllocator::GlobalPool &NodeAllocator::globalPool() {
+        // never destroyed: trees can outlive every other static object
+        static GlobalPool *pool = new GlobalPool(ART_NUMA ? NumaTopology::get().nodeCount() : 1);
+        return *pool;
+    }
+
+    inline void NodeAllocator::registerThread(ThreadCache &cache) {
+        static thread_local CacheFlusher flusher;
+        (void) flusher;
+        cache.node = NumaTopology::get().currentNode();
+        cache.registered = true;
+    }
+
+    inline NodeAllocator::NodePool &NodeAllocator::nodePool(uint32_t node) {
+#if ART_NUMA
+        return globalPool().nodePools[node];
+#else
+        (void) node;
+        return globalPool().nodePools[0];
+#endif
+    }
+
+    inline bool NodeAllocator::isLocal(const ThreadCache &cache, const ChunkHeader *chunk) {
+#if ART_NUMA
+        return chunk->node == cache.node;
+#else
+        (void) cache;
+        (void) chunk;
+        return true;
+#endif
+    }
+
+    inline std::size_t NodeAllocator::sizeClass(std::size_t size) {
+        return (size + granularity - 1) / granularity;
+    }
+
+    inline uint32_t NodeAllocator::batchSize(std::size_t sc) {
+        std::size_t blocks = (64 * 1024) / (sc * granularity);
+        return static_cast<uint32_t>(blocks < 32 ? 32 : blocks);
+    }
+
+    inline NodeAllocator::ChunkHeader *NodeAllocator::chunkOf(const void *p) {
+        return reinterpret_cast<ChunkHeader *>(reinterpret_cast<uintptr_t>(p) & ~(chunkSize - 1));
+    }
+
+    inline void *NodeAllocator::allocateChunk(std::size_t blockSize, std::size_t bytes, uint32_t node) {
+        void *chunk = aligned_alloc(chunkSize, bytes);
+        if (chunk == nullptr) {
+            throw std::bad_alloc();
+        }
+#if ART_NUMA
+        // before the header is written, so that the first page is placed on the node as well
+        NumaTopology::get().prefer(chunk, bytes, node);
+#endif
+        reinterpret_cast<ChunkHeader *>(chunk)->blockSize = blockSize;
+        reinterpret_cast<ChunkHeader *>(chunk)->node = node;
+        globalPool().chunkBytes.fetch_add(bytes, std::memory_order_relaxed);
+        return chunk;
+    }
+
+    inline void *NodeAllocator::refill(ThreadCache &cache, std::size_t sc) {
+        {
+            NodePool &pool = nodePool(cache.node);
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            if (!pool.batches[sc].empty()) {
+                Batch batch = pool.batches[sc].back();
+                pool.batches[sc].pop_back();
+                cache.freeList[sc] = batch.head->next;
+                cache.freeCount[sc] = batch.count - 1;
+                return batch.head;
+            }
+        }
+        char *chunk = static_cast<char *>(allocateChunk(sc * granularity, chunkSize, cache.node));
+        cache.bumpCur[sc] = chunk + chunkHeaderSize + sc * granularity;
+        cache.bumpEnd[sc] = chunk + chunkSize;
+        return chunk + chunkHeaderSize;
+    }
+
+    inline void NodeAllocator::spill(ThreadCache &cache, std::size_t sc, uint32_t count) {
+        Batch batch{cache.freeList[sc], count};
+        FreeBlock *last = batch.head;
+        for (uint32_t i = 1; i < count; ++i) {
+            last = last->next;
+        }
+        cache.freeList[sc] = last->next;
+        cache.freeCount[sc] -= count;
+        last->next = nullptr;
+
+        NodePool &pool = nodePool(cache.node);
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.batches[sc].push_back(batch);
+    }
+
+    inline void NodeAllocator::spillRemote(ThreadCache &cache, std::size_t sc) {
+        std::vector<Batch> batches(globalPool().nodePools.size(), Batch{nullptr, 0});
+        FreeBlock *b = cache.remoteList[sc];
+        while (b != nullptr) {
+            FreeBlock *next = b->next;
+            Batch &batch = batches[ART_NUMA ? chunkOf(b)->node : 0];
+            b->next = batch.head;
+            batch.head = b;
+            batch.count++;
+            b = next;
+        }
+        cache.remoteList[sc] = nullptr;
+        cache.remoteCount[sc] = 0;
+        for (uint32_t node = 0; node < batches.size(); ++node) {
+            if (batches[node].count > 0) {
+                NodePool &pool = nodePool(node);
+                std::lock_guard<std::mutex> lock(pool.mutex);
+                pool.batches[sc].push_back(batches[node]);
+            }
+        }
+    }
+
+    inline void NodeAllocator::flushCounters(ThreadCache &cache) {
+        GlobalPool &pool = globalPool();
+        pool.allocations.fetch_add(cache.allocations, std::memory_order_relaxed);
+        pool.deallocations.fetch_add(cache.deallocations, std::memory_order_relaxed);
+        pool.localAllocations.fetch_add(cache.localAllocations, std::memory_order_relaxed);
+        pool.remoteAllocations.fetch_add(cache.remoteAllocations, std::memory_order_relaxed);
+        pool.remoteDeallocations.fetch_add(cache.remoteDeallocations, std::memory_order_relaxed);
+        cache.allocations = 0;
+        cache.deallocations = 0;
+        cache.localAllocations = 0;
+        cache.remoteAllocations = 0;
+        cache.remoteDeallocations = 0;
+    }
+
+    inline NodeAllocator::CacheFlusher::~CacheFlusher() {
+        ThreadCache &cache = threadCache();
+        for (std::size_t sc = 1; sc < sizeClasses; ++sc) {
+            if (cache.freeCount[sc] > 0) {
+                spill(cache, sc, cache.freeCount[sc]);
+            }
+            if (cache.remoteCount[sc] > 0) {
+                spillRemote(cache, sc);
+            }
+            // the untouched rest of the current chunk becomes a batch as well
+            std::size_t blockSize = sc * granularity;
+            FreeBlock *head = nullptr;
+            uint32_t count = 0;
+            while (cache.bumpCur[sc] != nullptr && cache.bumpCur[sc] + blockSize <= cache.bumpEnd[sc]) {
+                FreeBlock *b = reinterpret_cast<FreeBlock *>(cache.bumpCur[sc]);
+                b->next = head;
+                head = b;
+                count++;
+                cache.bumpCur[sc] += blockSize;
+            }
+            if (count > 0) {
+                NodePool &pool = nodePool(cache.node);
+                std::lock_guard<std::mutex> lock(pool.mutex);
+                pool.batches[sc].push_back(Batch{head, count});
+            }
+        }
+        flushCounters(cache);
+        cache.exited = true;
+    }
+
+    inline void *NodeAllocator::allocate(std::size_t size) {
+        ThreadCache &cache = threadCache();
+        if (++cache.allocations == counterFlushInterval) {
+            flushCounters(cache);
+        }
+#if ART_NODE_ALLOCATOR
+        std::size_t sc = sizeClass(size);
+        if (sc >= sizeClasses) {
+            std::size_t bytes = (size + chunkHeaderSize + chunkSize - 1) & ~(chunkSize - 1);
+            return static_cast<char *>(allocateChunk(size, bytes, NumaTopology::get().currentNode())) +
+                   chunkHeaderSize;
+        }
+        if (!cache.registered) {
+            registerThread(cache);
+        }
+        void *p;
+        if (cache.exited) {
+            // thread is shutting down, bypass the free lists
+            NodePool &pool = nodePool(cache.node);
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            if (!pool.batches[sc].empty()) {
+                Batch &batch = pool.batches[sc].back();
+                FreeBlock *b = batch.head;
+                batch.head = b->next;
+                if (--batch.count == 0) {
+                    pool.batches[sc].pop_back();
+                }
+                return b;
+            }
+            return static_cast<char *>(allocateChunk(sc * granularity, chunkSize, cache.node)) + chunkHeaderSize;
+        }
+        FreeBlock *b = cache.freeList[sc];
+        if (b != nullptr) {
+            cache.freeList[sc] = b->next;
+            cache.freeCount[sc]--;
+            p = b;
+        } else if (cache.bumpCur[sc] != nullptr && cache.bumpCur[sc] + sc * granularity <= cache.bumpEnd[sc]) {
+            p = cache.bumpCur[sc];
+            cache.bumpCur[sc] += sc * granularity;
+        } else {
+            p = refill(cache, sc);
+        }
+#if ART_NUMA_STATS
+        if (chunkOf(p)->node == NumaTopology::get().currentNode()) {
+            cache.localAllocations++;
+        } else {
+            cache.remoteAllocations++;
+        }
+#endif
+        return p;
+#else
+        return ::operator new(size);
+#endif
+    }
+
+    inline void NodeAllocator::deallocate(void *p) {
+        ThreadCache &cache = threadCache();
+        if (++cache.deallocations == counterFlushInterval) {
+            flushCounters(cache);
+        }
+#if ART_NODE_ALLOCATOR
+        ChunkHeader *chunk = chunkOf(p);
+        if (chunk->blockSize > maxBlockSize) {
+            globalPool().chunkBytes.fetch_sub((chunk->blockSize + chunkHeaderSize + chunkSize - 1) & ~(chunkSize - 1),
+                                              std::memory_order_relaxed);
+            free(chunk);
+            return;
+        }
+        std::size_t sc = chunk->blockSize / granularity;
+        FreeBlock *b = static_cast<FreeBlock *>(p);
+        if (!cache.registered) {
+            registerThread(cache);
+        }
+        if (cache.exited) {
+            NodePool &pool = nodePool(chunk->node);
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            b->next = nullptr;
+            pool.batches[sc].push_back(Batch{b, 1});
+            return;
+        }
+        if (chunk->node != cache.node) {
+            cache.remoteDeallocations++;
+        }
+        if (!isLocal(cache, chunk)) {
+            b->next = cache.remoteList[sc];
+            cache.remoteList[sc] = b;
+            if (++cache.remoteCount[sc] >= batchSize(sc)) {
+                spillRemote(cache, sc);
+            }
+            return;
+        }
+        b->next = cache.freeList[sc];
+        cache.freeList[sc] = b;
+        if (++cache.freeCount[sc] >= 2 * batchSize(sc)) {
+            spill(cache, sc, batchSize(sc));
+        }
+#else
+        ::operator delete(p);
+#endif
+    }
+
+    inline std::size_t NodeAllocator::blockSize(const void *p) {
+#if ART_NODE_ALLOCATOR
+        return chunkOf(p)->blockSize;
+#else
+        return malloc_usable_size(const_cast<void *>(p));
+#endif
+    }
+
+    inline NodeAllocatorStats NodeAllocator::getStats() {
+        flushCounters(threadCache());
+        GlobalPool &pool = globalPool();
+        return NodeAllocatorStats{pool.allocations.load(), pool.deallocations.load(), pool.chunkBytes.load(),
+                                  pool.localAllocations.load(), pool.remoteAllocations.load(),
+                                  pool.remoteDeallocations.load()};
+    }
+}
+
+#endif //ART_NODEALLOCATOR_H
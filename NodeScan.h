@@ -0,0 +1,279 @@
+//
+// Scans over the 256 slots of N48 and N256 for all tree variants.
+//
+
+#ifndef ART_NODESCAN_H
+#define ART_NODESCAN_H
+
+#include <stdint.h>
+
+// build with -DART_NODE_SCAN_SIMD=0 to test the slots one by one, the default on other architectures than x86-64
+#ifndef ART_NODE_SCAN_SIMD
+#if defined(__x86_64__) && defined(__GNUC__)
+#define ART_NODE_SCAN_SIMD 1
+#else
+#define ART_NODE_SCAN_SIMD 0
+#endif
+#endif
+
+#if ART_NODE_SCAN_SIMD
+#include <immintrin.h>
+#endif
+
+namespace ART {
+
+    enum class NodeScanIsa : uint8_t {
+        Scalar,
+        AVX2,
+        AVX512
+    };
+
+    /**
+     * Builds bitmaps of the used slots of N48::childIndex and N256::children, 64 slots at a time, with 32 or 64
+     * byte compares, and iterates over their set bits instead of testing every slot. The best implementation the
+     * CPU supports is chosen at runtime.
+     */
+    class NodeScan {
+    public:
+        // bit i is set if the byte index[i] is not emptyMarker, for the 64 bytes at index
+        static uint64_t usedIndexes(const void *index, uint8_t emptyMarker);
+
+        // bit i is set if the pointer children[i] is not null, for the 64 pointers at children
+        static uint64_t usedChildren(const void *children);
+
+        // calls f(i) for the used slots i in [start, end], in ascending order, until f returns false
+        template<typename F>
+        static void forEachIndex(const void *index, uint8_t emptyMarker, unsigned start, unsigned end, F f);
+
+        // same in descending order
+        template<typename F>
+        static void forEachIndexReverse(const void *index, uint8_t emptyMarker, unsigned start, unsigned end, F f);
+
+        template<typename F>
+        static void forEachChild(const void *children, unsigned start, unsigned end, F f);
+
+        template<typename F>
+        static void forEachChildReverse(const void *children, unsigned start, unsigned end, F f);
+
+        static NodeScanIsa getIsa();
+
+        // switches to isa if the CPU supports it, e.g. for benchmarks, returns the one in use. The scans read the
+        // choice without synchronization, so it must be called before any tree is used by several threads.
+        static NodeScanIsa setIsa(NodeScanIsa isa);
+
+    private:
+        struct Kernels {
+            NodeScanIsa isa;
+            uint64_t (*usedIndexes)(const void *index, uint8_t emptyMarker);
+            uint64_t (*usedChildren)(const void *children);
+        };
+
+        static Kernels &kernels();
+
+        static bool isSupported(NodeScanIsa isa);
+
+        static Kernels kernelsFor(NodeScanIsa isa);
+
+        template<typename Word, typename F>
+        static void forEachBit(Word word, unsigned start, unsigned end, F f);
+
+        template<typename Word, typename F>
+        static void forEachBitReverse(Word word, unsigned start, unsigned end, F f);
+
+        static uint64_t usedIndexesScalar(const void *index, uint8_t emptyMarker);
+
+        static uint64_t usedChildrenScalar(const void *children);
+
+#if ART_NODE_SCAN_SIMD
+        static uint64_t usedIndexesAVX2(const void *index, uint8_t emptyMarker);
+
+        static uint64_t usedChildrenAVX2(const void *children);
+
+        static uint64_t usedIndexesAVX512(const void *index, uint8_t emptyMarker);
+
+        static uint64_t usedChildrenAVX512(const void *children);
+#endif
+    };
+
+    inline uint64_t NodeScan::usedIndexesScalar(const void *index, uint8_t emptyMarker) {
+        auto bytes = static_cast<const uint8_t *>(index);
+        uint64_t bits = 0;
+        for (unsigned i = 0; i < 64; ++i) {
+            bits |= static_cast<uint64_t>(bytes[i] != emptyMarker) << i;
+        }
+        return bits;
+    }
+
+    inline uint64_t NodeScan::usedChildrenScalar(const void *children) {
+        auto pointers = static_cast<const uintptr_t *>(children);
+        uint64_t bits = 0;
+        for (unsigned i = 0; i < 64; ++i) {
+            bits |= static_cast<uint64_t>(pointers[i] != 0) << i;
+        }
+        return bits;
+    }
+
+#if ART_NODE_SCAN_SIMD
+    __attribute__((target("avx2")))
+    inline uint64_t NodeScan::usedIndexesAVX2(const void *index, uint8_t emptyMarker) {
+        auto p = static_cast<const __m256i *>(index);
+        const __m256i marker = _mm256_set1_epi8(emptyMarker);
+        uint32_t low = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(p), marker));
+        uint32_t high = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(p + 1), marker));
+        return ~(static_cast<uint64_t>(high) << 32 | low);
+    }
+
+    __attribute__((target("avx2")))
+    inline uint64_t NodeScan::usedChildrenAVX2(const void *children) {
+        auto p = static_cast<const __m256i *>(children);
+        const __m256i zero = _mm256_setzero_si256();
+        uint64_t empty = 0;
+        for (unsigned i = 0; i < 16; ++i) {
+            __m256i cmp = _mm256_cmpeq_epi64(_mm256_loadu_si256(p + i), zero);
+            empty |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(cmp))) << (4 * i);
+        }
+        return ~empty;
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    inline uint64_t NodeScan::usedIndexesAVX512(const void *index, uint8_t emptyMarker) {
+        return _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(index), _mm512_set1_epi8(emptyMarker));
+    }
+
+    __attribute__((target("avx512f")))
+    inline uint64_t NodeScan::usedChildrenAVX512(const void *children) {
+        auto p = static_cast<const __m512i *>(children);
+        uint64_t used = 0;
+        for (unsigned i = 0; i < 8; ++i) {
+            __m512i v = _mm512_loadu_si512(p + i);
+            used |= static_cast<uint64_t>(_mm512_test_epi64_mask(v, v)) << (8 * i);
+        }
+        return used;
+    }
+#endif
+
+    inline bool NodeScan::isSupported(NodeScanIsa isa) {
+#if ART_NODE_SCAN_SIMD
+        __builtin_cpu_init();
+        switch (isa) {
+            case NodeScanIsa::Scalar:
+                return true;
+            case NodeScanIsa::AVX2:
+                return __builtin_cpu_supports("avx2");
+            case NodeScanIsa::AVX512:
+                return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+        }
+        return false;
+#else
+        return isa == NodeScanIsa::Scalar;
+#endif
+    }
+
+    inline NodeScan::Kernels NodeScan::kernelsFor(NodeScanIsa isa) {
+        switch (isa) {
+#if ART_NODE_SCAN_SIMD
+            case NodeScanIsa::AVX512:
+                return Kernels{isa, usedIndexesAVX512, usedChildrenAVX512};
+            case NodeScanIsa::AVX2:
+                return Kernels{isa, usedIndexesAVX2, usedChildrenAVX2};
+#endif
+            default:
+                return Kernels{NodeScanIsa::Scalar, usedIndexesScalar, usedChildrenScalar};
+        }
+    }
+
+    inline NodeScan::Kernels &NodeScan::kernels() {
+        static Kernels k = kernelsFor(isSupported(NodeScanIsa::AVX512) ? NodeScanIsa::AVX512 :
+                                      isSupported(NodeScanIsa::AVX2) ? NodeScanIsa::AVX2 : NodeScanIsa::Scalar);
+        return k;
+    }
+
+    inline NodeScanIsa NodeScan::getIsa() {
+        return kernels().isa;
+    }
+
+    inline NodeScanIsa NodeScan::setIsa(NodeScanIsa isa) {
+        if (isSupported(isa)) {
+            kernels() = kernelsFor(isa);
+        }
+        return getIsa();
+    }
+
+    inline uint64_t NodeScan::usedIndexes(const void *index, uint8_t emptyMarker) {
+        return kernels().usedIndexes(index, emptyMarker);
+    }
+
+    inline uint64_t NodeScan::usedChildren(const void *children) {
+        return kernels().usedChildren(children);
+    }
+
+    template<typename Word, typename F>
+    inline void NodeScan::forEachBit(Word word, unsigned start, unsigned end, F f) {
+        for (unsigned w = start / 64; w <= end / 64; ++w) {
+            uint64_t bits = word(w);
+            if (w == start / 64) {
+                bits &= ~0ul << (start % 64);
+            }
+            if (w == end / 64) {
+                bits &= ~0ul >> (63 - end % 64);
+            }
+            while (bits != 0) {
+                if (!f(w * 64 + __builtin_ctzll(bits))) {
+                    return;
+                }
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    template<typename Word, typename F>
+    inline void NodeScan::forEachBitReverse(Word word, unsigned start, unsigned end, F f) {
+        for (unsigned w = end / 64 + 1; w-- > start / 64;) {
+            uint64_t bits = word(w);
+            if (w == start / 64) {
+                bits &= ~0ul << (start % 64);
+            }
+            if (w == end / 64) {
+                bits &= ~0ul >> (63 - end % 64);
+            }
+            while (bits != 0) {
+                unsigned bit = 63 - __builtin_clzll(bits);
+                if (!f(w * 64 + bit)) {
+                    return;
+                }
+                bits &= ~(1ul << bit);
+            }
+        }
+    }
+
+    template<typename F>
+    inline void NodeScan::forEachIndex(const void *index, uint8_t emptyMarker, unsigned start, unsigned end, F f) {
+        auto kernel = kernels().usedIndexes;
+        forEachBit([&](unsigned w) { return kernel(static_cast<const uint8_t *>(index) + w * 64, emptyMarker); },
+                   start, end, f);
+    }
+
+    template<typename F>
+    inline void NodeScan::forEachIndexReverse(const void *index, uint8_t emptyMarker, unsigned start, unsigned end,
+                                              F f) {
+        auto kernel = kernels().usedIndexes;
+        forEachBitReverse([&](unsigned w) { return kernel(static_cast<const uint8_t *>(index) + w * 64, emptyMarker); },
+                          start, end, f);
+    }
+
+    template<typename F>
+    inline void NodeScan::forEachChild(const void *children, unsigned start, unsigned end, F f) {
+        auto kernel = kernels().usedChildren;
+        forEachBit([&](unsigned w) { return kernel(static_cast<const uintptr_t *>(children) + w * 64); },
+                   start, end, f);
+    }
+
+    template<typename F>
+    inline void NodeScan::forEachChildReverse(const void *children, unsigned start, unsigned end, F f) {
+        auto kernel = kernels().usedChildren;
+        forEachBitReverse([&](unsigned w) { return kernel(static_cast<const uintptr_t *>(children) + w * 64); },
+                          start, end, f);
+    }
+}
+
+#endif //ART_NODESCAN_H
@@ -0,0 +1,167 @@
+//
+// NUMA topology from sysfs, for the node placement of NodeAllocator.
+//
+
+#ifndef ART_NUMA_H
+#define ART_NUMA_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ART {
+
+    /**
+     * The memory nodes of the machine and their CPUs, read from /sys/devices/system/node without libnuma. Nodes
+     * are numbered 0..nodeCount()-1 here, nodeId() is the number of the kernel. On other systems than Linux, or
+     * if sysfs can't be read, there is a single node with all CPUs.
+     */
+    class NumaTopology {
+    public:
+        static const NumaTopology &get();
+
+        // reads the topology below root, e.g. a copy of the sysfs directory
+        static NumaTopology load(const std::string &root);
+
+        unsigned nodeCount() const;
+
+        int nodeId(unsigned node) const;
+
+        unsigned nodeOfCpu(int cpu) const;
+
+        // node of the CPU the calling thread runs on
+        unsigned currentNode() const;
+
+        // makes node the preferred node of the pages of [p, p + bytes), p has to be page aligned
+        bool prefer(void *p, std::size_t bytes, unsigned node) const;
+
+    private:
+        std::vector<int> nodeIds;
+        // cpu -> node
+        std::vector<unsigned> cpuNodes;
+
+        static bool readLine(const std::string &path, std::string &line);
+
+        // parses lists like "0-3,8,10-11"
+        static std::vector<int> parseList(const std::string &list);
+    };
+
+    inline const NumaTopology &NumaTopology::get() {
+        // never destroyed, like the pools of NodeAllocator
+        static NumaTopology *topology = new NumaTopology(load("/sys/devices/system/node"));
+        return *topology;
+    }
+
+    inline bool NumaTopology::readLine(const std::string &path, std::string &line) {
+        FILE *f = fopen(path.c_str(), "r");
+        if (f == nullptr) {
+            return false;
+        }
+        char buffer[4096];
+        bool ok = fgets(buffer, sizeof(buffer), f) != nullptr;
+        fclose(f);
+        line = ok ? buffer : "";
+        return ok;
+    }
+
+    inline std::vector<int> NumaTopology::parseList(const std::string &list) {
+        std::vector<int> values;
+        std::size_t pos = 0;
+        while (pos < list.size()) {
+            std::size_t end = list.find(',', pos);
+            if (end == std::string::npos) {
+                end = list.size();
+            }
+            int first, last;
+            int fields = sscanf(list.substr(pos, end - pos).c_str(), "%d-%d", &first, &last);
+            if (fields >= 1) {
+                for (int v = first; v <= (fields == 2 ? last : first); ++v) {
+                    values.push_back(v);
+                }
+            }
+            pos = end + 1;
+        }
+        return values;
+    }
+
+    inline NumaTopology NumaTopology::load(const std::string &root) {
+        NumaTopology topology;
+#if defined(__linux__)
+        std::string line;
+        if (readLine(root + "/online", line)) {
+            for (int id : parseList(line)) {
+                std::string cpus;
+                if (!readLine(root + "/node" + std::to_string(id) + "/cpulist", cpus)) {
+                    continue;
+                }
+                unsigned node = static_cast<unsigned>(topology.nodeIds.size());
+                topology.nodeIds.push_back(id);
+                for (int cpu : parseList(cpus)) {
+                    if (topology.cpuNodes.size() <= static_cast<std::size_t>(cpu)) {
+                        topology.cpuNodes.resize(cpu + 1, 0);
+                    }
+                    topology.cpuNodes[cpu] = node;
+                }
+            }
+        }
+#else
+        (void) root;
+#endif
+        if (topology.nodeIds.empty()) {
+            topology.nodeIds.push_back(0);
+            topology.cpuNodes.clear();
+        }
+        return topology;
+    }
+
+    inline unsigned NumaTopology::nodeCount() const {
+        return static_cast<unsigned>(nodeIds.size());
+    }
+
+    inline int NumaTopology::nodeId(unsigned node) const {
+        return nodeIds[node];
+    }
+
+    inline unsigned NumaTopology::nodeOfCpu(int cpu) const {
+        return cpu >= 0 && static_cast<std::size_t>(cpu) < cpuNodes.size() ? cpuNodes[cpu] : 0;
+    }
+
+    inline unsigned NumaTopology::currentNode() const {
+#if defined(__linux__)
+        return nodeCount() > 1 ? nodeOfCpu(sched_getcpu()) : 0;
+#else
+        return 0;
+#endif
+    }
+
+    inline bool NumaTopology::prefer(void *p, std::size_t bytes, unsigned node) const {
+#if defined(__linux__) && defined(SYS_mbind)
+        if (nodeCount() < 2) {
+            return false;
+        }
+        // MPOL_PREFERRED of linux/mempolicy.h: the pages fall back to other nodes if this one is full,
+        // MPOL_MF_MOVE: pages that were touched before are moved
+        const int preferred = 1;
+        const unsigned move = 2;
+        const int id = nodeId(node);
+        std::vector<unsigned long> mask(id / (8 * sizeof(unsigned long)) + 1, 0);
+        mask[id / (8 * sizeof(unsigned long))] = 1ul << (id % (8 * sizeof(unsigned long)));
+        return syscall(SYS_mbind, p, bytes, preferred, mask.data(), mask.size() * 8 * sizeof(unsigned long) + 1,
+                       move) == 0;
+#else
+        (void) p;
+        (void) bytes;
+        (void) node;
+        return false;
+#endif
+    }
+}
+
+#endif //ART_NUMA_H
@@ -1,9 +1,11 @@
 #include <assert.h>
 #include <algorithm>
+#include <vector>
 
 #include "N.h"
 #include "N4.cpp"
 #include "N16.cpp"
+#include "N32.cpp"
 #include "N48.cpp"
 #include "N256.cpp"
 
@@ -22,11 +24,11 @@ namespace ART_OLC {
     }
 
     uint64_t N::convertTypeToVersion(NTypes type) {
-        return (static_cast<uint64_t>(type) << 62);
+        return (static_cast<uint64_t>(type) << 61);
     }
 
     NTypes N::getType() const {
-        return static_cast<NTypes>(typeVersionLockObsolete.load(std::memory_order_relaxed) >> 62);
+        return static_cast<NTypes>(typeVersionLockObsolete.load(std::memory_order_relaxed) >> 61);
     }
 
     void N::writeLockOrRestart(bool &needRestart) {
@@ -61,6 +63,10 @@ namespace ART_OLC {
                 auto n = static_cast<const N16 *>(node);
                 return n->getAnyChild();
             }
+            case NTypes::N32: {
+                auto n = static_cast<const N32 *>(node);
+                return n->getAnyChild();
+            }
             case NTypes::N48: {
                 auto n = static_cast<const N48 *>(node);
                 return n->getAnyChild();
@@ -84,6 +90,10 @@ namespace ART_OLC {
                 auto n = static_cast<N16 *>(node);
                 return n->change(key, val);
             }
+            case NTypes::N32: {
+                auto n = static_cast<N32 *>(node);
+                return n->change(key, val);
+            }
             case NTypes::N48: {
                 auto n = static_cast<N48 *>(node);
                 return n->change(key, val);
@@ -152,7 +162,7 @@ namespace ART_OLC {
         N::change(parentNode, keyParent, nBig);
 		if(!transactional){
         	n->writeUnlockObsolete();
-			threadInfo.getEpoche().markNodeForDeletion(n, threadInfo);
+			N::markNodeForDeletion(n, threadInfo);
 			parentNode->writeUnlock();
 		}
 		else{
@@ -171,7 +181,16 @@ namespace ART_OLC {
             }
             case NTypes::N16: {
                 auto n = static_cast<N16 *>(node);
+#if ART_OLC_N32
+                insertGrow<N16, N32>(n, v, parentNode, parentVersion, keyParent, key, val, needRestart, t_info, threadInfo);
+#else
                 insertGrow<N16, N48>(n, v, parentNode, parentVersion, keyParent, key, val, needRestart, t_info, threadInfo);
+#endif
+                break;
+            }
+            case NTypes::N32: {
+                auto n = static_cast<N32 *>(node);
+                insertGrow<N32, N48>(n, v, parentNode, parentVersion, keyParent, key, val, needRestart, t_info, threadInfo);
                 break;
             }
             case NTypes::N48: {
@@ -197,6 +216,10 @@ namespace ART_OLC {
                 auto n = static_cast<const N16 *>(node);
                 return n->getChild(k);
             }
+            case NTypes::N32: {
+                auto n = static_cast<const N32 *>(node);
+                return n->getChild(k);
+            }
             case NTypes::N48: {
                 auto n = static_cast<const N48 *>(node);
                 return n->getChild(k);
@@ -225,6 +248,11 @@ namespace ART_OLC {
                 n->deleteChildren();
                 return;
             }
+            case NTypes::N32: {
+                auto n = static_cast<N32 *>(node);
+                n->deleteChildren();
+                return;
+            }
             case NTypes::N48: {
                 auto n = static_cast<N48 *>(node);
                 n->deleteChildren();
@@ -268,7 +296,7 @@ namespace ART_OLC {
 		nSmall->remove(key);
         N::change(parentNode, keyParent, nSmall);
         n->writeUnlockObsolete();
-        threadInfo.getEpoche().markNodeForDeletion(n, threadInfo);
+        N::markNodeForDeletion(n, threadInfo);
         parentNode->writeUnlock();
     }
 
@@ -284,9 +312,18 @@ namespace ART_OLC {
                 removeAndShrink<N16, N4>(n, v, parentNode, parentVersion, keyParent, key, needRestart, threadInfo);
                 break;
             }
+            case NTypes::N32: {
+                auto n = static_cast<N32 *>(node);
+                removeAndShrink<N32, N16>(n, v, parentNode, parentVersion, keyParent, key, needRestart, threadInfo);
+                break;
+            }
             case NTypes::N48: {
                 auto n = static_cast<N48 *>(node);
+#if ART_OLC_N32
+                removeAndShrink<N48, N32>(n, v, parentNode, parentVersion, keyParent, key, needRestart, threadInfo);
+#else
                 removeAndShrink<N48, N16>(n, v, parentNode, parentVersion, keyParent, key, needRestart, threadInfo);
+#endif
                 break;
             }
             case NTypes::N256: {
@@ -347,20 +384,102 @@ namespace ART_OLC {
         return count;
     }
 
+    LongPrefix *LongPrefix::create(const uint8_t *prefix, uint32_t length) {
+        auto longPrefix = static_cast<LongPrefix *>(NodeAllocator::allocate(sizeof(LongPrefix) + length));
+        longPrefix->length = length;
+        memcpy(longPrefix->bytes(), prefix, length);
+        return longPrefix;
+    }
+
+    KeyLeaf *KeyLeaf::create(const Key &k, TID tid) {
+        auto leaf = static_cast<KeyLeaf *>(NodeAllocator::allocate(sizeof(KeyLeaf) + k.getKeyLen()));
+        leaf->tid = tid;
+        leaf->keyLength = k.getKeyLen();
+        if (k.getKeyLen() > 0) {
+            memcpy(leaf->key(), &k[0], k.getKeyLen());
+        }
+        return leaf;
+    }
+
+    void KeyLeaf::loadKey(TID leaf, Key &key) {
+        auto keyLeaf = reinterpret_cast<const KeyLeaf *>(leaf);
+        key.set(reinterpret_cast<const char *>(keyLeaf->key()), keyLeaf->keyLength);
+    }
+
+#if ART_OLC_LONG_PREFIXES
+    N::~N() {
+        LongPrefix *longPrefix = this->longPrefix.load(std::memory_order_relaxed);
+        if (longPrefix != nullptr) {
+            NodeAllocator::deallocate(longPrefix);
+        }
+    }
+#endif
+
     const uint8_t *N::getPrefix() const {
+#if ART_OLC_LONG_PREFIXES
+        const LongPrefix *longPrefix = this->longPrefix.load(std::memory_order_relaxed);
+        if (longPrefix != nullptr) {
+            return longPrefix->bytes();
+        }
+#endif
         return prefix;
     }
 
+    const uint8_t *N::getFullPrefix(uint32_t length) const {
+        if (length <= maxStoredPrefixLength) {
+            return prefix;
+        }
+#if ART_OLC_LONG_PREFIXES
+        const LongPrefix *longPrefix = this->longPrefix.load(std::memory_order_acquire);
+        if (longPrefix != nullptr && longPrefix->length >= length) {
+            return longPrefix->bytes();
+        }
+#endif
+        return nullptr;
+    }
+
     void N::setPrefix(const uint8_t *prefix, uint32_t length) {
         if (length > 0) {
-            memcpy(this->prefix, prefix, std::min(length, maxStoredPrefixLength));
+#if ART_OLC_LONG_PREFIXES
+            if (length > maxStoredPrefixLength) {
+                this->longPrefix.store(LongPrefix::create(prefix, length), std::memory_order_release);
+            }
+#endif
+            memmove(this->prefix, prefix, std::min(length, maxStoredPrefixLength));
             prefixCount = length;
         } else {
             prefixCount = 0;
         }
     }
 
-    void N::addPrefixBefore(N *node, uint8_t key) {
+    void N::setPrefix(const uint8_t *prefix, uint32_t length, ThreadInfo &threadInfo) {
+#if ART_OLC_LONG_PREFIXES
+        // prefix may point into the old LongPrefix, it stays valid until the epoch is over
+        LongPrefix *oldLongPrefix = this->longPrefix.exchange(nullptr, std::memory_order_relaxed);
+        setPrefix(prefix, length);
+        if (oldLongPrefix != nullptr) {
+            threadInfo.getEpoche().markNodeForDeletion(oldLongPrefix, threadInfo);
+        }
+#else
+        (void) threadInfo;
+        setPrefix(prefix, length);
+#endif
+    }
+
+    void N::addPrefixBefore(N *node, uint8_t key, ThreadInfo &threadInfo) {
+#if ART_OLC_LONG_PREFIXES
+        uint32_t length = node->getPrefixLength() + 1 + this->getPrefixLength();
+        if (length > maxStoredPrefixLength) {
+            std::vector<uint8_t> prefix(length);
+            memcpy(prefix.data(), node->getPrefix(), node->getPrefixLength());
+            prefix[node->getPrefixLength()] = key;
+            memcpy(prefix.data() + node->getPrefixLength() + 1, this->getPrefix(), this->getPrefixLength());
+            setPrefix(prefix.data(), length, threadInfo);
+            return;
+        }
+#else
+        (void) threadInfo;
+#endif
         uint32_t prefixCopyCount = std::min(maxStoredPrefixLength, node->getPrefixLength() + 1);
         memmove(this->prefix + prefixCopyCount, this->prefix,
                 std::min(this->getPrefixLength(), maxStoredPrefixLength - prefixCopyCount));
@@ -412,6 +531,11 @@ namespace ART_OLC {
                 delete n;
                 return;
             }
+            case NTypes::N32: {
+                auto n = static_cast<N32 *>(node);
+                delete n;
+                return;
+            }
             case NTypes::N48: {
                 auto n = static_cast<N48 *>(node);
                 delete n;
@@ -426,6 +550,16 @@ namespace ART_OLC {
         delete node;
     }
 
+    void N::markNodeForDeletion(N *node, ThreadInfo &threadInfo) {
+#if ART_OLC_LONG_PREFIXES
+        LongPrefix *longPrefix = node->longPrefix.load(std::memory_order_relaxed);
+        if (longPrefix != nullptr) {
+            threadInfo.getEpoche().markNodeForDeletion(longPrefix, threadInfo);
+        }
+#endif
+        threadInfo.getEpoche().markNodeForDeletion(node, threadInfo);
+    }
+
 
     TID N::getAnyChildTid(const N *n, bool &needRestart) {
         const N *nextNode = n;
@@ -457,6 +591,10 @@ namespace ART_OLC {
                 auto n = static_cast<const N16 *>(node);
                 return n->getChildren(start, end, children, childrenCount);
             }
+            case NTypes::N32: {
+                auto n = static_cast<const N32 *>(node);
+                return n->getChildren(start, end, children, childrenCount);
+            }
             case NTypes::N48: {
                 auto n = static_cast<const N48 *>(node);
                 return n->getChildren(start, end, children, childrenCount);
@@ -469,4 +607,58 @@ namespace ART_OLC {
         assert(false);
         __builtin_unreachable();
     }
+
+    uint32_t N::getNextChildren(const N *node, unsigned start, uint8_t keys[], N *children[], uint32_t max) {
+        switch (node->getType()) {
+            case NTypes::N4: {
+                auto n = static_cast<const N4 *>(node);
+                return n->getNextChildren(start, keys, children, max);
+            }
+            case NTypes::N16: {
+                auto n = static_cast<const N16 *>(node);
+                return n->getNextChildren(start, keys, children, max);
+            }
+            case NTypes::N32: {
+                auto n = static_cast<const N32 *>(node);
+                return n->getNextChildren(start, keys, children, max);
+            }
+            case NTypes::N48: {
+                auto n = static_cast<const N48 *>(node);
+                return n->getNextChildren(start, keys, children, max);
+            }
+            case NTypes::N256: {
+                auto n = static_cast<const N256 *>(node);
+                return n->getNextChildren(start, keys, children, max);
+            }
+        }
+        assert(false);
+        __builtin_unreachable();
+    }
+
+    uint32_t N::getPrevChildren(const N *node, unsigned start, uint8_t keys[], N *children[], uint32_t max) {
+        switch (node->getType()) {
+            case NTypes::N4: {
+                auto n = static_cast<const N4 *>(node);
+                return n->getPrevChildren(start, keys, children, max);
+            }
+            case NTypes::N16: {
+                auto n = static_cast<const N16 *>(node);
+                return n->getPrevChildren(start, keys, children, max);
+            }
+            case NTypes::N32: {
+                auto n = static_cast<const N32 *>(node);
+                return n->getPrevChildren(start, keys, children, max);
+            }
+            case NTypes::N48: {
+                auto n = static_cast<const N48 *>(node);
+                return n->getPrevChildren(start, keys, children, max);
+            }
+            case NTypes::N256: {
+                auto n = static_cast<const N256 *>(node);
+                return n->getPrevChildren(start, keys, children, max);
+            }
+        }
+        assert(false);
+        __builtin_unreachable();
+    }
 }
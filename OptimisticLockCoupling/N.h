@@ -11,10 +11,23 @@
 #include <string.h>
 #include "../Key.h"
 #include "../Epoche.h"
+#include "../NodeAllocator.h"
+#include "../NodeScan.h"
 #include "Tree.h"
 
 using TID = uint64_t;
 
+// build with -DART_OLC_N32=1 to grow N16 into N32 instead of N48 (and to shrink N48 into N32)
+#ifndef ART_OLC_N32
+#define ART_OLC_N32 0
+#endif
+
+// build with -DART_OLC_LONG_PREFIXES=1 to keep prefixes longer than maxStoredPrefixLength out of line, so that
+// prefix checks do not have to load the key of a leaf
+#ifndef ART_OLC_LONG_PREFIXES
+#define ART_OLC_LONG_PREFIXES 0
+#endif
+
 using namespace ART;
 namespace ART_OLC {
 /*
@@ -28,13 +41,59 @@ namespace ART_OLC {
         N4 = 0,
         N16 = 1,
         N48 = 2,
-        N256 = 3
+        N256 = 3,
+        N32 = 4
     };
 
+    static constexpr unsigned nodeTypeCount = 5;
+
     static constexpr uint32_t maxStoredPrefixLength = 11;
 
     using Prefix = uint8_t[maxStoredPrefixLength];
 
+    /**
+     * Out of line copy of a prefix, allocated with NodeAllocator. It is never changed after it was created,
+     * a node gets a new one when its prefix changes and the old one is reclaimed through the Epoche.
+     * Optimistic readers may see a LongPrefix together with the prefix length of another version, length tells
+     * them how many bytes they can read.
+     */
+    struct LongPrefix {
+        uint32_t length;
+
+        uint8_t *bytes() {
+            return reinterpret_cast<uint8_t *>(this + 1);
+        }
+
+        const uint8_t *bytes() const {
+            return reinterpret_cast<const uint8_t *>(this + 1);
+        }
+
+        static LongPrefix *create(const uint8_t *prefix, uint32_t length);
+    };
+
+    /**
+     * Leaf of a tree with LeafMode::EmbeddedKey, the TID together with a copy of its key, allocated with
+     * NodeAllocator. The nodes hold N::setLeaf(reinterpret_cast<TID>(keyLeaf)), so N::isLeaf and N::getLeaf work
+     * as for plain TIDs. A KeyLeaf is never changed, it is reclaimed through the Epoche once it is unlinked.
+     */
+    struct KeyLeaf {
+        TID tid;
+        uint32_t keyLength;
+
+        uint8_t *key() {
+            return reinterpret_cast<uint8_t *>(this + 1);
+        }
+
+        const uint8_t *key() const {
+            return reinterpret_cast<const uint8_t *>(this + 1);
+        }
+
+        static KeyLeaf *create(const Key &k, TID tid);
+
+        // the LoadKeyFunction for what N::getLeaf returns in a tree of KeyLeafs
+        static void loadKey(TID leaf, Key &key);
+    };
+
     class N {
     protected:
         N(NTypes type, const uint8_t *prefix, uint32_t prefixLength) {
@@ -46,13 +105,19 @@ namespace ART_OLC {
 
         N(N &&) = delete;
 
-        //2b type 60b version 1b lock 1b obsolete
+        //3b type 59b version 1b lock 1b obsolete
         std::atomic<uint64_t> typeVersionLockObsolete{0b100};
         // version 1, unlocked, not obsolete
         uint32_t prefixCount = 0;
 
         uint8_t count = 0;
         Prefix prefix;
+#if ART_OLC_LONG_PREFIXES
+        // the whole prefix if it is longer than maxStoredPrefixLength, see LongPrefix
+        std::atomic<LongPrefix *> longPrefix{nullptr};
+
+        ~N();
+#endif
 
         void setType(NTypes type);
 
@@ -72,6 +137,14 @@ namespace ART_OLC {
 
 		typedef struct trans_info trans_info;
 
+        static void *operator new(std::size_t size) {
+            return NodeAllocator::allocate(size);
+        }
+
+        static void operator delete(void *p) {
+            NodeAllocator::deallocate(p);
+        }
+
         NTypes getType() const;
 
         uint32_t getCount() const;
@@ -115,11 +188,24 @@ namespace ART_OLC {
 
         bool hasPrefix() const;
 
+        /**
+         * the stored prefix bytes, all of them if the node has a LongPrefix
+         * can only be called when node is locked
+         */
         const uint8_t *getPrefix() const;
 
+        /**
+         * returns all length bytes of the prefix if they are stored in the node, nullptr if they have to be
+         * loaded from a leaf, the caller has to validate the node version afterwards
+         */
+        const uint8_t *getFullPrefix(uint32_t length) const;
+
         void setPrefix(const uint8_t *prefix, uint32_t length);
 
-        void addPrefixBefore(N *node, uint8_t key);
+        // like setPrefix for a node in the tree, a replaced LongPrefix is reclaimed through the Epoche
+        void setPrefix(const uint8_t *prefix, uint32_t length, ThreadInfo &threadInfo);
+
+        void addPrefixBefore(N *node, uint8_t key, ThreadInfo &threadInfo);
 
         uint32_t getPrefixLength() const;
 
@@ -137,6 +223,9 @@ namespace ART_OLC {
 
         static void deleteNode(N *node);
 
+        // hands an obsolete node to the Epoche of threadInfo, together with its LongPrefix
+        static void markNodeForDeletion(N *node, ThreadInfo &threadInfo);
+
         static std::tuple<N *, uint8_t> getSecondChild(N *node, const uint8_t k);
 
         template<typename curN, typename biggerN>
@@ -147,6 +236,15 @@ namespace ART_OLC {
 
         static uint64_t getChildren(const N *node, uint8_t start, uint8_t end, std::tuple<uint8_t, N *> children[],
                                 uint32_t &childrenCount);
+
+        /**
+         * copies up to max children with keyslice >= start in keyslice order and returns their number,
+         * the caller has to validate the node version afterwards
+         */
+        static uint32_t getNextChildren(const N *node, unsigned start, uint8_t keys[], N *children[], uint32_t max);
+
+        // like getNextChildren, but for keyslices <= start in descending order
+        static uint32_t getPrevChildren(const N *node, unsigned start, uint8_t keys[], N *children[], uint32_t max);
     };
 
     class N4 : public N {
@@ -181,6 +279,10 @@ namespace ART_OLC {
 
         uint64_t getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
+
+        uint32_t getNextChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const;
+
+        uint32_t getPrevChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const;
     };
 
     class N16 : public N {
@@ -237,6 +339,57 @@ namespace ART_OLC {
 
         uint64_t getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
+
+        uint32_t getNextChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const;
+
+        uint32_t getPrevChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const;
+    };
+
+    class N32 : public N {
+    public:
+        // sorted and sign flipped like the keys of N16
+        uint8_t keys[32];
+        N *children[32];
+
+        // bit i is set for the keys[i] (of the first count) that are equal to / greater than keyByteFlipped
+        uint32_t equalKeys(uint8_t keyByteFlipped) const;
+
+        uint32_t greaterKeys(uint8_t keyByteFlipped) const;
+
+        N *const *getChildPos(const uint8_t k) const;
+
+    public:
+        N32(const uint8_t *prefix, uint32_t prefixLength) : N(NTypes::N32, prefix,
+                                                                              prefixLength) {
+            memset(keys, 0, sizeof(keys));
+            memset(children, 0, sizeof(children));
+        }
+
+        void insert(uint8_t key, N *n);
+
+        template<class NODE>
+        void copyTo(NODE *n) const;
+
+        bool change(uint8_t key, N *val);
+
+        N *getChild(const uint8_t k) const;
+
+        void remove(uint8_t k);
+
+        N *getAnyChild() const;
+
+        bool isFull() const;
+
+        bool isUnderfull() const;
+
+        void deleteChildren();
+
+        uint64_t getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                         uint32_t &childrenCount) const;
+
+        uint32_t getNextChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const;
+
+        uint32_t getPrevChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const;
     };
 
     class N48 : public N {
@@ -272,6 +425,10 @@ namespace ART_OLC {
 
         uint64_t getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
+
+        uint32_t getNextChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const;
+
+        uint32_t getPrevChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const;
     };
 
     class N256 : public N {
@@ -304,6 +461,10 @@ namespace ART_OLC {
 
         uint64_t getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
+
+        uint32_t getNextChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const;
+
+        uint32_t getPrevChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const;
     };
 }
 #endif //ART_OPTIMISTIC_LOCK_COUPLING_N_H
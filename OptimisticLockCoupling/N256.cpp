@@ -13,12 +13,11 @@ namespace ART_OLC {
     }
 
     void N256::deleteChildren() {
-        for (uint64_t i = 0; i < 256; ++i) {
-            if (children[i] != nullptr) {
-                N::deleteChildren(children[i]);
-                N::deleteNode(children[i]);
-            }
-        }
+        NodeScan::forEachChild(children, 0, 255, [&](unsigned i) {
+            N::deleteChildren(children[i]);
+            N::deleteNode(children[i]);
+            return true;
+        });
     }
 
     void N256::insert(uint8_t key, N *val) {
@@ -71,14 +70,39 @@ namespace ART_OLC {
         v = readLockOrRestart(needRestart);
         if (needRestart) goto restart;
         childrenCount = 0;
-        for (unsigned i = start; i <= end; i++) {
-            if (this->children[i] != nullptr) {
-                children[childrenCount] = std::make_tuple(i, this->children[i]);
-                childrenCount++;
-            }
-        }
+        NodeScan::forEachChild(this->children, start, end, [&](unsigned i) {
+            children[childrenCount] = std::make_tuple(i, this->children[i]);
+            childrenCount++;
+            return true;
+        });
         readUnlockOrRestart(v, needRestart);
         if (needRestart) goto restart;
         return v;
     }
-}
\ No newline at end of file
+
+    uint32_t N256::getNextChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const {
+        uint32_t found = 0;
+        if (start > 255 || max == 0) {
+            return found;
+        }
+        NodeScan::forEachChild(this->children, start, 255, [&](unsigned i) {
+            keys[found] = i;
+            children[found] = this->children[i];
+            return ++found < max;
+        });
+        return found;
+    }
+
+    uint32_t N256::getPrevChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const {
+        uint32_t found = 0;
+        if (start > 255 || max == 0) {
+            return found;
+        }
+        NodeScan::forEachChildReverse(this->children, 0, start, [&](unsigned i) {
+            keys[found] = i;
+            children[found] = this->children[i];
+            return ++found < max;
+        });
+        return found;
+    }
+}
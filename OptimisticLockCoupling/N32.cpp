@@ -0,0 +1,160 @@
+#include <assert.h>
+#include <algorithm>
+#include "N.h"
+#include <immintrin.h> // x86 SSE/AVX2 intrinsics
+
+namespace ART_OLC {
+
+    bool N32::isFull() const {
+        return count == 32;
+    }
+
+    bool N32::isUnderfull() const {
+        return count == 12;
+    }
+
+    uint32_t N32::equalKeys(uint8_t keyByteFlipped) const {
+        uint32_t used = static_cast<uint32_t>((static_cast<uint64_t>(1) << count) - 1);
+#ifdef __AVX2__
+        __m256i cmp = _mm256_cmpeq_epi8(_mm256_set1_epi8(keyByteFlipped),
+                                        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys)));
+        return static_cast<uint32_t>(_mm256_movemask_epi8(cmp)) & used;
+#else
+        __m128i key = _mm_set1_epi8(keyByteFlipped);
+        uint32_t low = _mm_movemask_epi8(
+                _mm_cmpeq_epi8(key, _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys))));
+        uint32_t high = _mm_movemask_epi8(
+                _mm_cmpeq_epi8(key, _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + 16))));
+        return (high << 16 | low) & used;
+#endif
+    }
+
+    uint32_t N32::greaterKeys(uint8_t keyByteFlipped) const {
+        uint32_t used = static_cast<uint32_t>((static_cast<uint64_t>(1) << count) - 1);
+#ifdef __AVX2__
+        __m256i cmp = _mm256_cmpgt_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys)),
+                                        _mm256_set1_epi8(keyByteFlipped));
+        return static_cast<uint32_t>(_mm256_movemask_epi8(cmp)) & used;
+#else
+        __m128i key = _mm_set1_epi8(keyByteFlipped);
+        uint32_t low = _mm_movemask_epi8(
+                _mm_cmplt_epi8(key, _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys))));
+        uint32_t high = _mm_movemask_epi8(
+                _mm_cmplt_epi8(key, _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + 16))));
+        return (high << 16 | low) & used;
+#endif
+    }
+
+    void N32::insert(uint8_t key, N *n) {
+        uint8_t keyByteFlipped = N16::flipSign(key);
+        uint32_t bitfield = greaterKeys(keyByteFlipped);
+        unsigned pos = bitfield ? __builtin_ctz(bitfield) : count;
+        memmove(keys + pos + 1, keys + pos, count - pos);
+        memmove(children + pos + 1, children + pos, (count - pos) * sizeof(uintptr_t));
+        keys[pos] = keyByteFlipped;
+        children[pos] = n;
+        count++;
+    }
+
+    template<class NODE>
+    void N32::copyTo(NODE *n) const {
+        for (unsigned i = 0; i < count; i++) {
+            n->insert(N16::flipSign(keys[i]), children[i]);
+        }
+    }
+
+    bool N32::change(uint8_t key, N *val) {
+        N **childPos = const_cast<N **>(getChildPos(key));
+        assert(childPos != nullptr);
+        *childPos = val;
+        return true;
+    }
+
+    N *const *N32::getChildPos(const uint8_t k) const {
+        uint32_t bitfield = equalKeys(N16::flipSign(k));
+        if (bitfield) {
+            return &children[__builtin_ctz(bitfield)];
+        } else {
+            return nullptr;
+        }
+    }
+
+    N *N32::getChild(const uint8_t k) const {
+        N *const *childPos = getChildPos(k);
+        if (childPos == nullptr) {
+            return nullptr;
+        } else {
+            return *childPos;
+        }
+    }
+
+    void N32::remove(uint8_t k) {
+        N *const *leafPlace = getChildPos(k);
+        assert(leafPlace != nullptr);
+        std::size_t pos = leafPlace - children;
+        memmove(keys + pos, keys + pos + 1, count - pos - 1);
+        memmove(children + pos, children + pos + 1, (count - pos - 1) * sizeof(N *));
+        count--;
+        assert(getChild(k) == nullptr);
+    }
+
+    N *N32::getAnyChild() const {
+        for (int i = 0; i < count; ++i) {
+            if (N::isLeaf(children[i])) {
+                return children[i];
+            }
+        }
+        return children[0];
+    }
+
+    void N32::deleteChildren() {
+        for (std::size_t i = 0; i < count; ++i) {
+            N::deleteChildren(children[i]);
+            N::deleteNode(children[i]);
+        }
+    }
+
+    uint64_t N32::getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                          uint32_t &childrenCount) const {
+        restart:
+        bool needRestart = false;
+        uint64_t v;
+        v = readLockOrRestart(needRestart);
+        if (needRestart) goto restart;
+        childrenCount = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            uint8_t key = N16::flipSign(keys[i]);
+            if (key >= start && key <= end) {
+                children[childrenCount] = std::make_tuple(key, this->children[i]);
+                childrenCount++;
+            }
+        }
+        readUnlockOrRestart(v, needRestart);
+        if (needRestart) goto restart;
+        return v;
+    }
+
+    uint32_t N32::getNextChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const {
+        uint32_t found = 0;
+        for (uint32_t i = 0; i < count && found < max; ++i) {
+            if (N16::flipSign(this->keys[i]) >= start) {
+                keys[found] = N16::flipSign(this->keys[i]);
+                children[found] = this->children[i];
+                found++;
+            }
+        }
+        return found;
+    }
+
+    uint32_t N32::getPrevChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const {
+        uint32_t found = 0;
+        for (int i = count - 1; i >= 0 && found < max; --i) {
+            if (N16::flipSign(this->keys[i]) <= start) {
+                keys[found] = N16::flipSign(this->keys[i]);
+                children[found] = this->children[i];
+                found++;
+            }
+        }
+        return found;
+    }
+}
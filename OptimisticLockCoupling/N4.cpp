@@ -106,4 +106,28 @@ namespace ART_OLC {
         if (needRestart) goto restart;
         return v;
     }
-}
\ No newline at end of file
+
+    uint32_t N4::getNextChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const {
+        uint32_t found = 0;
+        for (uint32_t i = 0; i < count && found < max; ++i) {
+            if (this->keys[i] >= start) {
+                keys[found] = this->keys[i];
+                children[found] = this->children[i];
+                found++;
+            }
+        }
+        return found;
+    }
+
+    uint32_t N4::getPrevChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const {
+        uint32_t found = 0;
+        for (int i = count - 1; i >= 0 && found < max; --i) {
+            if (this->keys[i] <= start) {
+                keys[found] = this->keys[i];
+                children[found] = this->children[i];
+                found++;
+            }
+        }
+        return found;
+    }
+}
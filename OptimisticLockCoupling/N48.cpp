@@ -9,7 +9,11 @@ namespace ART_OLC {
     }
 
     bool N48::isUnderfull() const {
+#if ART_OLC_N32
+        return count == 24;
+#else
         return count == 12;
+#endif
     }
 
     void N48::insert(uint8_t key, N *n) {
@@ -67,12 +71,11 @@ namespace ART_OLC {
     }
 
     void N48::deleteChildren() {
-        for (unsigned i = 0; i < 256; i++) {
-            if (childIndex[i] != emptyMarker) {
-                N::deleteChildren(children[childIndex[i]]);
-                N::deleteNode(children[childIndex[i]]);
-            }
-        }
+        NodeScan::forEachIndex(childIndex, emptyMarker, 0, 255, [&](unsigned i) {
+            N::deleteChildren(children[childIndex[i]]);
+            N::deleteNode(children[childIndex[i]]);
+            return true;
+        });
     }
 
     uint64_t N48::getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
@@ -83,14 +86,39 @@ namespace ART_OLC {
         v = readLockOrRestart(needRestart);
         if (needRestart) goto restart;
         childrenCount = 0;
-        for (unsigned i = start; i <= end; i++) {
-            if (this->childIndex[i] != emptyMarker) {
-                children[childrenCount] = std::make_tuple(i, this->children[this->childIndex[i]]);
-                childrenCount++;
-            }
-        }
+        NodeScan::forEachIndex(childIndex, emptyMarker, start, end, [&](unsigned i) {
+            children[childrenCount] = std::make_tuple(i, this->children[this->childIndex[i]]);
+            childrenCount++;
+            return true;
+        });
         readUnlockOrRestart(v, needRestart);
         if (needRestart) goto restart;
         return v;
     }
-}
\ No newline at end of file
+
+    uint32_t N48::getNextChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const {
+        uint32_t found = 0;
+        if (start > 255 || max == 0) {
+            return found;
+        }
+        NodeScan::forEachIndex(childIndex, emptyMarker, start, 255, [&](unsigned i) {
+            keys[found] = i;
+            children[found] = this->children[childIndex[i]];
+            return ++found < max;
+        });
+        return found;
+    }
+
+    uint32_t N48::getPrevChildren(unsigned start, uint8_t keys[], N *children[], uint32_t max) const {
+        uint32_t found = 0;
+        if (start > 255 || max == 0) {
+            return found;
+        }
+        NodeScan::forEachIndexReverse(childIndex, emptyMarker, 0, start, [&](unsigned i) {
+            keys[found] = i;
+            children[found] = this->children[childIndex[i]];
+            return ++found < max;
+        });
+        return found;
+    }
+}
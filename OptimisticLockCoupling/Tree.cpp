@@ -1,6 +1,10 @@
 #include <assert.h>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include "Tree.h"
+#include "../BulkLoad.h"
 #include "N.cpp"
 #include "../Epoche.cpp"
 #include "../Key.h"
@@ -17,15 +21,254 @@ using namespace std;
 	#define PRINT_DEBUG(...)  
 #endif
 
+// needRestart, and counts the restart at this line when it is set
+#if ART_OLC_RESTART_STATS == 1
+	#define RESTARTED(operation, cause, node, level) \
+		(needRestart && (countRestart(RestartOperation::operation, RestartCause::cause, __LINE__, (node), (level)), true))
+#else
+	#define RESTARTED(operation, cause, node, level) needRestart
+#endif
+
 namespace ART_OLC {
 
-    Tree::Tree(LoadKeyFunction loadKey) : root(new N256( nullptr, 0)), loadKey(loadKey) {
-        #if MEASURE_TREE_SIZE == 1
-            memset(tree_sz, 0, N_THREADS * sizeof(uint64_t));
-        #endif
+#if ART_OLC_RESTART_STATS == 1
+    namespace {
+        /**
+         * The restarts of one thread: a table with open addressing of packed RestartSites that only the thread
+         * adds to, so that getRestartStats can read it while the thread runs. Sites beyond the capacity are
+         * counted as dropped.
+         */
+        struct RestartTable {
+            static constexpr std::size_t capacity = 1024;
+            std::atomic<uint64_t> keys[capacity];
+            std::atomic<uint64_t> counts[capacity];
+
+            RestartTable() {
+                for (std::size_t i = 0; i < capacity; ++i) {
+                    keys[i].store(0, std::memory_order_relaxed);
+                    counts[i].store(0, std::memory_order_relaxed);
+                }
+            }
+
+            // line: 20 bits, level: 16, operation, cause and node type: 8 each, 0 is an empty slot
+            static uint64_t pack(RestartOperation operation, RestartCause cause, uint32_t line, uint32_t level,
+                                 NTypes type) {
+                return (static_cast<uint64_t>(line & 0xfffff) << 40) |
+                       (static_cast<uint64_t>(std::min<uint32_t>(level, 0xffff)) << 24) |
+                       (static_cast<uint64_t>(operation) << 16) | (static_cast<uint64_t>(cause) << 8) |
+                       static_cast<uint64_t>(type) | (1ull << 63);
+            }
+
+            static RestartSite unpack(uint64_t key, uint64_t count) {
+                return RestartSite{static_cast<RestartOperation>((key >> 16) & 0xff),
+                                   static_cast<RestartCause>((key >> 8) & 0xff),
+                                   static_cast<uint32_t>((key >> 40) & 0xfffff),
+                                   static_cast<uint32_t>((key >> 24) & 0xffff), static_cast<NTypes>(key & 0xff), count};
+            }
+
+            void add(uint64_t key, uint64_t count) {
+                std::size_t i = (key * 0x9e3779b97f4a7c15ull) >> 54;
+                for (std::size_t probe = 0; probe < capacity; ++probe, i = (i + 1) % capacity) {
+                    uint64_t k = keys[i].load(std::memory_order_relaxed);
+                    if (k == 0) {
+                        keys[i].store(key, std::memory_order_release);
+                        k = key;
+                    }
+                    if (k == key) {
+                        counts[i].store(counts[i].load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+                        return;
+                    }
+                }
+                dropped.store(dropped.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+            }
+
+            void collect(std::vector<RestartSite> &sites) const {
+                for (std::size_t i = 0; i < capacity; ++i) {
+                    uint64_t key = keys[i].load(std::memory_order_acquire);
+                    uint64_t count = counts[i].load(std::memory_order_relaxed);
+                    if (key != 0 && count != 0) {
+                        sites.push_back(unpack(key, count));
+                    }
+                }
+            }
+
+            void reset() {
+                for (std::size_t i = 0; i < capacity; ++i) {
+                    counts[i].store(0, std::memory_order_relaxed);
+                }
+                dropped.store(0, std::memory_order_relaxed);
+            }
+
+            std::atomic<uint64_t> dropped{0};
+        };
+
+        // the tables of the running threads, and the restarts of the threads that have exited
+        std::mutex restartTablesMutex;
+        std::vector<RestartTable *> restartTables;
+        RestartTable *exitedRestarts = nullptr;
+
+        struct ThreadRestarts {
+            RestartTable *table = nullptr;
+
+            RestartTable &get() {
+                if (table == nullptr) {
+                    table = new RestartTable();
+                    std::lock_guard<std::mutex> lock(restartTablesMutex);
+                    restartTables.push_back(table);
+                }
+                return *table;
+            }
+
+            ~ThreadRestarts() {
+                if (table == nullptr) {
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(restartTablesMutex);
+                restartTables.erase(std::find(restartTables.begin(), restartTables.end(), table));
+                if (exitedRestarts == nullptr) {
+                    exitedRestarts = new RestartTable();
+                }
+                for (std::size_t i = 0; i < RestartTable::capacity; ++i) {
+                    uint64_t key = table->keys[i].load(std::memory_order_relaxed);
+                    if (key != 0) {
+                        exitedRestarts->add(key, table->counts[i].load(std::memory_order_relaxed));
+                    }
+                }
+                delete table;
+            }
+        };
+
+        thread_local ThreadRestarts threadRestarts;
+
+        void countRestart(RestartOperation operation, RestartCause cause, uint32_t line, const N *node,
+                          uint32_t level) {
+            threadRestarts.get().add(RestartTable::pack(operation, cause, line, level, node->getType()), 1);
+        }
+    }
+#endif
+
+    Tree::Tree(LoadKeyFunction loadKey, LeafMode leafMode, ReclaimMode reclaimMode, ReclaimScheme reclaimScheme)
+            : root(new N256( nullptr, 0)), loadKey(loadKey), leafMode(leafMode),
+              loadLeafKey(leafMode == LeafMode::EmbeddedKey ? KeyLeaf::loadKey : loadKey), epoche(256, reclaimMode, reclaimScheme) {
+    }
+
+    LeafMode Tree::getLeafMode() const {
+        return leafMode;
+    }
+
+    N *Tree::newLeaf(const Key &k, TID tid) const {
+        if (leafMode == LeafMode::EmbeddedKey) {
+            return N::setLeaf(reinterpret_cast<TID>(KeyLeaf::create(k, tid)));
+        }
+        return N::setLeaf(tid);
+    }
+
+    TID Tree::getLeafTid(const N *leaf) const {
+        if (leafMode == LeafMode::EmbeddedKey) {
+            return reinterpret_cast<const KeyLeaf *>(N::getLeaf(leaf))->tid;
+        }
+        return N::getLeaf(leaf);
+    }
+
+    TID Tree::checkLeaf(const N *leaf, const Key &k) const {
+        if (leafMode == LeafMode::EmbeddedKey) {
+            auto keyLeaf = reinterpret_cast<const KeyLeaf *>(N::getLeaf(leaf));
+            if (keyLeaf->keyLength == k.getKeyLen() &&
+                (k.getKeyLen() == 0 || memcmp(keyLeaf->key(), &k[0], k.getKeyLen()) == 0)) {
+                return keyLeaf->tid;
+            }
+            return 0;
+        }
+        return checkKey(N::getLeaf(leaf), k);
+    }
+
+    void Tree::deleteLeaf(N *leaf) const {
+        if (leafMode == LeafMode::EmbeddedKey) {
+            NodeAllocator::deallocate(reinterpret_cast<void *>(N::getLeaf(leaf)));
+        }
+    }
+
+    void Tree::retireLeaf(const N *leaf, ThreadInfo &threadInfo) {
+        if (leafMode == LeafMode::EmbeddedKey) {
+            threadInfo.getEpoche().markNodeForDeletion(reinterpret_cast<void *>(N::getLeaf(leaf)), threadInfo);
+        }
+    }
+
+    void Tree::deleteKeyLeaves(N *node) {
+        std::tuple<uint8_t, N *> children[256];
+        uint32_t childrenCount = 0;
+        N::getChildren(node, 0, 255, children, childrenCount);
+        for (uint32_t i = 0; i < childrenCount; ++i) {
+            N *child = std::get<1>(children[i]);
+            if (N::isLeaf(child)) {
+                NodeAllocator::deallocate(reinterpret_cast<void *>(N::getLeaf(child)));
+            } else {
+                deleteKeyLeaves(child);
+            }
+        }
+    }
+
+    static N *newBulkLoadNode(unsigned childrenCount, const uint8_t *prefix, uint32_t prefixLength) {
+        if (childrenCount <= 4) {
+            return new N4(prefix, prefixLength);
+        } else if (childrenCount <= 16) {
+            return new N16(prefix, prefixLength);
+#if ART_OLC_N32
+        } else if (childrenCount <= 32) {
+            return new N32(prefix, prefixLength);
+#endif
+        } else if (childrenCount <= 48) {
+            return new N48(prefix, prefixLength);
+        }
+        return new N256(prefix, prefixLength);
+    }
+
+    static void insertBulkLoaded(N *node, uint8_t key, N *child) {
+        switch (node->getType()) {
+            case NTypes::N4:
+                static_cast<N4 *>(node)->insert(key, child);
+                return;
+            case NTypes::N16:
+                static_cast<N16 *>(node)->insert(key, child);
+                return;
+            case NTypes::N32:
+                static_cast<N32 *>(node)->insert(key, child);
+                return;
+            case NTypes::N48:
+                static_cast<N48 *>(node)->insert(key, child);
+                return;
+            case NTypes::N256:
+                static_cast<N256 *>(node)->insert(key, child);
+                return;
+        }
+    }
+
+    Tree::Tree(LoadKeyFunction loadKey, const Key keys[], const TID tids[], std::size_t n, unsigned threads,
+               LeafMode leafMode, ReclaimMode reclaimMode, ReclaimScheme reclaimScheme)
+            : Tree(loadKey, leafMode, reclaimMode, reclaimScheme) {
+        ART::bulkLoad(root, keys, n, threads, [&](std::size_t i) { return newLeaf(keys[i], tids[i]); },
+                      [](unsigned childrenCount, uint32_t, const uint8_t *prefix, uint32_t prefixLength) {
+                          return newBulkLoadNode(childrenCount, prefix, prefixLength);
+                      },
+                      insertBulkLoaded);
+        bulkLoadedElements = static_cast<int64_t>(n);
+    }
+
+    Tree::Tree(Tree &&t) : root(t.root), loadKey(t.loadKey), leafMode(t.leafMode), loadLeafKey(t.loadLeafKey),
+                           epoche(256, t.epoche.getReclaimMode(), t.epoche.getReclaimScheme()),
+                           bulkLoadedElements(t.bulkLoadedElements + t.epoche.getElementCount()),
+                           scanRepinInterval(t.scanRepinInterval.load()) {
+        epoche.setRetiredBudget(t.epoche.getRetiredBudget());
+        t.root = nullptr;
     }
 
     Tree::~Tree() {
+        if (root == nullptr) {
+            return;
+        }
+        if (leafMode == LeafMode::EmbeddedKey) {
+            deleteKeyLeaves(root);
+        }
         N::deleteChildren(root);
         N::deleteNode(root);
     }
@@ -34,15 +277,34 @@ namespace ART_OLC {
         return ThreadInfo(this->epoche);
     }
 
-    #if MEASURE_TREE_SIZE == 1
-    uint64_t Tree::getTreeSize(){
-        uint64_t size=0;
-        for(uint8_t i=0; i<N_THREADS; i++){
-            size += tree_sz[i];
-        }
-        return size;
+    EpocheStats Tree::getEpocheStats() const {
+        return epoche.getStats();
+    }
+
+    void Tree::quiescent(ThreadInfo &threadInfo) {
+        epoche.quiescent(threadInfo);
+    }
+
+    EpocheSession Tree::pin(ThreadInfo &threadInfo, uint32_t repinInterval) const {
+        return EpocheSession(threadInfo, repinInterval);
+    }
+
+    void Tree::setRetiredBudget(std::size_t bytes) {
+        epoche.setRetiredBudget(bytes);
+    }
+
+    void Tree::setScanRepinInterval(uint64_t keys) {
+        scanRepinInterval.store(keys, std::memory_order_relaxed);
+    }
+
+    uint64_t Tree::size() const {
+        int64_t elements = bulkLoadedElements + epoche.getElementCount();
+        return elements > 0 ? static_cast<uint64_t>(elements) : 0;
+    }
+
+    void Tree::addElements(int64_t delta, ThreadInfo &threadInfo) {
+        threadInfo.addElements(delta);
     }
-    #endif
 
 	TID Tree::lookup(const Key &k, ThreadInfo &threadEpocheInfo) const {
 		return lookup(k, threadEpocheInfo, nullptr);
@@ -73,7 +335,7 @@ namespace ART_OLC {
             t_info->shouldAbort = true;
             return 0;
         }
-        if (needRestart)
+        if (RESTARTED(Lookup, ReadLock, node, level))
             goto restart;
         
         while (true) {
@@ -88,7 +350,7 @@ namespace ART_OLC {
                         t_info->updated_node1 = node_vers_t(node, v);
 					}
 					node->readUnlockOrRestart(v, needRestart);
-					if (needRestart) goto restart;
+					if (RESTARTED(Lookup, ReadUnlock, node, level)) goto restart;
                     return 0;
                 case CheckPrefixResult::OptimisticMatch:
                     optimisticPrefixMatch = true;
@@ -109,7 +371,7 @@ namespace ART_OLC {
                             }
 							PRINT_DEBUG("child in keyslice 0 is null!\n")
 							node->readUnlockOrRestart(v, needRestart);
-							if (needRestart) goto restart;
+							if (RESTARTED(Lookup, ReadUnlock, node, level)) goto restart;
                        		return 0;
 						}
                     } else
@@ -117,11 +379,11 @@ namespace ART_OLC {
                     parentNode = node;
                     node = N::getChild(keyslice, parentNode);
                     parentNode->checkOrRestart(v,needRestart);
-                    if (needRestart) goto restart;
+                    if (RESTARTED(Lookup, Check, parentNode, level)) goto restart;
 
                     if (node == nullptr) {
                         parentNode->checkOrRestart(v,needRestart);
-                        if (needRestart) goto restart;
+                        if (RESTARTED(Lookup, Check, parentNode, level)) goto restart;
 						if(transactional){ // current node is null, add the parent node! (The node that would contain that key,val)
 							t_info->cur_node = parentNode;
 							t_info->updated_node1 = node_vers_t(parentNode, v);
@@ -131,8 +393,8 @@ namespace ART_OLC {
                     }
                     if (N::isLeaf(node)) {
                         parentNode->readUnlockOrRestart(v, needRestart);
-                        if (needRestart) goto restart;
-                        TID tid = N::getLeaf(node);
+                        if (RESTARTED(Lookup, ReadUnlock, parentNode, level)) goto restart;
+                        TID tid = getLeafTid(node);
 						// Dim: handle the 0 case! We need to check the key even if the encountered node is a leaf and the level is less than the key
 						// length. That's because we have the case of 0 as the keyslice to follow the leaf node.
 						// eg: When having node ABBA, we should not reply that we found AB (level=1, key length=2).
@@ -148,21 +410,206 @@ namespace ART_OLC {
 								return tid;
 							}
 							else
-								return checkKey(tid, k);
+								return checkLeaf(node, k);
                         }
                         return tid;
                     }
                     level++;
             }
             uint64_t nv = node->readLockOrRestart(needRestart);
-            if (needRestart) goto restart;
+            if (RESTARTED(Lookup, ReadLock, node, level)) goto restart;
 
             parentNode->readUnlockOrRestart(v, needRestart);
-            if (needRestart) goto restart;
+            if (RESTARTED(Lookup, ReadUnlock, parentNode, level)) goto restart;
             v = nv;
         }
     }
 
+    void Tree::getNodeTypeHistogram(uint64_t counts[], ThreadInfo &threadEpocheInfo) const {
+        TreeStats s = stats(threadEpocheInfo);
+        std::copy(s.nodes, s.nodes + nodeTypeCount, counts);
+    }
+
+    static std::size_t nodeSize(NTypes type) {
+        switch (type) {
+            case NTypes::N4:
+                return sizeof(N4);
+            case NTypes::N16:
+                return sizeof(N16);
+            case NTypes::N32:
+                return sizeof(N32);
+            case NTypes::N48:
+                return sizeof(N48);
+            case NTypes::N256:
+                return sizeof(N256);
+        }
+        return 0;
+    }
+
+    static void countAt(std::vector<uint64_t> &histogram, std::size_t i) {
+        if (histogram.size() <= i) {
+            histogram.resize(i + 1, 0);
+        }
+        histogram[i]++;
+    }
+
+    TreeStats Tree::stats(ThreadInfo &threadEpocheInfo) const {
+        EpocheGuardReadonly epocheGuard(threadEpocheInfo);
+        TreeStats s;
+        // inner nodes and their depth
+        std::vector<std::pair<N *, uint32_t>> stack{{root, 1}};
+        uint8_t keys[256];
+        N *children[256];
+        while (!stack.empty()) {
+            N *node = stack.back().first;
+            uint32_t depth = stack.back().second;
+            stack.pop_back();
+            while (true) {
+                bool needRestart = false;
+                auto v = node->readLockOrRestart(needRestart);
+                if (needRestart && N::isObsolete(v)) {
+                    // replaced in the meantime, its successor isn't counted
+                    break;
+                }
+                if (needRestart) continue;
+                NTypes type = node->getType();
+                uint32_t prefixLength = node->getPrefixLength();
+                bool longPrefix = prefixLength > maxStoredPrefixLength && node->getFullPrefix(prefixLength) != nullptr;
+                uint32_t childrenCount = N::getNextChildren(node, 0, keys, children, 256);
+                node->readUnlockOrRestart(v, needRestart);
+                if (needRestart) continue;
+
+                unsigned t = static_cast<unsigned>(type);
+                s.nodes[t]++;
+                s.children[t] += childrenCount;
+                countAt(s.prefixLengths, prefixLength);
+                if (prefixLength > maxStoredPrefixLength) {
+                    s.prefixesBeyondStored++;
+                }
+                s.bytes += nodeSize(type) + (longPrefix ? sizeof(LongPrefix) + prefixLength : 0);
+                for (uint32_t i = 0; i < childrenCount; ++i) {
+                    if (N::isLeaf(children[i])) {
+                        s.leaves++;
+                        countAt(s.leafDepths, depth);
+                        if (leafMode == LeafMode::EmbeddedKey) {
+                            // KeyLeafs never change
+                            auto leaf = reinterpret_cast<const KeyLeaf *>(N::getLeaf(children[i]));
+                            s.bytes += sizeof(KeyLeaf) + leaf->keyLength;
+                        }
+                    } else {
+                        stack.emplace_back(children[i], depth + 1);
+                    }
+                }
+                break;
+            }
+        }
+        return s;
+    }
+
+    void Tree::lookupBatch(const Key keys[], std::size_t n, TID results[], ThreadInfo &threadEpocheInfo) const {
+        EpocheGuardReadonly epocheGuard(threadEpocheInfo);
+        LookupState states[lookupBatchWindow];
+        std::size_t nextKey = 0;
+        std::size_t active = 0;
+
+        while (active < lookupBatchWindow && nextKey < n) {
+            startLookup(states[active++], nextKey++);
+        }
+        std::size_t i = 0;
+        while (active > 0) {
+            LookupState &s = states[i];
+            if (lookupStep(s, keys[s.keyIndex], results[s.keyIndex])) {
+                if (nextKey < n) {
+                    startLookup(s, nextKey++);
+                } else {
+                    // fill the slot of the finished descent with the last one
+                    s = states[--active];
+                    if (i >= active) {
+                        i = 0;
+                    }
+                    continue;
+                }
+            }
+            if (++i == active) {
+                i = 0;
+            }
+        }
+    }
+
+    void Tree::startLookup(LookupState &s, std::size_t keyIndex) const {
+        s.keyIndex = keyIndex;
+        s.node = root;
+        s.parentNode = nullptr;
+        s.parentVersion = 0;
+        s.level = 0;
+        s.optimisticPrefixMatch = false;
+    }
+
+    // One step of a lookupBatch descent: handles s.node, whose cache lines have been prefetched by
+    // the previous step, and advances to its child. Returns true when the lookup of k is finished.
+    bool Tree::lookupStep(LookupState &s, const Key &k, TID &result) const {
+        bool needRestart = false;
+        N *node = s.node;
+        uint64_t v = node->readLockOrRestart(needRestart);
+        if (RESTARTED(LookupBatch, ReadLock, node, s.level)) {
+            startLookup(s, s.keyIndex);
+            return false;
+        }
+        if (s.parentNode != nullptr) {
+            s.parentNode->readUnlockOrRestart(s.parentVersion, needRestart);
+            if (RESTARTED(LookupBatch, ReadUnlock, s.parentNode, s.level)) {
+                startLookup(s, s.keyIndex);
+                return false;
+            }
+        }
+        switch (checkPrefix(node, k, s.level)) { // increases level
+            case CheckPrefixResult::NoMatch:
+                node->readUnlockOrRestart(v, needRestart);
+                if (RESTARTED(LookupBatch, ReadUnlock, node, s.level)) {
+                    startLookup(s, s.keyIndex);
+                    return false;
+                }
+                result = 0;
+                return true;
+            case CheckPrefixResult::OptimisticMatch:
+                s.optimisticPrefixMatch = true;
+                // fallthrough
+            case CheckPrefixResult::Match:
+                break;
+        }
+        uint8_t keyslice = 0;
+        // a key that ends at this level lives in keyslice 0
+        if (k.getKeyLen() > s.level) {
+            keyslice = k[s.level];
+        }
+        N *child = N::getChild(keyslice, node);
+        node->checkOrRestart(v, needRestart);
+        if (RESTARTED(LookupBatch, Check, node, s.level)) {
+            startLookup(s, s.keyIndex);
+            return false;
+        }
+        if (child == nullptr) {
+            result = 0;
+            return true;
+        }
+        if (N::isLeaf(child)) {
+            if (s.level < k.getKeyLen() || s.optimisticPrefixMatch) {
+                result = checkLeaf(child, k);
+            } else {
+                result = getLeafTid(child);
+            }
+            return true;
+        }
+        // header, prefix and the first keys of the child
+        __builtin_prefetch(child);
+        __builtin_prefetch(reinterpret_cast<const char *>(child) + 64);
+        s.parentNode = node;
+        s.parentVersion = v;
+        s.node = child;
+        s.level++;
+        return false;
+    }
+
     bool Tree::lookupRange(const Key &start, const Key &end, Key &continueKey, TID result[],
                                 std::size_t resultSize, std::size_t &resultsFound, ThreadInfo &threadEpocheInfo) const {
        return lookupRange(start, end, continueKey, result, resultSize, resultsFound, threadEpocheInfo, nullptr); 
@@ -179,244 +626,373 @@ namespace ART_OLC {
                 break;
             }
         }
-        EpocheGuard epocheGuard(threadEpocheInfo);
-        TID toContinue = 0;
-        
-        std::function<void(const N *, const N*, uint64_t)> copy = [&result, &resultSize, &resultsFound, &toContinue, &copy, transactional, &t_info](const N *node, const N* parentNode, uint64_t vers) {
-            if (N::isLeaf(node)) {
-                if (resultsFound == resultSize) {
-                    toContinue = N::getLeaf(node);
-                    return;
-                }
-                result[resultsFound] = N::getLeaf(node);
-                resultsFound++;
-                if(transactional){
-                    t_info->addKeyRS(N::getLeaf(node)); // add key in the read set - this is implemented inside TART
-                    t_info->addNodeNS(parentNode, vers); // add parent node together with its version in the node set - this is implemented inside TART
-                }
-            } else {
-                std::tuple<uint8_t, N *> children[256];
-                uint32_t childrenCount = 0;
-                uint64_t v = N::getChildren(node, 0u, 255u, children, childrenCount);
-                for (uint32_t i = 0; i < childrenCount; ++i) {
-                    const N *n = std::get<1>(children[i]);
-                    copy(n, node, v);
-                    if (toContinue != 0) {
-                        break;
-                    }
-                }
+        resultsFound = 0;
+
+        Cursor cursor(*this, threadEpocheInfo);
+        // an empty end is no bound
+        if (end.getKeyLen() > 0) {
+            cursor.setEnd(end);
+        }
+        if (transactional) {
+            // the node set has to stay valid until the transaction validates it
+            cursor.setRepinInterval(0);
+        }
+        cursor.seek(start);
+        TID tid;
+        while (cursor.next(tid)) {
+            if (resultsFound == resultSize) {
+                loadKey(tid, continueKey);
+                return true;
             }
-        };
-        std::function<void(N *, uint8_t, uint32_t, const N *, uint64_t)> findStart = [&copy, &start, &findStart, &toContinue, this](
-                N *node, uint8_t nodeK, uint32_t level, const N *parentNode, uint64_t vp) {
-            if (N::isLeaf(node)) {
-                copy(node, parentNode, vp);
-                return;
+            result[resultsFound] = tid;
+            resultsFound++;
+            if(transactional){
+                t_info->addKeyRS(tid); // add key in the read set - this is implemented inside TART
+                t_info->addNodeNS(cursor.getNode(), cursor.getNodeVersion()); // add parent node together with its version in the node set - this is implemented inside TART
             }
-            uint64_t v;
-            PCCompareResults prefixResult;
-
-            {
-                readAgain:
-                bool needRestart = false;
-                v = node->readLockOrRestart(needRestart);
-                if (needRestart) goto readAgain;
-
-                prefixResult = checkPrefixCompare(node, start, 0, level, loadKey, needRestart);
-                if (needRestart) goto readAgain;
+        }
+        return false;
+    }
 
-                parentNode->readUnlockOrRestart(vp, needRestart);
-                if (needRestart) {
-                    readParentAgain:
-                    vp = parentNode->readLockOrRestart(needRestart);
-                    if (needRestart) goto readParentAgain;
+    static void copyKey(Key &to, const Key &from) {
+        if (from.getKeyLen() == 0) {
+            to.setKeyLen(0);
+        } else {
+            to.set(reinterpret_cast<const char *>(&from[0]), from.getKeyLen());
+        }
+    }
 
-                    node = N::getChild(nodeK, parentNode);
+    static int compareKeys(const Key &a, const Key &b) {
+        uint32_t len = std::min(a.getKeyLen(), b.getKeyLen());
+        int c = len > 0 ? memcmp(&a[0], &b[0], len) : 0;
+        if (c != 0) {
+            return c;
+        }
+        return (a.getKeyLen() > b.getKeyLen()) - (a.getKeyLen() < b.getKeyLen());
+    }
 
-                    parentNode->readUnlockOrRestart(vp, needRestart);
-                    if (needRestart) goto readParentAgain;
+    bool Tree::lookupRangeReverse(const Key &start, const Key &end, Key &continueKey, TID result[],
+                                  std::size_t resultSize, std::size_t &resultsFound, ThreadInfo &threadEpocheInfo) const {
+        return lookupRangeReverse(start, end, continueKey, result, resultSize, resultsFound, threadEpocheInfo, nullptr);
+    }
 
-                    if (node == nullptr) {
-                        return;
-                    }
-                    if (N::isLeaf(node)) {
-                        copy(node, parentNode, vp);
-                        return;
-                    }
-                    goto readAgain;
-                }
-                node->readUnlockOrRestart(v, needRestart);
-                if (needRestart) goto readAgain;
+    bool Tree::lookupRangeReverse(const Key &start, const Key &end, Key &continueKey, TID result[],
+                                  std::size_t resultSize, std::size_t &resultsFound, ThreadInfo &threadEpocheInfo,
+                                  trans_info_range_t* t_info) const {
+        bool transactional = (t_info != nullptr);
+        for (uint32_t i = 0; i < std::min(start.getKeyLen(), end.getKeyLen()); ++i) {
+            if (start[i] > end[i]) {
+                resultsFound = 0;
+                return false;
+            } else if (start[i] < end[i]) {
+                break;
             }
+        }
+        resultsFound = 0;
 
-            switch (prefixResult) {
-                case PCCompareResults::Bigger:
-                    copy(node, parentNode, vp);
-                    break;
-                case PCCompareResults::Equal: {
-                    uint8_t startLevel = (start.getKeyLen() > level) ? start[level] : 0;
-                    std::tuple<uint8_t, N *> children[256];
-                    uint32_t childrenCount = 0;
-                    v = N::getChildren(node, startLevel, 255, children, childrenCount);
-                    for (uint32_t i = 0; i < childrenCount; ++i) {
-                        const uint8_t k = std::get<0>(children[i]);
-                        N *n = std::get<1>(children[i]);
-                        if (k == startLevel) {
-                            findStart(n, k, level + 1, node, v);
-                        } else if (k > startLevel) {
-                            copy(n, node, v);
-                        }
-                        if (toContinue != 0) {
-                            break;
-                        }
-                    }
-                    break;
+        Cursor cursor(*this, threadEpocheInfo, true);
+        cursor.setStart(start);
+        if (transactional) {
+            // the node set has to stay valid until the transaction validates it
+            cursor.setRepinInterval(0);
+        }
+        cursor.seek(end, false);
+        TID tid;
+        while (cursor.next(tid)) {
+            if (resultsFound == resultSize) {
+                if (resultsFound == 0) {
+                    copyKey(continueKey, end);
+                } else {
+                    loadKey(result[resultsFound - 1], continueKey);
                 }
-                case PCCompareResults::Smaller:
-                    break;
+                return true;
             }
-        };
-        std::function<void(N *, uint8_t, uint32_t, const N *, uint64_t)> findEnd = [&copy, &end, &toContinue, &findEnd, this](
-                N *node, uint8_t nodeK, uint32_t level, const N *parentNode, uint64_t vp) {
-            if (N::isLeaf(node)) {
-                return;
+            result[resultsFound] = tid;
+            resultsFound++;
+            if(transactional){
+                t_info->addKeyRS(tid);
+                t_info->addNodeNS(cursor.getNode(), cursor.getNodeVersion());
             }
-            uint64_t v;
-            PCCompareResults prefixResult;
-            {
-                readAgain:
-                bool needRestart = false;
-                v = node->readLockOrRestart(needRestart);
-                if (needRestart) goto readAgain;
+        }
+        return false;
+    }
 
-                prefixResult = checkPrefixCompare(node, end, 255, level, loadKey, needRestart);
-                if (needRestart) goto readAgain;
+    Tree::Cursor::Cursor(const Tree &tree, ThreadInfo &threadEpocheInfo, bool reverse) : tree(tree),
+                                                                                          threadEpocheInfo(threadEpocheInfo),
+                                                                                          reverse(reverse) {
+        threadEpocheInfo.getEpoche().pinEpoche(threadEpocheInfo);
+        stack.reserve(16);
+        repinInterval = tree.scanRepinInterval.load(std::memory_order_relaxed);
+    }
 
-                parentNode->readUnlockOrRestart(vp, needRestart);
-                if (needRestart) {
-                    readParentAgain:
-                    vp = parentNode->readLockOrRestart(needRestart);
-                    if (needRestart) goto readParentAgain;
+    Tree::Cursor::~Cursor() {
+        threadEpocheInfo.getEpoche().unpinEpoche(threadEpocheInfo);
+    }
 
-                    node = N::getChild(nodeK, parentNode);
+    void Tree::Cursor::setEnd(const Key &end) {
+        assert(!reverse);
+        copyKey(bound, end);
+        hasBound = true;
+    }
 
-                    parentNode->readUnlockOrRestart(vp, needRestart);
-                    if (needRestart) goto readParentAgain;
+    void Tree::Cursor::setStart(const Key &start) {
+        assert(reverse);
+        copyKey(bound, start);
+        hasBound = true;
+    }
 
-                    if (node == nullptr) {
-                        return;
-                    }
-                    if (N::isLeaf(node)) {
-                        return;
-                    }
-                    goto readAgain;
-                }
-                node->readUnlockOrRestart(v, needRestart);
-                if (needRestart) goto readAgain;
-            }
-            switch (prefixResult) {
-                case PCCompareResults::Smaller:
-                    copy(node, parentNode, vp);
-                    break;
-                case PCCompareResults::Equal: {
-                    uint8_t endLevel = (end.getKeyLen() > level) ? end[level] : 255;
-                    std::tuple<uint8_t, N *> children[256];
-                    uint32_t childrenCount = 0;
-                    v = N::getChildren(node, 0, endLevel, children, childrenCount);
-                    for (uint32_t i = 0; i < childrenCount; ++i) {
-                        const uint8_t k = std::get<0>(children[i]);
-                        N *n = std::get<1>(children[i]);
-                        if (k == endLevel) {
-                            findEnd(n, k, level + 1, node, v);
-                        } else if (k < endLevel) {
-                            copy(n, node, v);
-                        }
-                        if (toContinue != 0) {
-                            break;
-                        }
-                    }
-                    break;
-                }
-                case PCCompareResults::Bigger:
-                    break;
-            }
-        };
+    void Tree::Cursor::seek(const Key &k, bool inclusive) {
+        copyKey(seekKey, k);
+        seekInclusive = inclusive;
+        hasLast = false;
+        seekFrom(k, inclusive);
+    }
 
-        restart:
-        bool needRestart = false;
+    void Tree::Cursor::setRepinInterval(uint64_t keys) {
+        repinInterval = keys;
+        keysSinceRepin = 0;
+    }
 
-        resultsFound = 0;
+    void Tree::Cursor::repin() {
+        keysSinceRepin = 0;
+        if (finished) {
+            return;
+        }
+        if (hasLast) {
+            // the leaf of the last key can be freed too once the thread has left its epoche
+            Key kt;
+            tree.loadLeafKey(lastLeaf, kt);
+            copyKey(seekKey, kt);
+            seekInclusive = false;
+            hasLast = false;
+        }
+        lastNode = nullptr;
+        if (threadEpocheInfo.getEpoche().repinEpoche(threadEpocheInfo)) {
+            // the nodes on the stack may be gone as well
+            seekFrom(seekKey, seekInclusive);
+        }
+    }
 
-        uint32_t level = 0;
-        N *node = nullptr;
-        N *nextNode = root;
-        N *parentNode;
-        uint64_t v = 0;
-        uint64_t vp;
+    void Tree::Cursor::reseek() {
+        if (hasLast) {
+            Key kt;
+            tree.loadLeafKey(lastLeaf, kt);
+            seekFrom(kt, false);
+        } else {
+            seekFrom(seekKey, seekInclusive);
+        }
+    }
+
+    int16_t Tree::Cursor::step() const {
+        return reverse ? -1 : 1;
+    }
+
+    bool Tree::Cursor::checkBound(uint8_t k, uint32_t level, bool &onBoundPath) const {
+        if (bound.getKeyLen() <= level) {
+            // the keys are longer than the bound and share all of its bytes
+            onBoundPath = false;
+            return reverse;
+        }
+        if (reverse ? k < bound[level] : k > bound[level]) {
+            return false;
+        }
+        onBoundPath = k == bound[level];
+        return true;
+    }
+
+    bool Tree::Cursor::isBeyondBound(PCCompareResults prefixResult) const {
+        return prefixResult == (reverse ? PCCompareResults::Smaller : PCCompareResults::Bigger);
+    }
+
+    bool Tree::Cursor::isBeyondBound(TID leaf) const {
+        // the key equals the bound up to its leaf, only the whole key can tell
+        Key kt;
+        tree.loadLeafKey(leaf, kt);
+        int c = compareKeys(kt, bound);
+        return reverse ? c < 0 : c >= 0;
+    }
 
+    void Tree::Cursor::seekFrom(const Key &k, bool inclusive) {
+        restart:
+        stack.clear();
+        bufferCount = 0;
+        bufferPos = 0;
+        finished = false;
+
+        if (reverse && k.getKeyLen() == 0) {
+            // behind the last key, the root has no prefix
+            bool needRestart = false;
+            uint64_t v = tree.root->readLockOrRestart(needRestart);
+            if (RESTARTED(Scan, ReadLock, tree.root, 0)) goto restart;
+            stack.push_back(Frame{tree.root, v, 0, 255, hasBound});
+            return;
+        }
+
+        N *node = tree.root;
+        uint32_t level = 0;
+        bool onBoundPath = hasBound;
         while (true) {
-            parentNode = node;
-            vp = v;
-            node = nextNode;
-            PCEqualsResults prefixResult;
-            v = node->readLockOrRestart(needRestart);
-            if (needRestart) goto restart;
-            prefixResult = checkPrefixEquals(node, level, start, end, loadKey, needRestart);
-            if (needRestart) goto restart;
-            if (parentNode != nullptr) {
-                parentNode->readUnlockOrRestart(vp, needRestart);
-                if (needRestart) goto restart;
+            bool needRestart = false;
+            uint64_t v = node->readLockOrRestart(needRestart);
+            if (RESTARTED(Scan, ReadLock, node, level)) goto restart;
+
+            uint32_t prefixLevel = level;
+            PCCompareResults startResult = checkPrefixCompare(node, k, 0, prefixLevel, tree.loadLeafKey, needRestart);
+            if (RESTARTED(Scan, Prefix, node, level)) goto restart;
+            PCCompareResults boundResult = PCCompareResults::Equal;
+            if (onBoundPath) {
+                prefixLevel = level;
+                boundResult = checkPrefixCompare(node, bound, 0, prefixLevel, tree.loadLeafKey, needRestart);
+                if (RESTARTED(Scan, Prefix, node, level)) goto restart;
             }
+            level += node->getPrefixLength();
+            uint8_t startK = (k.getKeyLen() > level) ? k[level] : 0;
+            N *child = startResult == PCCompareResults::Equal ? N::getChild(startK, node) : nullptr;
             node->readUnlockOrRestart(v, needRestart);
-            if (needRestart) goto restart;
+            if (RESTARTED(Scan, ReadUnlock, node, level)) goto restart;
 
-            switch (prefixResult) {
-                case PCEqualsResults::NoMatch: {
-                    return false;
+            if (onBoundPath) {
+                if (isBeyondBound(boundResult)) {
+                    finished = true;
+                    return;
                 }
-                case PCEqualsResults::Contained: {
-                    copy(node, parentNode, vp);
-                    break;
+                onBoundPath = boundResult == PCCompareResults::Equal;
+            }
+            if (startResult != PCCompareResults::Equal) {
+                // either all keys of the node come after k in scan order or none does, then the
+                // scan continues in the parent
+                if (startResult == (reverse ? PCCompareResults::Smaller : PCCompareResults::Bigger)) {
+                    stack.push_back(Frame{node, v, level, static_cast<int16_t>(reverse ? 255 : 0), onBoundPath});
                 }
-                case PCEqualsResults::BothMatch: {
-                    uint8_t startLevel = (start.getKeyLen() > level) ? start[level] : 0;
-                    uint8_t endLevel = (end.getKeyLen() > level) ? end[level] : 255;
-                    if (startLevel != endLevel) {
-                        std::tuple<uint8_t, N *> children[256];
-                        uint32_t childrenCount = 0;
-                        v = N::getChildren(node, startLevel, endLevel, children, childrenCount);
-                        for (uint32_t i = 0; i < childrenCount; ++i) {
-                            const uint8_t k = std::get<0>(children[i]);
-                            N *n = std::get<1>(children[i]);
-                            if (k == startLevel) {
-                                findStart(n, k, level + 1, node, v);
-                            } else if (k > startLevel && k < endLevel) {
-                                copy(n, node, v);
-                            } else if (k == endLevel) {
-                                findEnd(n, k, level + 1, node, v);
-                            }
-                            if (toContinue) {
-                                break;
-                            }
-                        }
-                    } else {
-                        nextNode = N::getChild(startLevel, node);
-                        node->readUnlockOrRestart(v, needRestart);
-                        if (needRestart) goto restart;
-                        level++;
+                return;
+            }
+            stack.push_back(Frame{node, v, level, static_cast<int16_t>(startK + step()), onBoundPath});
+            if (child == nullptr) {
+                return;
+            }
+            if (onBoundPath && !checkBound(startK, level, onBoundPath)) {
+                finished = true;
+                return;
+            }
+            if (N::isLeaf(child)) {
+                Key kt;
+                tree.loadLeafKey(N::getLeaf(child), kt);
+                int c = compareKeys(kt, k);
+                if ((reverse ? c < 0 : c > 0) || (c == 0 && inclusive)) {
+                    stack.back().pos = startK;
+                }
+                return;
+            }
+            node = child;
+            level++;
+        }
+    }
+
+    bool Tree::Cursor::next(TID &tid) {
+        if (repinInterval != 0 && keysSinceRepin >= repinInterval) {
+            repin();
+        }
+        while (!finished && !stack.empty()) {
+            Frame &f = stack.back();
+            bool needRestart = false;
+            if (bufferPos == bufferCount) {
+                if (f.pos < 0 || f.pos > 255) {
+                    stack.pop_back();
+                    continue;
+                }
+                uint64_t v = f.node->readLockOrRestart(needRestart);
+                if (RESTARTED(Scan, ReadLock, f.node, f.level)) {
+                    if (N::isObsolete(v)) {
+                        reseek();
+                    }
+                    continue;
+                }
+                if (v != f.version) {
+                    if (f.onBoundPath) {
+                        // the prefix might have changed, which the bound check depends on
+                        reseek();
                         continue;
                     }
-                    break;
+                    // keyslices don't move, so the scan can go on behind pos in the changed node
+                    f.version = v;
+                }
+                if (reverse) {
+                    bufferCount = N::getPrevChildren(f.node, f.pos, bufferKeys, bufferChildren, bufferSize);
+                } else {
+                    bufferCount = N::getNextChildren(f.node, f.pos, bufferKeys, bufferChildren, bufferSize);
+                }
+                bufferPos = 0;
+                f.node->readUnlockOrRestart(v, needRestart);
+                if (RESTARTED(Scan, ReadUnlock, f.node, f.level)) {
+                    bufferCount = 0;
+                    continue;
+                }
+                if (bufferCount == 0) {
+                    stack.pop_back();
+                    continue;
                 }
             }
-            break;
-        }
-        if (toContinue != 0) {
-            loadKey(toContinue, continueKey);
-            return true;
-        } else {
-            return false;
+            uint8_t k = bufferKeys[bufferPos];
+            N *child = bufferChildren[bufferPos];
+
+            bool childOnBoundPath = false;
+            if (f.onBoundPath && !checkBound(k, f.level, childOnBoundPath)) {
+                finished = true;
+                return false;
+            }
+            if (N::isLeaf(child)) {
+                TID leaf = N::getLeaf(child);
+                if (childOnBoundPath && isBeyondBound(leaf)) {
+                    finished = true;
+                    return false;
+                }
+                tid = tree.getLeafTid(child);
+                bufferPos++;
+                f.pos = k + step();
+                lastLeaf = leaf;
+                hasLast = true;
+                lastNode = f.node;
+                lastNodeVersion = f.version;
+                keysSinceRepin++;
+                return true;
+            }
+
+            // a locked or replaced child makes us read the node again from its keyslice on
+            bufferCount = 0;
+            bufferPos = 0;
+            uint64_t childVersion = child->readLockOrRestart(needRestart);
+            if (RESTARTED(Scan, ReadLock, child, f.level)) continue;
+            uint32_t level = f.level + 1;
+            PCCompareResults boundResult = PCCompareResults::Equal;
+            if (childOnBoundPath) {
+                uint32_t prefixLevel = level;
+                boundResult = checkPrefixCompare(child, bound, 0, prefixLevel, tree.loadLeafKey, needRestart);
+                if (RESTARTED(Scan, Prefix, child, f.level)) continue;
+            }
+            level += child->getPrefixLength();
+            child->readUnlockOrRestart(childVersion, needRestart);
+            if (RESTARTED(Scan, ReadUnlock, child, f.level)) continue;
+
+            if (childOnBoundPath) {
+                if (isBeyondBound(boundResult)) {
+                    finished = true;
+                    return false;
+                }
+                childOnBoundPath = boundResult == PCCompareResults::Equal;
+            }
+            f.pos = k + step();
+            stack.push_back(Frame{child, childVersion, level, reverse ? static_cast<int16_t>(255) : static_cast<int16_t>(0),
+                                  childOnBoundPath});
         }
+        return false;
+    }
+
+    const N *Tree::Cursor::getNode() const {
+        return lastNode;
+    }
+
+    uint64_t Tree::Cursor::getNodeVersion() const {
+        return lastNodeVersion;
     }
 
 
@@ -459,7 +1035,7 @@ namespace ART_OLC {
             node = nextNode;
             auto v = node->readLockOrRestart(needRestart);
 			//PRINT_DEBUG("Is node locked? %u\n", node->isLocked(node->getVersion()))
-			if (needRestart)
+			if (RESTARTED(Insert, ReadLock, node, level))
 				goto restart;
 
             uint32_t nextLevel = level;
@@ -469,8 +1045,8 @@ namespace ART_OLC {
             
 			PRINT_DEBUG("next level = %u\n", nextLevel);
             auto res = checkPrefixPessimistic(node, k, nextLevel, nonMatchingKey, remainingPrefix,
-                                   this->loadKey, needRestart); // increases level
-            if (needRestart) goto restart;
+                                   this->loadLeafKey, needRestart); // increases level
+            if (RESTARTED(Insert, Prefix, node, level)) goto restart;
             switch (res) {
                 case CheckPrefixPessimisticResult::NoMatch: {
                     PRINT_DEBUG("Prefix mismatch!\n")
@@ -480,10 +1056,10 @@ namespace ART_OLC {
                     }
                     parentNode->upgradeToWriteLockOrRestart(parentVersion, needRestart);
                     //PRINT_DEBUG("-- Locking parent node %p\n", parentNode);
-					if (needRestart) goto restart;
+					if (RESTARTED(Insert, UpgradeToWriteLock, parentNode, level)) goto restart;
 					//PRINT_DEBUG("-- Locking node %p\n", node);
                     node->upgradeToWriteLockOrRestart(v, needRestart);
-                    if (needRestart) {
+                    if (RESTARTED(Insert, UpgradeToWriteLock, node, level)) {
                         parentNode->writeUnlock();
                         goto restart;
                     }
@@ -502,7 +1078,7 @@ namespace ART_OLC {
 					uint8_t keyslice = ((nextLevel >= k.getKeyLen()) ? 0 : k[nextLevel] );
 					PRINT_DEBUG("Inserting new leaf node in %c\n", keyslice)
 					if(!transactional)
-						newNode->insert(keyslice, N::setLeaf(tid));
+						newNode->insert(keyslice, newLeaf(k, tid));
 					else {
 						t_info->cur_node = newNode;
 						t_info->keyslice = keyslice;
@@ -524,11 +1100,15 @@ namespace ART_OLC {
                         ss<<"Setting prefix size " << (node->getPrefixLength() - ((nextLevel - level) + 1)) << ", node prefix length: "<<node->getPrefixLength()<<    ", nextLevel: "<< nextLevel <<", level: "<<level<<endl;
                         cout<<ss.str();
                     }*/
-                    node->setPrefix(remainingPrefix,
-                                    node->getPrefixLength() - ((nextLevel - level) + 1));
+                    // the remaining prefix comes from the node itself if it stores all of it
+                    const uint8_t *fullPrefix = node->getFullPrefix(node->getPrefixLength());
+                    node->setPrefix(fullPrefix != nullptr ? fullPrefix + (nextLevel - level) + 1 : remainingPrefix,
+                                    node->getPrefixLength() - ((nextLevel - level) + 1), epocheInfo);
 					// Dim STO: Do not unlock yet!
-                    if(!transactional)
+                    if(!transactional) {
 						node->writeUnlock();
+                        epocheInfo.addElements(1);
+                    }
 					else
 						t_info->l_node = node;
                     return;
@@ -550,20 +1130,26 @@ namespace ART_OLC {
 				nextNode = N::getChild(nodeKey, node);
 			}
             node->checkOrRestart(v,needRestart);
-            if (needRestart) goto restart;
+            if (RESTARTED(Insert, Check, node, level)) goto restart;
 			PRINT_DEBUG("level = %u\n", level)
 			PRINT_DEBUG("Keyslice at current level: %c\n", (char) nodeKey)
             if (nextNode == nullptr) {
 				PRINT_DEBUG("Next node is null, insert!\n")
-                N::insert(node, v, parentNode, parentVersion, parentKey, nodeKey, N::setLeaf(tid), needRestart, t_info, epocheInfo);
-                if (needRestart) goto restart;
+                N *leaf = newLeaf(k, tid);
+                N::insert(node, v, parentNode, parentVersion, parentKey, nodeKey, leaf, needRestart, t_info, epocheInfo);
+                if (RESTARTED(Insert, NodeInsert, node, level)) {
+                    deleteLeaf(leaf);
+                    goto restart;
+                }
+                if(!transactional)
+                    epocheInfo.addElements(1);
 				return;
             }
 
             if (parentNode != nullptr) {
 				//PRINT_DEBUG("Parent is non-null, read unlock!\n")
                 parentNode->readUnlockOrRestart(parentVersion, needRestart);
-                if (needRestart) goto restart;
+                if (RESTARTED(Insert, ReadUnlock, parentNode, level)) goto restart;
             }
 
             if (N::isLeaf(nextNode)) {
@@ -572,10 +1158,10 @@ namespace ART_OLC {
                 // Dimos: Do not get write lock if transactional as it could be an update! We don't need a write lock in the update when we are in transactional mode! The updated tid will be added in the write set and updated at STO commit time
                 if(!transactional) {
                     node->upgradeToWriteLockOrRestart(v, needRestart);
-				    if (needRestart) goto restart;
+				    if (RESTARTED(Insert, UpgradeToWriteLock, node, level)) goto restart;
                 }
                 Key key;
-                loadKey(N::getLeaf(nextNode), key);
+                loadLeafKey(N::getLeaf(nextNode), key);
                 // Dimos: Do not increase the level if we hit the '0' keyslice or we will go out of key bounds
                 //if(nodeKey != 0)
                 if(!levelBeyondKeyLength)
@@ -594,13 +1180,14 @@ namespace ART_OLC {
                 if(prefixLength + level == k.getKeyLen() && (k.getKeyLen() == key.getKeyLen())) { // update existing key!
                     PRINT_DEBUG("Updating!\n")
                     if(!transactional){
-                        PRINT_DEBUG("Updating from tid %lu to %lu\n", N::getLeaf(nextNode), tid)
-                        N::change(node, nodeKey, N::setLeaf(tid));
+                        PRINT_DEBUG("Updating from tid %lu to %lu\n", getLeafTid(nextNode), tid)
+                        N::change(node, nodeKey, newLeaf(k, tid));
                         node->writeUnlock();
+                        retireLeaf(nextNode, epocheInfo);
                     }
                     else {
                         t_info->updatedVal = tid;
-                        t_info->prevVal = N::getLeaf(nextNode);
+                        t_info->prevVal = getLeafTid(nextNode);
                         // we don't need to lock if it's an update!
                         //t_info->l_node = node;
                     }
@@ -619,7 +1206,7 @@ namespace ART_OLC {
 				// Dim STO: do not insert if transactional
 				PRINT_DEBUG("Inserting new leaf node in keyslice %c (level: %u, prefixLength: %u, key: %s)\n", keyslice, level, prefixLength, keyToStr(k).c_str())
 				if(!transactional)
-					n4->insert(keyslice, N::setLeaf(tid));
+					n4->insert(keyslice, newLeaf(k, tid));
 				else {
 					t_info->cur_node = n4;
 					t_info->keyslice = keyslice;
@@ -640,14 +1227,16 @@ namespace ART_OLC {
                 if(transactional){
                     t_info->updated_node1 = node_vers_t(node, v); // get the version before locking! Increases by 2 at lock!
                     node->upgradeToWriteLockOrRestart(v, needRestart);
-                    if (needRestart) goto restart;
+                    if (RESTARTED(Insert, UpgradeToWriteLock, node, level)) goto restart;
                 }
                 
                 // TODO node set: we might need to update the version number of this node, if in node set! Line 562: we do store node in the t_info->updated_node1.
                 N::change(node, k[level - 1], n4);
                 // Dim STO: do not unlock now!
-                if(!transactional)
+                if(!transactional) {
 					node->writeUnlock();
+                    epocheInfo.addElements(1);
+                }
 				else
 					t_info->l_node = node;
                 return;
@@ -657,6 +1246,242 @@ namespace ART_OLC {
         }
     }
 
+    static thread_local uint64_t updateRestarts = 0;
+
+    uint64_t Tree::getUpdateRestarts() {
+        return updateRestarts;
+    }
+
+    std::vector<RestartSite> Tree::getRestartStats(bool callingThreadOnly) {
+        std::vector<RestartSite> sites;
+#if ART_OLC_RESTART_STATS == 1
+        std::vector<RestartSite> all;
+        if (callingThreadOnly) {
+            threadRestarts.get().collect(all);
+        } else {
+            std::lock_guard<std::mutex> lock(restartTablesMutex);
+            for (RestartTable *table : restartTables) {
+                table->collect(all);
+            }
+            if (exitedRestarts != nullptr) {
+                exitedRestarts->collect(all);
+            }
+        }
+        // the same site in different tables
+        auto key = [](const RestartSite &site) {
+            return RestartTable::pack(site.operation, site.cause, site.line, site.level, site.nodeType);
+        };
+        std::sort(all.begin(), all.end(), [&](const RestartSite &a, const RestartSite &b) { return key(a) < key(b); });
+        for (const RestartSite &site : all) {
+            if (!sites.empty() && key(sites.back()) == key(site)) {
+                sites.back().count += site.count;
+            } else {
+                sites.push_back(site);
+            }
+        }
+        std::stable_sort(sites.begin(), sites.end(),
+                         [](const RestartSite &a, const RestartSite &b) { return a.count > b.count; });
+#else
+        (void) callingThreadOnly;
+#endif
+        return sites;
+    }
+
+    void Tree::resetRestartStats() {
+#if ART_OLC_RESTART_STATS == 1
+        std::lock_guard<std::mutex> lock(restartTablesMutex);
+        for (RestartTable *table : restartTables) {
+            table->reset();
+        }
+        if (exitedRestarts != nullptr) {
+            exitedRestarts->reset();
+        }
+#endif
+    }
+
+    void Tree::printRestartStats(FILE *out, bool callingThreadOnly) {
+        static const char *typeNames[nodeTypeCount] = {"N4", "N16", "N48", "N256", "N32"};
+        fprintf(out, "operation,cause,line,level,node type,restarts\n");
+        for (const RestartSite &site : getRestartStats(callingThreadOnly)) {
+            fprintf(out, "%s,%s,%u,%u,%s,%lu\n", restartOperationName(site.operation), restartCauseName(site.cause),
+                    site.line, site.level, typeNames[static_cast<unsigned>(site.nodeType)],
+                    static_cast<unsigned long>(site.count));
+        }
+    }
+
+    const char *Tree::restartOperationName(RestartOperation operation) {
+        static const char *names[] = {"lookup", "lookupBatch", "scan", "insert", "update", "remove"};
+        return names[static_cast<unsigned>(operation)];
+    }
+
+    const char *Tree::restartCauseName(RestartCause cause) {
+        static const char *names[] = {"readLock", "readUnlock", "check", "upgradeToWriteLock", "writeLock", "prefix",
+                                      "nodeInsert", "nodeRemove"};
+        return names[static_cast<unsigned>(cause)];
+    }
+
+    TID Tree::insertIfAbsent(const Key &k, TID tid, ThreadInfo &epocheInfo) {
+        bool applied;
+        return insertOrUpdate(k, tid, UpdateMode::InsertIfAbsent, 0, applied, epocheInfo);
+    }
+
+    TID Tree::upsert(const Key &k, TID tid, ThreadInfo &epocheInfo) {
+        bool applied;
+        return insertOrUpdate(k, tid, UpdateMode::Upsert, 0, applied, epocheInfo);
+    }
+
+    bool Tree::compareAndSwap(const Key &k, TID &expected, TID desired, ThreadInfo &epocheInfo) {
+        bool applied;
+        TID current = insertOrUpdate(k, desired, UpdateMode::CompareAndSwap, expected, applied, epocheInfo);
+        if (!applied) {
+            expected = current;
+        }
+        return applied;
+    }
+
+    TID Tree::insertOrUpdate(const Key &k, TID tid, UpdateMode mode, TID expected, bool &applied,
+                             ThreadInfo &epocheInfo) {
+        EpocheGuard epocheGuard(epocheInfo);
+        // a compare and swap that expects a TID must not insert
+        const bool mayInsert = mode != UpdateMode::CompareAndSwap || expected == 0;
+        uint32_t attempt = 0;
+        restart:
+        if (attempt++ > 0) {
+            updateRestarts++;
+        }
+        bool needRestart = false;
+        applied = false;
+
+        N *node = nullptr;
+        N *nextNode = root;
+        N *parentNode = nullptr;
+        uint8_t parentKey, nodeKey = 0;
+        uint64_t parentVersion = 0;
+        uint32_t level = 0;
+
+        while (true) {
+            parentNode = node;
+            parentKey = nodeKey;
+            node = nextNode;
+            auto v = node->readLockOrRestart(needRestart);
+            if (RESTARTED(Update, ReadLock, node, level)) goto restart;
+
+            uint32_t nextLevel = level;
+
+            uint8_t nonMatchingKey;
+            Prefix remainingPrefix;
+            auto res = checkPrefixPessimistic(node, k, nextLevel, nonMatchingKey, remainingPrefix,
+                                              this->loadLeafKey, needRestart); // increases level
+            if (RESTARTED(Update, Prefix, node, level)) goto restart;
+            if (res == CheckPrefixPessimisticResult::NoMatch) {
+                if (!mayInsert) {
+                    node->readUnlockOrRestart(v, needRestart);
+                    if (RESTARTED(Update, ReadUnlock, node, level)) goto restart;
+                    return 0;
+                }
+                parentNode->upgradeToWriteLockOrRestart(parentVersion, needRestart);
+                if (RESTARTED(Update, UpgradeToWriteLock, parentNode, level)) goto restart;
+                node->upgradeToWriteLockOrRestart(v, needRestart);
+                if (RESTARTED(Update, UpgradeToWriteLock, node, level)) {
+                    parentNode->writeUnlock();
+                    goto restart;
+                }
+                // same as insert: new parent N4 with the common prefix, the old node gets the remaining prefix
+                auto newNode = new N4(node->getPrefix(), nextLevel - level);
+                newNode->insert((nextLevel >= k.getKeyLen()) ? 0 : k[nextLevel], newLeaf(k, tid));
+                newNode->insert(nonMatchingKey, node);
+                N::change(parentNode, parentKey, newNode);
+                parentNode->writeUnlock();
+                const uint8_t *fullPrefix = node->getFullPrefix(node->getPrefixLength());
+                node->setPrefix(fullPrefix != nullptr ? fullPrefix + (nextLevel - level) + 1 : remainingPrefix,
+                                node->getPrefixLength() - ((nextLevel - level) + 1), epocheInfo);
+                node->writeUnlock();
+                applied = true;
+                epocheInfo.addElements(1);
+                return 0;
+            }
+            level = nextLevel;
+            bool levelBeyondKeyLength = level >= k.getKeyLen();
+            nodeKey = levelBeyondKeyLength ? 0 : k[level];
+            nextNode = N::getChild(nodeKey, node);
+            node->checkOrRestart(v, needRestart);
+            if (RESTARTED(Update, Check, node, level)) goto restart;
+
+            if (nextNode == nullptr) {
+                if (!mayInsert) {
+                    node->readUnlockOrRestart(v, needRestart);
+                    if (RESTARTED(Update, ReadUnlock, node, level)) goto restart;
+                    return 0;
+                }
+                N *leaf = newLeaf(k, tid);
+                N::insert(node, v, parentNode, parentVersion, parentKey, nodeKey, leaf, needRestart, nullptr,
+                          epocheInfo);
+                if (RESTARTED(Update, NodeInsert, node, level)) {
+                    deleteLeaf(leaf);
+                    goto restart;
+                }
+                applied = true;
+                epocheInfo.addElements(1);
+                return 0;
+            }
+
+            if (parentNode != nullptr) {
+                parentNode->readUnlockOrRestart(parentVersion, needRestart);
+                if (RESTARTED(Update, ReadUnlock, parentNode, level)) goto restart;
+            }
+
+            if (N::isLeaf(nextNode)) {
+                TID current = getLeafTid(nextNode);
+                Key key;
+                loadLeafKey(N::getLeaf(nextNode), key);
+                if (!levelBeyondKeyLength)
+                    level++;
+                uint32_t prefixLength = 0;
+                if (level < key.getKeyLen() && level < k.getKeyLen()) {
+                    while (key[level + prefixLength] == k[level + prefixLength]) {
+                        prefixLength++;
+                        if (level + prefixLength >= key.getKeyLen() || level + prefixLength >= k.getKeyLen())
+                            break;
+                    }
+                }
+                if (prefixLength + level == k.getKeyLen() && k.getKeyLen() == key.getKeyLen()) {
+                    // k is present, the leaf was read under v, so upgrading to the write lock keeps it current
+                    if (mode == UpdateMode::InsertIfAbsent ||
+                        (mode == UpdateMode::CompareAndSwap && current != expected)) {
+                        node->readUnlockOrRestart(v, needRestart);
+                        if (RESTARTED(Update, ReadUnlock, node, level)) goto restart;
+                        return current;
+                    }
+                    node->upgradeToWriteLockOrRestart(v, needRestart);
+                    if (RESTARTED(Update, UpgradeToWriteLock, node, level)) goto restart;
+                    N::change(node, nodeKey, newLeaf(k, tid));
+                    node->writeUnlock();
+                    retireLeaf(nextNode, epocheInfo);
+                    applied = true;
+                    return current;
+                }
+                if (!mayInsert) {
+                    node->readUnlockOrRestart(v, needRestart);
+                    if (RESTARTED(Update, ReadUnlock, node, level)) goto restart;
+                    return 0;
+                }
+                node->upgradeToWriteLockOrRestart(v, needRestart);
+                if (RESTARTED(Update, UpgradeToWriteLock, node, level)) goto restart;
+                // the leaf is replaced by an N4 with both keys below their common prefix
+                auto n4 = new N4((level < k.getKeyLen() ? &k[level] : nullptr), prefixLength);
+                n4->insert((level + prefixLength < k.getKeyLen()) ? k[level + prefixLength] : 0, newLeaf(k, tid));
+                n4->insert((level + prefixLength < key.getKeyLen()) ? key[level + prefixLength] : 0, nextNode);
+                N::change(node, nodeKey, n4);
+                node->writeUnlock();
+                applied = true;
+                epocheInfo.addElements(1);
+                return 0;
+            }
+            level++;
+            parentVersion = v;
+        }
+    }
+
     void Tree::remove(const Key&k, TID tid, ThreadInfo &threadInfo){
         remove(k, tid, threadInfo, nullptr);
     }
@@ -680,12 +1505,12 @@ namespace ART_OLC {
             parentKey = nodeKey;
             node = nextNode;
             auto v = node->readLockOrRestart(needRestart);
-            if (needRestart) goto restart;
+            if (RESTARTED(Remove, ReadLock, node, level)) goto restart;
 
             switch (checkPrefix(node, k, level)) { // increases level
                 case CheckPrefixResult::NoMatch:
 					node->readUnlockOrRestart(v, needRestart);
-                    if (needRestart) goto restart;
+                    if (RESTARTED(Remove, ReadUnlock, node, level)) goto restart;
                     if(transactional)
                         t_info->shouldAbort = true; // let the caller know that the element was not deleted! We are using the shouldAbort field so that to not include an extra field for 'deleted'
 					return;
@@ -700,19 +1525,19 @@ namespace ART_OLC {
 					nextNode = N::getChild(nodeKey, node);
 
                     node->checkOrRestart(v, needRestart);
-                    if (needRestart) goto restart;
+                    if (RESTARTED(Remove, Check, node, level)) goto restart;
                     if (nextNode == nullptr) {
                         node->readUnlockOrRestart(v, needRestart);
-                        if (needRestart) goto restart;
+                        if (RESTARTED(Remove, ReadUnlock, node, level)) goto restart;
                         if(transactional)
                             t_info->shouldAbort = true; // let the caller know that the element was not deleted! We are using the shouldAbort field so that to not include an extra field for 'deleted'
 						return;
                     }
                     if (N::isLeaf(nextNode)) {
-                        if (N::getLeaf(nextNode) != tid) {
-							cout <<"TID mismatch! provided tid: "<< tid<<", found TID: " << N::getLeaf(nextNode) << ". Will not remove!"<<endl;
+                        if (getLeafTid(nextNode) != tid) {
+							PRINT_DEBUG("TID mismatch! provided tid: %lu, found TID: %lu. Will not remove!\n", tid, getLeafTid(nextNode))
                             node->readUnlockOrRestart(v, needRestart);
-                            if (needRestart) goto restart;
+                            if (RESTARTED(Remove, ReadUnlock, node, level)) goto restart;
                             if(transactional)
                                 t_info->shouldAbort = true; // let the caller know that the element was not deleted! We are using the shouldAbort field so that to not include an extra field for 'deleted'
                             return;
@@ -720,10 +1545,10 @@ namespace ART_OLC {
                         assert(parentNode == nullptr || node->getCount() != 1);
                         if (node->getCount() == 2 && parentNode != nullptr) {
                             parentNode->upgradeToWriteLockOrRestart(parentVersion, needRestart);
-                            if (needRestart) goto restart;
+                            if (RESTARTED(Remove, UpgradeToWriteLock, parentNode, level)) goto restart;
 
                             node->upgradeToWriteLockOrRestart(v, needRestart);
-                            if (needRestart) {
+                            if (RESTARTED(Remove, UpgradeToWriteLock, node, level)) {
                                 parentNode->writeUnlock();
                                 goto restart;
                             }
@@ -736,10 +1561,10 @@ namespace ART_OLC {
                                 N::change(parentNode, parentKey, secondNodeN);
                                 parentNode->writeUnlock();
                                 node->writeUnlockObsolete();
-                                this->epoche.markNodeForDeletion(node, threadInfo);
+                                N::markNodeForDeletion(node, threadInfo);
                             } else {
                                 secondNodeN->writeLockOrRestart(needRestart);
-                                if (needRestart) {
+                                if (RESTARTED(Remove, WriteLock, secondNodeN, level)) {
                                     node->writeUnlock();
                                     parentNode->writeUnlock();
                                     goto restart;
@@ -748,17 +1573,19 @@ namespace ART_OLC {
                                 //N::remove(node, k[level]); not necessary
                                 N::change(parentNode, parentKey, secondNodeN);
 								parentNode->writeUnlock();
-                                secondNodeN->addPrefixBefore(node, secondNodeK);
+                                secondNodeN->addPrefixBefore(node, secondNodeK, threadInfo);
 								secondNodeN->writeUnlock();
 								node->writeUnlockObsolete();
-								this->epoche.markNodeForDeletion(node, threadInfo);
+								N::markNodeForDeletion(node, threadInfo);
                             }
                         } else {
 							// Dimos: 0 case
                             //N::remove(node, v, k[level], parentNode, parentVersion, parentKey, needRestart, threadInfo);
                             N::remove(node, v, nodeKey, parentNode, parentVersion, parentKey, needRestart, threadInfo);
-                            if (needRestart) goto restart;
+                            if (RESTARTED(Remove, NodeRemove, node, level)) goto restart;
                         }
+                        retireLeaf(nextNode, threadInfo);
+                        threadInfo.addElements(-1);
                         return;
                     }
                     level++;
@@ -773,19 +1600,26 @@ namespace ART_OLC {
         if (n->hasPrefix()) {
 			//PRINT_DEBUG("checkPrefix()-> Key length: %u, level: %u, prefix length: %u, node has keyslice 0? %u\n", k.getKeyLen(), level, n->getPrefixLength(), N::getChild(0, n)!=nullptr)
 			// Dimos: handle the 0 case
-			if (k.getKeyLen() < level + n->getPrefixLength() || ( k.getKeyLen() == level + n->getPrefixLength() && N::getChild(0, n) == nullptr ) ) {
+            uint32_t prefixLength = n->getPrefixLength();
+			if (k.getKeyLen() < level + prefixLength || ( k.getKeyLen() == level + prefixLength && N::getChild(0, n) == nullptr ) ) {
 				PRINT_DEBUG("1) No match!")
 				return CheckPrefixResult::NoMatch;
             }
-            for (uint32_t i = 0; i < std::min(n->getPrefixLength(), maxStoredPrefixLength); ++i) {
-                if (n->getPrefix()[i] != k[level]) {
+            const uint8_t *prefix = n->getFullPrefix(prefixLength);
+            uint32_t storedLength = prefixLength;
+            if (prefix == nullptr) {
+                storedLength = maxStoredPrefixLength;
+                prefix = n->getFullPrefix(storedLength);
+            }
+            for (uint32_t i = 0; i < storedLength; ++i) {
+                if (prefix[i] != k[level]) {
 					PRINT_DEBUG("2) No match!")
 					return CheckPrefixResult::NoMatch;
                 }
                 ++level;
             }
-            if (n->getPrefixLength() > maxStoredPrefixLength) {
-                level = level + (n->getPrefixLength() - maxStoredPrefixLength);
+            if (prefixLength > storedLength) {
+                level = level + (prefixLength - storedLength);
                 return CheckPrefixResult::OptimisticMatch;
             }
         }
@@ -816,20 +1650,21 @@ namespace ART_OLC {
                 return CheckPrefixPessimisticResult::Match;
             }
             v = n->readLockOrRestart(needRestart);
+            const uint8_t *fullPrefix = n->getFullPrefix(prefixLen);
             for (uint32_t i = 0; i < prefixLen; ++i) {
                 // Dimos: fixed bug: We must check whether node changed by a concurrent thread!
                 //auto v = n->readLockOrRestart(needRestart);
 				//PRINT_DEBUG("Key length: %u, prefix length: %u, level: %u\n", k.getKeyLen(), prefixLen, level)
-                if (i == maxStoredPrefixLength) {
+                if (i == maxStoredPrefixLength && fullPrefix == nullptr) {
                     auto anyTID = N::getAnyChildTid(n, needRestart);
                     if (needRestart) return CheckPrefixPessimisticResult::Match;
                     loadKey(anyTID, kt);
                 }
-                uint8_t curKey = i >= maxStoredPrefixLength ? kt[level] : n->getPrefix()[i];
+                uint8_t curKey = fullPrefix != nullptr ? fullPrefix[i] : i >= maxStoredPrefixLength ? kt[level] : n->getPrefix()[i];
                 // Dimos: the 0 case: level is >= than the given key length: prefix mismatch (case with STOHASTIC, STOH and inserting STO)!
 				if (level >= k.getKeyLen() || curKey != k[level]) {
                     nonMatchingKey = curKey;
-                    if (prefixLen > maxStoredPrefixLength) {
+                    if (fullPrefix == nullptr) {
 						PRINT_DEBUG("prefix length is greater than the max stored prefix length!\n")
                         if (i < maxStoredPrefixLength) {
                             auto anyTID = N::getAnyChildTid(n, needRestart);
@@ -863,7 +1698,7 @@ namespace ART_OLC {
                             needRestart = true;
                             return CheckPrefixPessimisticResult::Match;
                         }*/
-					    memcpy(nonMatchingPrefix, n->getPrefix() + i + 1, prefixLen - i - 1);
+					    memcpy(nonMatchingPrefix, fullPrefix + i + 1, std::min(prefixLen - i - 1, maxStoredPrefixLength));
                     }
                     n->readUnlockOrRestart(v, needRestart);
                     if(needRestart){
@@ -886,15 +1721,17 @@ namespace ART_OLC {
                                                         LoadKeyFunction loadKey, bool &needRestart) {
         if (n->hasPrefix()) {
             Key kt;
-            for (uint32_t i = 0; i < n->getPrefixLength(); ++i) {
-                if (i == maxStoredPrefixLength) {
+            uint32_t prefixLength = n->getPrefixLength();
+            const uint8_t *fullPrefix = n->getFullPrefix(prefixLength);
+            for (uint32_t i = 0; i < prefixLength; ++i) {
+                if (i == maxStoredPrefixLength && fullPrefix == nullptr) {
                     auto anyTID = N::getAnyChildTid(n, needRestart);
                     if (needRestart) return PCCompareResults::Equal;
                     loadKey(anyTID, kt);
                 }
                 uint8_t kLevel = (k.getKeyLen() > level) ? k[level] : fillKey;
 
-                uint8_t curKey = i >= maxStoredPrefixLength ? kt[level] : n->getPrefix()[i];
+                uint8_t curKey = fullPrefix != nullptr ? fullPrefix[i] : i >= maxStoredPrefixLength ? kt[level] : n->getPrefix()[i];
                 if (curKey < kLevel) {
                     return PCCompareResults::Smaller;
                 } else if (curKey > kLevel) {
@@ -910,8 +1747,10 @@ namespace ART_OLC {
                                                       LoadKeyFunction loadKey, bool &needRestart) {
         if (n->hasPrefix()) {
             Key kt;
-            for (uint32_t i = 0; i < n->getPrefixLength(); ++i) {
-                if (i == maxStoredPrefixLength) {
+            uint32_t prefixLength = n->getPrefixLength();
+            const uint8_t *fullPrefix = n->getFullPrefix(prefixLength);
+            for (uint32_t i = 0; i < prefixLength; ++i) {
+                if (i == maxStoredPrefixLength && fullPrefix == nullptr) {
                     auto anyTID = N::getAnyChildTid(n, needRestart);
                     if (needRestart) return PCEqualsResults::BothMatch;
                     loadKey(anyTID, kt);
@@ -919,7 +1758,7 @@ namespace ART_OLC {
                 uint8_t startLevel = (start.getKeyLen() > level) ? start[level] : 0;
                 uint8_t endLevel = (end.getKeyLen() > level) ? end[level] : 255;
 
-                uint8_t curKey = i >= maxStoredPrefixLength ? kt[level] : n->getPrefix()[i];
+                uint8_t curKey = fullPrefix != nullptr ? fullPrefix[i] : i >= maxStoredPrefixLength ? kt[level] : n->getPrefix()[i];
                 if (curKey > startLevel && curKey < endLevel) {
                     return PCEqualsResults::Contained;
                 } else if (curKey < startLevel || curKey > endLevel) {
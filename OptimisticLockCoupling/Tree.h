@@ -7,7 +7,6 @@
 
  // Dimos: This is used for the tree size metric, needed by merge
 #define MEASURE_TREE_SIZE 0
-#define N_THREADS 20
 
 #include "N.h"
 
@@ -18,12 +17,20 @@
 //#include "../../TART.hh"
 //template <typename T, typename BloomT> class TART;
 
+#include <cstdio>
+#include <functional>
 #include <string>
+#include <vector>
 
 using namespace ART;
 
 #define MEASURE_ART_NODE_ACCESSES 0
 
+// counts the restarts of the optimistic lock coupling by call site in every thread, see Tree::getRestartStats
+#ifndef ART_OLC_RESTART_STATS
+#define ART_OLC_RESTART_STATS 0
+#endif
+
 namespace ART_OLC {
 
 using node_vers_t = std::tuple<N*, uint64_t>;
@@ -64,17 +71,87 @@ using node_vers_t = std::tuple<N*, uint64_t>;
     }trans_info_range_t;
 
 
+    /**
+     * What the leaves of a tree hold. TidOnly leaves are the TIDs themselves, lookups that end in a leaf call
+     * loadKey to verify the key. EmbeddedKey leaves are KeyLeafs with a copy of the key: lookups and prefix checks
+     * don't call loadKey, for one allocation per key. EmbeddedKey trees are not available in transactional mode.
+     */
+    enum class LeafMode : uint8_t {
+        TidOnly,
+        EmbeddedKey
+    };
+
+    enum class RestartOperation : uint8_t {
+        Lookup,
+        LookupBatch,
+        // Cursor and lookupRange
+        Scan,
+        Insert,
+        // insertIfAbsent, upsert and compareAndSwap
+        Update,
+        Remove
+    };
+
+    // the check that failed
+    enum class RestartCause : uint8_t {
+        ReadLock,
+        ReadUnlock,
+        Check,
+        UpgradeToWriteLock,
+        WriteLock,
+        // a checkPrefix* that had to read the node again
+        Prefix,
+        // N::insert and N::remove, which lock the node and its parent when they grow or shrink it
+        NodeInsert,
+        NodeRemove
+    };
+
+    /**
+     * The restarts at one call site of Tree.cpp with one operation, key level and node type. The level is the
+     * key byte the operation had reached, the node type that of the node whose check failed.
+     */
+    struct RestartSite {
+        RestartOperation operation;
+        RestartCause cause;
+        uint32_t line;
+        uint32_t level;
+        NTypes nodeType;
+        uint64_t count;
+    };
+
+    /**
+     * Shape of a tree, see Tree::stats. The depth of a leaf is the number of inner nodes above it, the root's
+     * leaves have depth 1. bytes are the sizes of the inner nodes, their out of line prefixes and the KeyLeafs,
+     * without the size class rounding of NodeAllocator.
+     */
+    struct TreeStats {
+        uint64_t nodes[nodeTypeCount] = {};
+        // of all nodes of a type
+        uint64_t children[nodeTypeCount] = {};
+        uint64_t leaves = 0;
+        // leafDepths[d] leaves have depth d
+        std::vector<uint64_t> leafDepths;
+        // prefixLengths[l] inner nodes have a prefix of l bytes
+        std::vector<uint64_t> prefixLengths;
+        // inner nodes with more than maxStoredPrefixLength prefix bytes, which are checked against a leaf unless
+        // the node has a LongPrefix
+        uint64_t prefixesBeyondStored = 0;
+        std::size_t bytes = 0;
+
+        double averageFanout(NTypes type) const {
+            unsigned t = static_cast<unsigned>(type);
+            return nodes[t] == 0 ? 0 : static_cast<double>(children[t]) / nodes[t];
+        }
+    };
+
     class Tree {
     
-    N *const root;
+    // nullptr once the tree is moved from
+    N *root;
 
     public:
         using LoadKeyFunction = void (*)(TID tid, Key &key);
 
-        #if MEASURE_TREE_SIZE == 1
-        uint64_t tree_sz[N_THREADS];
-        #endif
-
         //Dim: Testing
         // It should be public, so that to be used in HybridTART when merging
         LoadKeyFunction loadKey;
@@ -92,8 +169,62 @@ using node_vers_t = std::tuple<N*, uint64_t>;
 
         TID checkKey(const TID tid, const Key &k) const;
 
+        const LeafMode leafMode;
+
+        // loads the key of a leaf, i.e. of what N::getLeaf returns
+        LoadKeyFunction loadLeafKey;
+
+        N *newLeaf(const Key &k, TID tid) const;
+
+        // the TID of a leaf
+        TID getLeafTid(const N *leaf) const;
+
+        // the TID of a leaf if its key is k, else 0
+        TID checkLeaf(const N *leaf, const Key &k) const;
+
+        // frees a leaf that never was in the tree
+        void deleteLeaf(N *leaf) const;
+
+        // hands the KeyLeaf of an unlinked leaf to the Epoche
+        void retireLeaf(const N *leaf, ThreadInfo &threadInfo);
+
+        static void deleteKeyLeaves(N *node);
+
         Epoche epoche{256};
 
+        // keys of the bulk load, size() adds them to the counters of the threads, which count the removes of them
+        int64_t bulkLoadedElements = 0;
+
+        std::atomic<uint64_t> scanRepinInterval{0};
+
+        // number of descents lookupBatch keeps in flight at the same time
+        static constexpr std::size_t lookupBatchWindow = 16;
+
+        // state of one in-flight descent of lookupBatch
+        struct LookupState {
+            std::size_t keyIndex;
+            N *node;
+            N *parentNode;
+            uint64_t parentVersion;
+            uint32_t level;
+            bool optimisticPrefixMatch;
+        };
+
+        void startLookup(LookupState &s, std::size_t keyIndex) const;
+
+        bool lookupStep(LookupState &s, const Key &k, TID &result) const;
+
+        enum class UpdateMode : uint8_t {
+            InsertIfAbsent,
+            Upsert,
+            CompareAndSwap
+        };
+
+        // single descent of insertIfAbsent, upsert and compareAndSwap, returns the TID of k before the call
+        // (0 if absent) and sets applied if the tree was changed
+        TID insertOrUpdate(const Key &k, TID tid, UpdateMode mode, TID expected, bool &applied,
+                           ThreadInfo &epocheInfo);
+
     public:
 
         enum class CheckPrefixResult : uint8_t {
@@ -140,36 +271,225 @@ using node_vers_t = std::tuple<N*, uint64_t>;
 
     public:
 
-        Tree(LoadKeyFunction loadKey);
+        // with ReclaimMode::Background a thread of the tree frees the removed nodes, with
+        // ReclaimScheme::QuiescentState lookups don't store their epoche but the threads have to call quiescent(),
+        // see Epoche.h
+        Tree(LoadKeyFunction loadKey, LeafMode leafMode = LeafMode::TidOnly,
+             ReclaimMode reclaimMode = ReclaimMode::Inline, ReclaimScheme reclaimScheme = ReclaimScheme::EpochBased);
+
+        // Builds the tree from the n keys in ascending order without duplicates, tids[i] being the TID of keys[i].
+        // Nodes are created at their final size, the subtrees below the top levels are built by the given
+        // number of threads. Throws std::invalid_argument if the keys are not ascending or have duplicates, see
+        // BulkLoad.h.
+        Tree(LoadKeyFunction loadKey, const Key keys[], const TID tids[], std::size_t n, unsigned threads = 1,
+             LeafMode leafMode = LeafMode::TidOnly, ReclaimMode reclaimMode = ReclaimMode::Inline,
+             ReclaimScheme reclaimScheme = ReclaimScheme::EpochBased);
 
         Tree(const Tree &) = delete;
 
-        Tree(Tree &&t) : root(t.root), loadKey(t.loadKey) { }
+        // takes over the nodes, the element count and the settings of t, which is left without a root and may only
+        // be destroyed
+        Tree(Tree &&t);
+
+        LeafMode getLeafMode() const;
 
         ~Tree();
 
         ThreadInfo getThreadInfo();
 
-        #if MEASURE_TREE_SIZE == 1
-        uint64_t getTreeSize(void);
-        #endif
+        // retired nodes that are not freed yet, per thread, and the thread that holds back their reclamation
+        EpocheStats getEpocheStats() const;
+
+        // with ReclaimScheme::QuiescentState, called by every thread regularly between its operations
+        void quiescent(ThreadInfo &threadInfo);
+
+        // Pins the thread until the session is destroyed, e.g. auto s = tree.pin(threadInfo), so that the
+        // operations in between don't store its epoche. The session moves on to the current epoche every
+        // repinInterval operations, so that removed nodes still get freed.
+        EpocheSession pin(ThreadInfo &threadInfo, uint32_t repinInterval = 1024) const;
+
+        // bytes of removed nodes that may wait to be freed before writers get throttled, 0 for no limit, see
+        // Epoche::setRetiredBudget
+        void setRetiredBudget(std::size_t bytes);
+
+        // lookupRange and lookupRangeReverse re-pin their cursor every this many keys, 0 for never, see
+        // Cursor::setRepinInterval
+        void setScanRepinInterval(uint64_t keys);
+
+        // Number of keys, from a counter per thread that insert, remove and the update functions maintain after
+        // they have changed the tree. The counters are summed in O(threads), the operations that run meanwhile may
+        // be missing from the result.
+        // The keys of the bulk-load constructor are counted by the tree.
+        uint64_t size() const;
+
+        // In transactional mode insert leaves the new leaf to the caller, which counts it here once it is in the
+        // tree. remove counts itself in both modes.
+        void addElements(int64_t delta, ThreadInfo &threadInfo);
 
         TID lookup(const Key &k, ThreadInfo &threadEpocheInfo) const;
 		// Dim: For transactional ART
 		TID lookup(const Key &k, ThreadInfo &threadEpocheInfo, trans_info_t* t_info) const;
         TID lookup(const Key &k, ThreadInfo &threadEpocheInfo, trans_info_t* t_info, N* startNode) const;
 
+        // Looks up keys[0..n) and writes the found TIDs (0 if absent) to results[0..n).
+        // The descents are interleaved and the next node of each one is prefetched, so that
+        // the cache misses of independent keys overlap. Not available in transactional mode.
+        void lookupBatch(const Key keys[], std::size_t n, TID results[], ThreadInfo &threadEpocheInfo) const;
+
+        // Counts the inner nodes by type, counts[t] being the number of nodes of NTypes t. Nodes that get replaced
+        // by concurrent writers during the traversal are missed.
+        void getNodeTypeHistogram(uint64_t counts[nodeTypeCount], ThreadInfo &threadEpocheInfo) const;
+
+        // Walks the whole tree, each inner node is read at a single version. Concurrent writers don't block it, but
+        // the nodes they replace during the walk are missed, so the result is no snapshot. The thread stays in its
+        // epoche for the walk, which holds back the reclamation of all threads.
+        TreeStats stats(ThreadInfo &threadEpocheInfo) const;
+
+        /**
+         * Iterates over the TIDs in key order, or in descending key order if reverse, e.g. for scans that don't fit
+         * into a result array. The cursor keeps the thread pinned in its epoche until it is destroyed, so that the
+         * nodes on its stack stay valid.
+         */
+        class Cursor {
+        public:
+            Cursor(const Tree &tree, ThreadInfo &threadEpocheInfo, bool reverse = false);
+
+            Cursor(const Cursor &) = delete;
+
+            ~Cursor();
+
+            // forward: stop before the first key >= end, has to be set before seek
+            void setEnd(const Key &end);
+
+            // reverse: stop after the last key >= start, has to be set before seek
+            void setStart(const Key &start);
+
+            // forward: position the cursor before the first key >= k (> k if not inclusive),
+            // reverse: before the last key <= k (< k if not inclusive). An empty key seeks to the start, or in
+            // reverse to behind the last key.
+            void seek(const Key &k, bool inclusive = true);
+
+            // returns false if there are no more keys
+            bool next(TID &tid);
+
+            // node that contains the last returned TID, and its version when the TID was read
+            const N *getNode() const;
+
+            uint64_t getNodeVersion() const;
+
+            // Moves the thread to the current epoche, so that the nodes removed since the cursor was pinned can be
+            // freed. The scan goes on behind the last returned key, from the root. getNode() is invalid until next.
+            void repin();
+
+            // next() re-pins the cursor every this many keys, 0 (the default) for never
+            void setRepinInterval(uint64_t keys);
+
+        private:
+            struct Frame {
+                N *node;
+                uint64_t version;
+                // key level of the node's keyslices
+                uint32_t level;
+                // next keyslice to visit, -1 or 256 if there is none
+                int16_t pos;
+                // all keys of the node share the bound's bytes up to level
+                bool onBoundPath;
+            };
+
+            const Tree &tree;
+            ThreadInfo &threadEpocheInfo;
+            const bool reverse;
+
+            std::vector<Frame> stack;
+            bool finished = false;
+
+            // children of the top frame from pos on, read under its version
+            static constexpr uint32_t bufferSize = 16;
+            uint8_t bufferKeys[bufferSize];
+            N *bufferChildren[bufferSize];
+            uint32_t bufferCount = 0;
+            uint32_t bufferPos = 0;
+
+            Key seekKey;
+            bool seekInclusive = true;
+            // end (exclusive) when going forward, start (inclusive) in reverse
+            Key bound;
+            bool hasBound = false;
+
+            // leaf of the last returned TID
+            TID lastLeaf = 0;
+            bool hasLast = false;
+            const N *lastNode = nullptr;
+            uint64_t lastNodeVersion = 0;
+
+            uint64_t repinInterval = 0;
+            uint64_t keysSinceRepin = 0;
+
+            void seekFrom(const Key &k, bool inclusive);
+
+            // rebuilds the stack behind the last returned key after a node on it got replaced
+            void reseek();
+
+            // returns false if keyslice k at level is beyond the bound, else whether it is still on the bound path
+            bool checkBound(uint8_t k, uint32_t level, bool &onBoundPath) const;
+
+            bool isBeyondBound(PCCompareResults prefixResult) const;
+
+            bool isBeyondBound(TID leaf) const;
+
+            int16_t step() const;
+        };
+
+        // Finds the TIDs of the keys in [start, end), of all keys >= start if end is empty. Returns true if there are
+        // more than resultLen of them, continueKey is then set to the first key that is not in result.
         bool lookupRange(const Key &start, const Key &end, Key &continueKey, TID result[], std::size_t resultLen,
                          std::size_t &resultCount, ThreadInfo &threadEpocheInfo) const;
         // Dim: For transactional ART
         bool lookupRange(const Key &start, const Key &end, Key &continueKey, TID result[], std::size_t resultLen,
                         std::size_t &resultCount, ThreadInfo &threadEpocheInfo, trans_info_range_t* t_info) const;
 
+        // Like lookupRange, but result is in descending key order, i.e. it starts with the last key < end, or with
+        // the last key if end is empty. Returns true if there are more than resultLen keys, continueKey is then
+        // set to the last key in result, which is the end for the next call.
+        bool lookupRangeReverse(const Key &start, const Key &end, Key &continueKey, TID result[], std::size_t resultLen,
+                                std::size_t &resultCount, ThreadInfo &threadEpocheInfo) const;
+
+        bool lookupRangeReverse(const Key &start, const Key &end, Key &continueKey, TID result[], std::size_t resultLen,
+                                std::size_t &resultCount, ThreadInfo &threadEpocheInfo, trans_info_range_t* t_info) const;
+
         void insert(const Key &k, TID tid, ThreadInfo &epocheInfo);
 
 		// Dim STO: insert function to provide transactinal information for STO
 		void insert(const Key &k, TID tid, ThreadInfo &epocheInfo, trans_info_t* t_info);
 
+        // Inserts k if it is absent and returns 0, else returns its TID and leaves it unchanged.
+        TID insertIfAbsent(const Key &k, TID tid, ThreadInfo &epocheInfo);
+
+        // Inserts k or replaces its TID, returns the previous TID (0 if k was absent).
+        TID upsert(const Key &k, TID tid, ThreadInfo &epocheInfo);
+
+        // Replaces the TID of k by desired if it is expected, an expected TID of 0 stands for an absent key.
+        // Returns false and sets expected to the current TID (0 if absent) otherwise.
+        // These three don't write lock anything if they don't change the tree, and only the node holding k
+        // if they replace its TID.
+        bool compareAndSwap(const Key &k, TID &expected, TID desired, ThreadInfo &epocheInfo);
+
+        // number of restarts of insertIfAbsent, upsert and compareAndSwap in the calling thread
+        static uint64_t getUpdateRestarts();
+
+        // The restarts of all trees since the last reset, of all threads (including ones that have exited) or of the
+        // calling one, most frequent first. Empty unless built with ART_OLC_RESTART_STATS=1.
+        static std::vector<RestartSite> getRestartStats(bool callingThreadOnly = false);
+
+        static void resetRestartStats();
+
+        // one line per site of getRestartStats
+        static void printRestartStats(FILE *out, bool callingThreadOnly = false);
+
+        static const char *restartOperationName(RestartOperation operation);
+
+        static const char *restartCauseName(RestartCause cause);
+
         void remove(const Key &k, TID tid, ThreadInfo &epocheInfo);
 
         // Dim STO: remove function to provide transactinal information for STO
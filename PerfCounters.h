@@ -0,0 +1,182 @@
+//
+// Hardware performance counters of a thread with perf_event_open, for the benchmark drivers.
+//
+
+#ifndef ART_PERFCOUNTERS_H
+#define ART_PERFCOUNTERS_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ART {
+
+    enum class PerfEvent : uint8_t {
+        Cycles,
+        Instructions,
+        // last level cache
+        CacheMisses,
+        // data TLB misses of loads
+        TlbMisses,
+        BranchMisses
+    };
+
+    static constexpr unsigned perfEventCount = 5;
+
+    // counts of the events, or -1 for events that could not be counted
+    struct PerfValues {
+        double counts[perfEventCount];
+
+        PerfValues() {
+            for (double &c : counts) {
+                c = 0;
+            }
+        }
+
+        double operator[](PerfEvent e) const {
+            return counts[static_cast<unsigned>(e)];
+        }
+
+        void add(const PerfValues &other) {
+            for (unsigned e = 0; e < perfEventCount; ++e) {
+                counts[e] = counts[e] < 0 || other.counts[e] < 0 ? -1 : counts[e] + other.counts[e];
+            }
+        }
+
+        static const char *name(unsigned e) {
+            static const char *names[perfEventCount] = {"cycles", "instructions", "cache misses", "TLB misses",
+                                                        "branch misses"};
+            return names[e];
+        }
+    };
+
+    /**
+     * A group of counters of the calling thread in user space, created in the thread it counts. When the kernel or
+     * the CPU don't provide an event, e.g. in VMs without a virtual PMU or with perf_event_paranoid > 2, that event
+     * counts -1, when none is available start() and stop() do nothing and error() says why. Counts are scaled up
+     * when the kernel multiplexes the group with other ones.
+     */
+    class PerfCounters {
+    public:
+        PerfCounters() {
+            for (unsigned e = 0; e < perfEventCount; ++e) {
+                fds[e] = -1;
+            }
+#if defined(__linux__) && defined(SYS_perf_event_open)
+            const uint64_t tlbMisses = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            const struct {
+                uint32_t type;
+                uint64_t config;
+            } events[perfEventCount] = {{PERF_TYPE_HARDWARE,   PERF_COUNT_HW_CPU_CYCLES},
+                                        {PERF_TYPE_HARDWARE,   PERF_COUNT_HW_INSTRUCTIONS},
+                                        {PERF_TYPE_HARDWARE,   PERF_COUNT_HW_CACHE_MISSES},
+                                        {PERF_TYPE_HW_CACHE,   tlbMisses},
+                                        {PERF_TYPE_HARDWARE,   PERF_COUNT_HW_BRANCH_MISSES}};
+            for (unsigned e = 0; e < perfEventCount; ++e) {
+                struct perf_event_attr attr;
+                memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = events[e].type;
+                attr.config = events[e].config;
+                attr.disabled = leader < 0;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                                   PERF_FORMAT_TOTAL_TIME_RUNNING;
+                int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+                if (fd < 0) {
+                    if (errorMessage.empty()) {
+                        errorMessage = std::string(PerfValues::name(e)) + ": " + strerror(errno);
+                    }
+                    continue;
+                }
+                fds[e] = fd;
+                ioctl(fd, PERF_EVENT_IOC_ID, &ids[e]);
+                if (leader < 0) {
+                    leader = fd;
+                }
+            }
+#else
+            errorMessage = "perf_event_open is only available on Linux";
+#endif
+        }
+
+        ~PerfCounters() {
+#if defined(__linux__)
+            for (int fd : fds) {
+                if (fd >= 0) {
+                    close(fd);
+                }
+            }
+#endif
+        }
+
+        PerfCounters(const PerfCounters &) = delete;
+
+        PerfCounters &operator=(const PerfCounters &) = delete;
+
+        // at least one event can be counted
+        bool available() const {
+            return leader >= 0;
+        }
+
+        // why the first event that could not be opened failed, empty if all are counted
+        const std::string &error() const {
+            return errorMessage;
+        }
+
+        void start() {
+#if defined(__linux__)
+            if (leader >= 0) {
+                ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            }
+#endif
+        }
+
+        // the counts since start()
+        PerfValues stop() {
+            PerfValues values;
+            for (unsigned e = 0; e < perfEventCount; ++e) {
+                values.counts[e] = -1;
+            }
+#if defined(__linux__)
+            if (leader < 0) {
+                return values;
+            }
+            ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            // nr, time enabled, time running and {value, id} of each event
+            uint64_t buffer[3 + 2 * perfEventCount];
+            if (read(leader, buffer, sizeof(buffer)) < 0) {
+                return values;
+            }
+            double scale = buffer[2] == 0 ? 0 : static_cast<double>(buffer[1]) / buffer[2];
+            for (uint64_t i = 0; i < buffer[0]; ++i) {
+                for (unsigned e = 0; e < perfEventCount; ++e) {
+                    if (fds[e] >= 0 && ids[e] == buffer[4 + 2 * i]) {
+                        values.counts[e] = buffer[3 + 2 * i] * scale;
+                    }
+                }
+            }
+#endif
+            return values;
+        }
+
+    private:
+        int fds[perfEventCount];
+        uint64_t ids[perfEventCount] = {};
+        int leader = -1;
+        std::string errorMessage;
+    };
+}
+
+#endif //ART_PERFCOUNTERS_H
@@ -11,6 +11,8 @@
 #include <string.h>
 #include "../Key.h"
 #include "../Epoche.h"
+#include "../NodeAllocator.h"
+#include "../NodeScan.h"
 
 using TID = uint64_t;
 
@@ -30,6 +32,8 @@ namespace ART_ROWEX {
         N256 = 3
     };
 
+    static constexpr unsigned nodeTypeCount = 4;
+
     static constexpr uint32_t maxStoredPrefixLength = 4;
     struct Prefix {
         uint32_t prefixCount = 0;
@@ -68,6 +72,14 @@ namespace ART_ROWEX {
 
     public:
 
+        static void *operator new(std::size_t size) {
+            return NodeAllocator::allocate(size);
+        }
+
+        static void operator delete(void *p) {
+            NodeAllocator::deallocate(p);
+        }
+
         NTypes getType() const;
 
         uint32_t getLevel() const;
@@ -141,6 +153,10 @@ namespace ART_ROWEX {
 
         static void getChildren(const N *node, uint8_t start, uint8_t end, std::tuple<uint8_t, N *> children[],
                                 uint32_t &childrenCount);
+
+        // like getChildren, but in descending keyslice order
+        static void getChildrenReverse(const N *node, uint8_t start, uint8_t end, std::tuple<uint8_t, N *> children[],
+                                       uint32_t &childrenCount);
     };
 
 
@@ -181,6 +197,9 @@ namespace ART_ROWEX {
 
         void getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
+
+        void getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                uint32_t &childrenCount) const;
     };
 
     class N16 : public N {
@@ -238,6 +257,9 @@ namespace ART_ROWEX {
 
         void getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
+
+        void getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                uint32_t &childrenCount) const;
     };
 
     class N48 : public N {
@@ -274,6 +296,9 @@ namespace ART_ROWEX {
 
         void getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
+
+        void getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                uint32_t &childrenCount) const;
     };
 
     class N256 : public N {
@@ -306,6 +331,9 @@ namespace ART_ROWEX {
 
         void getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                          uint32_t &childrenCount) const;
+
+        void getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                uint32_t &childrenCount) const;
     };
 }
 #endif //ART_ROWEX_N_H
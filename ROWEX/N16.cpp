@@ -115,4 +115,22 @@ namespace ART_ROWEX {
             return std::get<0>(first) < std::get<0>(second);
         });
     }
+
+    void N16::getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                 uint32_t &childrenCount) const {
+        childrenCount = 0;
+        for (int i = 0; i < compactCount; ++i) {
+            uint8_t key = flipSign(this->keys[i]);
+            if (key >= start && key <= end) {
+                N *child = this->children[i].load();
+                if (child != nullptr) {
+                    children[childrenCount] = std::make_tuple(key, child);
+                    childrenCount++;
+                }
+            }
+        }
+        std::sort(children, children + childrenCount, [](auto &first, auto &second) {
+            return std::get<0>(first) > std::get<0>(second);
+        });
+    }
 }
\ No newline at end of file
@@ -4,13 +4,15 @@
 
 namespace ART_ROWEX {
 
+    // NodeScan reads children as plain bytes and pointers
+    static_assert(sizeof(std::atomic<uint8_t>) == 1 && sizeof(std::atomic<N *>) == sizeof(N *), "");
+
     void N256::deleteChildren() {
-        for (uint64_t i = 0; i < 256; ++i) {
-            if (children[i] != nullptr) {
-                N::deleteChildren(children[i]);
-                N::deleteNode(children[i]);
-            }
-        }
+        NodeScan::forEachChild(children, 0, 255, [&](unsigned i) {
+            N::deleteChildren(children[i]);
+            N::deleteNode(children[i]);
+            return true;
+        });
     }
 
     bool N256::insert(uint8_t key, N *val) {
@@ -64,12 +66,28 @@ namespace ART_ROWEX {
     void N256::getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                            uint32_t &childrenCount) const {
         childrenCount = 0;
-        for (unsigned i = start; i <= end; i++) {
+        NodeScan::forEachChild(this->children, start, end, [&](unsigned i) {
+            // the bitmap is only a hint, the slot could have been cleared since
             N *child = this->children[i].load();
             if (child != nullptr) {
                 children[childrenCount] = std::make_tuple(i, child);
                 childrenCount++;
             }
-        }
+            return true;
+        });
+    }
+
+    void N256::getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                  uint32_t &childrenCount) const {
+        childrenCount = 0;
+        NodeScan::forEachChildReverse(this->children, start, end, [&](unsigned i) {
+            // the bitmap is only a hint, the slot could have been cleared since
+            N *child = this->children[i].load();
+            if (child != nullptr) {
+                children[childrenCount] = std::make_tuple(i, child);
+                childrenCount++;
+            }
+            return true;
+        });
     }
 }
\ No newline at end of file
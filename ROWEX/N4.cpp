@@ -112,4 +112,22 @@ namespace ART_ROWEX {
             return std::get<0>(first) < std::get<0>(second);
         });
     }
+
+    void N4::getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                uint32_t &childrenCount) const {
+        childrenCount = 0;
+        for (uint32_t i = 0; i < 4; ++i) {
+            uint8_t key = this->keys[i].load();
+            if (key >= start && key <= end) {
+                N *child = this->children[i].load();
+                if (child != nullptr) {
+                    children[childrenCount] = std::make_tuple(key, child);
+                    childrenCount++;
+                }
+            }
+        }
+        std::sort(children, children + childrenCount, [](auto &first, auto &second) {
+            return std::get<0>(first) > std::get<0>(second);
+        });
+    }
 }
\ No newline at end of file
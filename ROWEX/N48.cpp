@@ -4,6 +4,9 @@
 
 namespace ART_ROWEX {
 
+    // NodeScan reads childIndex and children as plain bytes and pointers
+    static_assert(sizeof(std::atomic<uint8_t>) == 1 && sizeof(std::atomic<N *>) == sizeof(N *), "");
+
     bool N48::insert(uint8_t key, N *n) {
         if (compactCount == 48) {
             return false;
@@ -67,18 +70,17 @@ namespace ART_ROWEX {
     }
 
     void N48::deleteChildren() {
-        for (unsigned i = 0; i < 256; i++) {
-            if (childIndex[i] != emptyMarker) {
-                N::deleteChildren(children[childIndex[i]]);
-                N::deleteNode(children[childIndex[i]]);
-            }
-        }
+        NodeScan::forEachIndex(childIndex, emptyMarker, 0, 255, [&](unsigned i) {
+            N::deleteChildren(children[childIndex[i]]);
+            N::deleteNode(children[childIndex[i]]);
+            return true;
+        });
     }
 
     void N48::getChildren(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
                           uint32_t &childrenCount) const {
         childrenCount = 0;
-        for (unsigned i = start; i <= end; i++) {
+        NodeScan::forEachIndex(childIndex, emptyMarker, start, end, [&](unsigned i) {
             uint8_t index = this->childIndex[i].load();
             if (index != emptyMarker) {
                 N *child = this->children[index].load();
@@ -87,6 +89,23 @@ namespace ART_ROWEX {
                     childrenCount++;
                 }
             }
-        }
+            return true;
+        });
+    }
+
+    void N48::getChildrenReverse(uint8_t start, uint8_t end, std::tuple<uint8_t, N *> *&children,
+                                 uint32_t &childrenCount) const {
+        childrenCount = 0;
+        NodeScan::forEachIndexReverse(childIndex, emptyMarker, start, end, [&](unsigned i) {
+            uint8_t index = this->childIndex[i].load();
+            if (index != emptyMarker) {
+                N *child = this->children[index].load();
+                if (child != nullptr) {
+                    children[childrenCount] = std::make_tuple(i, child);
+                    childrenCount++;
+                }
+            }
+            return true;
+        });
     }
 }
\ No newline at end of file
@@ -1,15 +1,68 @@
 #include <assert.h>
 #include <algorithm>
+#include <atomic>
+#include <thread>
 #include "Tree.h"
+#include "../BulkLoad.h"
 #include "N.cpp"
 #include "../Epoche.cpp"
 
 namespace ART_ROWEX {
 
-    Tree::Tree(LoadKeyFunction loadKey) : root(new N256(0, {})), loadKey(loadKey) {
+    Tree::Tree(LoadKeyFunction loadKey, ReclaimMode reclaimMode, ReclaimScheme reclaimScheme)
+            : root(new N256(0, {})), loadKey(loadKey), epoche(256, reclaimMode, reclaimScheme) {
+    }
+
+    static N *newBulkLoadNode(unsigned childrenCount, uint32_t level, const uint8_t *prefix, uint32_t prefixLength) {
+        if (childrenCount <= 4) {
+            return new N4(level, prefix, prefixLength);
+        } else if (childrenCount <= 16) {
+            return new N16(level, prefix, prefixLength);
+        } else if (childrenCount <= 48) {
+            return new N48(level, prefix, prefixLength);
+        }
+        return new N256(level, prefix, prefixLength);
+    }
+
+    static void insertBulkLoaded(N *node, uint8_t key, N *child) {
+        switch (node->getType()) {
+            case NTypes::N4:
+                static_cast<N4 *>(node)->insert(key, child);
+                return;
+            case NTypes::N16:
+                static_cast<N16 *>(node)->insert(key, child);
+                return;
+            case NTypes::N48:
+                static_cast<N48 *>(node)->insert(key, child);
+                return;
+            case NTypes::N256:
+                static_cast<N256 *>(node)->insert(key, child);
+                return;
+        }
+    }
+
+    Tree::Tree(LoadKeyFunction loadKey, const Key keys[], const TID tids[], std::size_t n, unsigned threads,
+               ReclaimMode reclaimMode, ReclaimScheme reclaimScheme)
+            : Tree(loadKey, reclaimMode, reclaimScheme) {
+        ART::bulkLoad(root, keys, n, threads, [&](std::size_t i) { return N::setLeaf(tids[i]); },
+                      [](unsigned childrenCount, uint32_t level, const uint8_t *prefix, uint32_t prefixLength) {
+                          return newBulkLoadNode(childrenCount, level, prefix, prefixLength);
+                      },
+                      insertBulkLoaded);
+        bulkLoadedElements = static_cast<int64_t>(n);
+    }
+
+    Tree::Tree(Tree &&t) : root(t.root), loadKey(t.loadKey),
+                           epoche(256, t.epoche.getReclaimMode(), t.epoche.getReclaimScheme()),
+                           bulkLoadedElements(t.bulkLoadedElements + t.epoche.getElementCount()) {
+        epoche.setRetiredBudget(t.epoche.getRetiredBudget());
+        t.root = nullptr;
     }
 
     Tree::~Tree() {
+        if (root == nullptr) {
+            return;
+        }
         N::deleteChildren(root);
         N::deleteNode(root);
     }
@@ -18,6 +71,88 @@ namespace ART_ROWEX {
         return ThreadInfo(this->epoche);
     }
 
+    EpocheStats Tree::getEpocheStats() const {
+        return epoche.getStats();
+    }
+
+    void Tree::quiescent(ThreadInfo &threadInfo) {
+        epoche.quiescent(threadInfo);
+    }
+
+    EpocheSession Tree::pin(ThreadInfo &threadInfo, uint32_t repinInterval) const {
+        return EpocheSession(threadInfo, repinInterval);
+    }
+
+    void Tree::setRetiredBudget(std::size_t bytes) {
+        epoche.setRetiredBudget(bytes);
+    }
+
+    uint64_t Tree::size() const {
+        int64_t elements = bulkLoadedElements + epoche.getElementCount();
+        return elements > 0 ? static_cast<uint64_t>(elements) : 0;
+    }
+
+    static std::size_t nodeSize(NTypes type) {
+        switch (type) {
+            case NTypes::N4:
+                return sizeof(N4);
+            case NTypes::N16:
+                return sizeof(N16);
+            case NTypes::N48:
+                return sizeof(N48);
+            case NTypes::N256:
+                return sizeof(N256);
+        }
+        return 0;
+    }
+
+    static void countAt(std::vector<uint64_t> &histogram, std::size_t i) {
+        if (histogram.size() <= i) {
+            histogram.resize(i + 1, 0);
+        }
+        histogram[i]++;
+    }
+
+    TreeStats Tree::stats(ThreadInfo &threadEpocheInfo) const {
+        EpocheGuardReadonly epocheGuard(threadEpocheInfo);
+        TreeStats s;
+        // inner nodes and their depth
+        std::vector<std::pair<N *, uint32_t>> stack{{root, 1}};
+        std::tuple<uint8_t, N *> children[256];
+        while (!stack.empty()) {
+            N *node = stack.back().first;
+            uint32_t depth = stack.back().second;
+            stack.pop_back();
+            // readers don't lock, the children are read one by one like in a lookup
+            uint32_t childrenCount = 0;
+            N::getChildren(node, 0, 255, children, childrenCount);
+            uint32_t prefixLength = node->getPrefi().prefixCount;
+            if (N::isObsolete(node->getVersion())) {
+                // replaced in the meantime, its successor isn't counted
+                continue;
+            }
+
+            unsigned t = static_cast<unsigned>(node->getType());
+            s.nodes[t]++;
+            s.children[t] += childrenCount;
+            countAt(s.prefixLengths, prefixLength);
+            if (prefixLength > maxStoredPrefixLength) {
+                s.prefixesBeyondStored++;
+            }
+            s.bytes += nodeSize(node->getType());
+            for (uint32_t i = 0; i < childrenCount; ++i) {
+                N *child = std::get<1>(children[i]);
+                if (N::isLeaf(child)) {
+                    s.leaves++;
+                    countAt(s.leafDepths, depth);
+                } else {
+                    stack.emplace_back(child, depth + 1);
+                }
+            }
+        }
+        return s;
+    }
+
     TID Tree::lookup(const Key &k, ThreadInfo &threadEpocheInfo) const {
         EpocheGuardReadonly epocheGuard(threadEpocheInfo);
         N *node = root;
@@ -54,180 +189,146 @@ namespace ART_ROWEX {
         }
     }
 
-    bool Tree::lookupRange(const Key &start, const Key &end, Key &continueKey, TID result[],
-                                std::size_t resultSize, std::size_t &resultsFound, ThreadInfo &threadEpocheInfo) const {
-        for (uint32_t i = 0; i < std::min(start.getKeyLen(), end.getKeyLen()); ++i) {
-            if (start[i] > end[i]) {
-                resultsFound = 0;
-                return false;
-            } else if (start[i] < end[i]) {
-                break;
-            }
+    static void copyKey(Key &to, const Key &from) {
+        if (from.getKeyLen() == 0) {
+            to.setKeyLen(0);
+        } else {
+            to.set(reinterpret_cast<const char *>(&from[0]), from.getKeyLen());
         }
-        EpocheGuard epocheGuard(threadEpocheInfo);
-        TID toContinue = 0;
-        bool restart;
-        std::function<void(const N *)> copy = [&result, &resultSize, &resultsFound, &toContinue, &copy](const N *node) {
-            if (N::isLeaf(node)) {
-                if (resultsFound == resultSize) {
-                    toContinue = N::getLeaf(node);
+    }
+
+    static int compareKeys(const Key &a, const Key &b) {
+        uint32_t len = std::min(a.getKeyLen(), b.getKeyLen());
+        int c = len > 0 ? memcmp(&a[0], &b[0], len) : 0;
+        if (c != 0) {
+            return c;
+        }
+        return (a.getKeyLen() > b.getKeyLen()) - (a.getKeyLen() < b.getKeyLen());
+    }
+
+    void Tree::copyRange(const N *node, uint32_t level, bool onStartPath, bool onEndPath, RangeScan &scan) const {
+        if (N::isLeaf(node)) {
+            if (onStartPath || onEndPath) {
+                Key kt;
+                loadKey(N::getLeaf(node), kt);
+                if ((onStartPath && compareKeys(kt, scan.start) < 0) || (onEndPath && compareKeys(kt, scan.end) >= 0)) {
                     return;
                 }
-                result[resultsFound] = N::getLeaf(node);
-                resultsFound++;
-            } else {
-                std::tuple<uint8_t, N *> children[256];
-                uint32_t childrenCount = 0;
-                N::getChildren(node, 0u, 255u, children, childrenCount);
-                for (uint32_t i = 0; i < childrenCount; ++i) {
-                    const N *n = std::get<1>(children[i]);
-                    copy(n);
-                    if (toContinue != 0) {
-                        break;
-                    }
-                }
             }
-        };
-        std::function<void(const N *, uint32_t)> findStart = [&copy, &start, &findStart, &toContinue, &restart, this](
-                const N *node, uint32_t level) {
-            if (N::isLeaf(node)) {
-                copy(node);
+            if (scan.resultsFound == scan.resultSize) {
+                scan.toContinue = N::getLeaf(node);
                 return;
             }
-
-            PCCompareResults prefixResult;
-            prefixResult = checkPrefixCompare(node, start, level, loadKey);
-            switch (prefixResult) {
+            scan.result[scan.resultsFound] = N::getLeaf(node);
+            scan.resultsFound++;
+            return;
+        }
+        if (onStartPath) {
+            uint32_t prefixLevel = level;
+            switch (checkPrefixCompare(node, scan.start, prefixLevel, loadKey)) {
+                case PCCompareResults::Smaller:
+                    return;
                 case PCCompareResults::Bigger:
-                    copy(node);
+                    onStartPath = false;
                     break;
-                case PCCompareResults::Equal: {
-                    uint8_t startLevel = (start.getKeyLen() > level) ? start[level] : 0;
-                    std::tuple<uint8_t, N *> children[256];
-                    uint32_t childrenCount = 0;
-                    N::getChildren(node, startLevel, 255, children, childrenCount);
-                    for (uint32_t i = 0; i < childrenCount; ++i) {
-                        const uint8_t k = std::get<0>(children[i]);
-                        const N *n = std::get<1>(children[i]);
-                        if (k == startLevel) {
-                            findStart(n, level + 1);
-                        } else if (k > startLevel) {
-                            copy(n);
-                        }
-                        if (toContinue != 0 || restart) {
-                            break;
-                        }
-                    }
+                case PCCompareResults::Equal:
                     break;
-                }
                 case PCCompareResults::SkippedLevel:
-                    restart = true;
-                    break;
-                case PCCompareResults::Smaller:
-                    break;
-            }
-        };
-        std::function<void(const N *, uint32_t)> findEnd = [&copy, &end, &toContinue, &restart, &findEnd, this](
-                const N *node, uint32_t level) {
-            if (N::isLeaf(node)) {
-                return;
+                    scan.restart = true;
+                    return;
             }
-            PCCompareResults prefixResult;
-            prefixResult = checkPrefixCompare(node, end, level, loadKey);
-
-            switch (prefixResult) {
+        }
+        if (onEndPath) {
+            uint32_t prefixLevel = level;
+            switch (checkPrefixCompare(node, scan.end, prefixLevel, loadKey)) {
+                case PCCompareResults::Bigger:
+                    return;
                 case PCCompareResults::Smaller:
-                    copy(node);
+                    onEndPath = false;
                     break;
-                case PCCompareResults::Equal: {
-                    uint8_t endLevel = (end.getKeyLen() > level) ? end[level] : 255;
-                    std::tuple<uint8_t, N *> children[256];
-                    uint32_t childrenCount = 0;
-                    N::getChildren(node, 0, endLevel, children, childrenCount);
-                    for (uint32_t i = 0; i < childrenCount; ++i) {
-                        const uint8_t k = std::get<0>(children[i]);
-                        const N *n = std::get<1>(children[i]);
-                        if (k == endLevel) {
-                            findEnd(n, level + 1);
-                        } else if (k < endLevel) {
-                            copy(n);
-                        }
-                        if (toContinue != 0 || restart) {
-                            break;
-                        }
-                    }
-                    break;
-                }
-                case PCCompareResults::Bigger:
+                case PCCompareResults::Equal:
                     break;
                 case PCCompareResults::SkippedLevel:
-                    restart = true;
-                    break;
+                    scan.restart = true;
+                    return;
+            }
+        }
+        level = node->getLevel();
+        if (onStartPath && scan.start.getKeyLen() <= level) {
+            onStartPath = false;
+        }
+        if (onEndPath && scan.end.getKeyLen() <= level) {
+            return;
+        }
+        uint8_t startLevel = onStartPath ? scan.start[level] : 0;
+        uint8_t endLevel = onEndPath ? scan.end[level] : 255;
+        std::tuple<uint8_t, N *> children[256];
+        uint32_t childrenCount = 0;
+        if (scan.reverse) {
+            N::getChildrenReverse(node, startLevel, endLevel, children, childrenCount);
+        } else {
+            N::getChildren(node, startLevel, endLevel, children, childrenCount);
+        }
+        for (uint32_t i = 0; i < childrenCount; ++i) {
+            const uint8_t k = std::get<0>(children[i]);
+            const N *n = std::get<1>(children[i]);
+            copyRange(n, level + 1, onStartPath && k == startLevel, onEndPath && k == endLevel, scan);
+            if (scan.toContinue != 0 || scan.restart) {
+                break;
             }
-        };
+        }
+    }
 
-        restart:
-        restart = false;
+    bool Tree::lookupRangeReverse(const Key &start, const Key &end, Key &continueKey, TID result[],
+                                  std::size_t resultSize, std::size_t &resultsFound, ThreadInfo &threadEpocheInfo) const {
         resultsFound = 0;
-
-        uint32_t level = 0;
-        N *node = nullptr;
-        N *nextNode = root;
-
-        while (true) {
-            node = nextNode;
-            PCEqualsResults prefixResult;
-            prefixResult = checkPrefixEquals(node, level, start, end, loadKey);
-            switch (prefixResult) {
-                case PCEqualsResults::SkippedLevel:
-                    goto restart;
-                case PCEqualsResults::NoMatch: {
-                    return false;
-                }
-                case PCEqualsResults::Contained: {
-                    copy(node);
-                    break;
-                }
-                case PCEqualsResults::BothMatch: {
-                    uint8_t startLevel = (start.getKeyLen() > level) ? start[level] : 0;
-                    uint8_t endLevel = (end.getKeyLen() > level) ? end[level] : 255;
-                    if (startLevel != endLevel) {
-                        std::tuple<uint8_t, N *> children[256];
-                        uint32_t childrenCount = 0;
-                        N::getChildren(node, startLevel, endLevel, children, childrenCount);
-                        for (uint32_t i = 0; i < childrenCount; ++i) {
-                            const uint8_t k = std::get<0>(children[i]);
-                            const N *n = std::get<1>(children[i]);
-                            if (k == startLevel) {
-                                findStart(n, level + 1);
-                            } else if (k > startLevel && k < endLevel) {
-                                copy(n);
-                            } else if (k == endLevel) {
-                                findEnd(n, level + 1);
-                            }
-                            if (restart) {
-                                goto restart;
-                            }
-                            if (toContinue) {
-                                break;
-                            }
-                        }
-                    } else {
-                        nextNode = N::getChild(startLevel, node);
-                        level++;
-                        continue;
-                    }
-                    break;
-                }
-            }
-            break;
+        // an empty end is no bound
+        bool hasEnd = end.getKeyLen() > 0;
+        if (hasEnd && compareKeys(start, end) >= 0) {
+            return false;
         }
-        if (toContinue != 0) {
-            loadKey(toContinue, continueKey);
-            return true;
+        EpocheGuard epocheGuard(threadEpocheInfo);
+        RangeScan scan{start, end, result, resultSize, 0, 0, true, false};
+        do {
+            scan.restart = false;
+            scan.toContinue = 0;
+            scan.resultsFound = 0;
+            copyRange(root, 0, true, hasEnd, scan);
+        } while (scan.restart);
+        resultsFound = scan.resultsFound;
+        if (scan.toContinue == 0) {
+            return false;
+        }
+        if (resultsFound == 0) {
+            copyKey(continueKey, end);
         } else {
+            loadKey(result[resultsFound - 1], continueKey);
+        }
+        return true;
+    }
+
+    bool Tree::lookupRange(const Key &start, const Key &end, Key &continueKey, TID result[],
+                           std::size_t resultSize, std::size_t &resultsFound, ThreadInfo &threadEpocheInfo) const {
+        resultsFound = 0;
+        // an empty end is no bound
+        bool hasEnd = end.getKeyLen() > 0;
+        if (hasEnd && compareKeys(start, end) >= 0) {
+            return false;
+        }
+        EpocheGuard epocheGuard(threadEpocheInfo);
+        RangeScan scan{start, end, result, resultSize, 0, 0, false, false};
+        do {
+            scan.restart = false;
+            scan.toContinue = 0;
+            scan.resultsFound = 0;
+            copyRange(root, 0, true, hasEnd, scan);
+        } while (scan.restart);
+        resultsFound = scan.resultsFound;
+        if (scan.toContinue == 0) {
             return false;
         }
+        loadKey(scan.toContinue, continueKey);
+        return true;
     }
 
 
@@ -294,6 +395,7 @@ namespace ART_ROWEX {
                                     node->getPrefi().prefixCount - ((nextLevel - level) + 1));
 
                     node->writeUnlock();
+                    epocheInfo.addElements(1);
                     return;
                 }
                 case CheckPrefixPessimisticResult::Match:
@@ -310,6 +412,7 @@ namespace ART_ROWEX {
 
                 N::insertAndUnlock(node, parentNode, parentKey, nodeKey, N::setLeaf(tid), epocheInfo, needRestart);
                 if (needRestart) goto restart;
+                epocheInfo.addElements(1);
                 return;
             }
             if (N::isLeaf(nextNode)) {
@@ -331,6 +434,7 @@ namespace ART_ROWEX {
                 n4->insert(key[level + prefixLength], nextNode);
                 N::change(node, k[level - 1], n4);
                 node->writeUnlock();
+                epocheInfo.addElements(1);
                 return;
             }
             level++;
@@ -427,6 +531,7 @@ namespace ART_ROWEX {
                             N::removeAndUnlock(node, k[level], parentNode, parentKey, threadInfo, needRestart);
                             if (needRestart) goto restart;
                         }
+                        threadInfo.addElements(-1);
                         return;
                     }
                     level++;
@@ -526,30 +631,4 @@ namespace ART_ROWEX {
         return PCCompareResults::Equal;
     }
 
-    typename Tree::PCEqualsResults Tree::checkPrefixEquals(const N *n, uint32_t &level, const Key &start, const Key &end,
-                                                      LoadKeyFunction loadKey) {
-        Prefix p = n->getPrefi();
-        if (p.prefixCount + level < n->getLevel()) {
-            return PCEqualsResults::SkippedLevel;
-        }
-        if (p.prefixCount > 0) {
-            Key kt;
-            for (uint32_t i = ((level + p.prefixCount) - n->getLevel()); i < p.prefixCount; ++i) {
-                if (i == maxStoredPrefixLength) {
-                    loadKey(N::getAnyChildTid(n), kt);
-                }
-                uint8_t startLevel = (start.getKeyLen() > level) ? start[level] : 0;
-                uint8_t endLevel = (end.getKeyLen() > level) ? end[level] : 0;
-
-                uint8_t curKey = i >= maxStoredPrefixLength ? kt[level] : p.prefix[i];
-                if (curKey > startLevel && curKey < endLevel) {
-                    return PCEqualsResults::Contained;
-                } else if (curKey < startLevel || curKey > endLevel) {
-                    return PCEqualsResults::NoMatch;
-                }
-                ++level;
-            }
-        }
-        return PCEqualsResults::BothMatch;
-    }
 }
\ No newline at end of file
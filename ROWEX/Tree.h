@@ -4,18 +4,43 @@
 
 #ifndef ART_ROWEX_TREE_H
 #define ART_ROWEX_TREE_H
+#include <vector>
 #include "N.h"
 
 using namespace ART;
 
 namespace ART_ROWEX {
 
+    /**
+     * Shape of a tree, see Tree::stats. The depth of a leaf is the number of inner nodes above it, the root's
+     * leaves have depth 1. bytes are the sizes of the inner nodes, without the size class rounding of NodeAllocator.
+     */
+    struct TreeStats {
+        uint64_t nodes[nodeTypeCount] = {};
+        // of all nodes of a type
+        uint64_t children[nodeTypeCount] = {};
+        uint64_t leaves = 0;
+        // leafDepths[d] leaves have depth d
+        std::vector<uint64_t> leafDepths;
+        // prefixLengths[l] inner nodes have a prefix of l bytes
+        std::vector<uint64_t> prefixLengths;
+        // inner nodes with more than maxStoredPrefixLength prefix bytes, the rest is checked against a leaf
+        uint64_t prefixesBeyondStored = 0;
+        std::size_t bytes = 0;
+
+        double averageFanout(NTypes type) const {
+            unsigned t = static_cast<unsigned>(type);
+            return nodes[t] == 0 ? 0 : static_cast<double>(children[t]) / nodes[t];
+        }
+    };
+
     class Tree {
     public:
         using LoadKeyFunction = void (*)(TID tid, Key &key);
 
     private:
-        N *const root;
+        // nullptr once the tree is moved from
+        N *root;
 
         TID checkKey(const TID tid, const Key &k) const;
 
@@ -23,6 +48,9 @@ namespace ART_ROWEX {
 
         Epoche epoche{256};
 
+        // keys of the bulk load, size() adds them to the counters of the threads, which count the removes of them
+        int64_t bulkLoadedElements = 0;
+
     public:
         enum class CheckPrefixResult : uint8_t {
             Match,
@@ -42,12 +70,6 @@ namespace ART_ROWEX {
             Bigger,
             SkippedLevel
         };
-        enum class PCEqualsResults : uint8_t {
-            BothMatch,
-            Contained,
-            NoMatch,
-            SkippedLevel
-        };
         static CheckPrefixResult checkPrefix(N* n, const Key &k, uint32_t &level);
 
         static CheckPrefixPessimisticResult checkPrefixPessimistic(N *n, const Key &k, uint32_t &level,
@@ -57,25 +79,88 @@ namespace ART_ROWEX {
 
         static PCCompareResults checkPrefixCompare(const N* n, const Key &k, uint32_t &level, LoadKeyFunction loadKey);
 
-        static PCEqualsResults checkPrefixEquals(const N* n, uint32_t &level, const Key &start, const Key &end, LoadKeyFunction loadKey);
+        // state of lookupRange and lookupRangeReverse
+        struct RangeScan {
+            const Key &start;
+            const Key &end;
+            TID *result;
+            std::size_t resultSize;
+            std::size_t resultsFound;
+            // first TID that did not fit into result
+            TID toContinue;
+            bool reverse;
+            // a node was changed under the scan, it starts over
+            bool restart;
+        };
+
+        // copies the TIDs of node in [start, end) in key order, descending if reverse, onStartPath/onEndPath tell
+        // whether the keys of the node share start's/end's bytes up to level
+        void copyRange(const N *node, uint32_t level, bool onStartPath, bool onEndPath, RangeScan &scan) const;
 
     public:
 
-        Tree(LoadKeyFunction loadKey);
+        // with ReclaimMode::Background a thread of the tree frees the removed nodes, with
+        // ReclaimScheme::QuiescentState lookups don't store their epoche but the threads have to call quiescent(),
+        // see Epoche.h
+        Tree(LoadKeyFunction loadKey, ReclaimMode reclaimMode = ReclaimMode::Inline,
+             ReclaimScheme reclaimScheme = ReclaimScheme::EpochBased);
+
+        // Builds the tree from the n keys in ascending order without duplicates, tids[i] being the TID of keys[i].
+        // Nodes are created at their final size, the subtrees below the top levels are built by the given
+        // number of threads. Throws std::invalid_argument if the keys are not ascending or have duplicates, see
+        // BulkLoad.h.
+        Tree(LoadKeyFunction loadKey, const Key keys[], const TID tids[], std::size_t n, unsigned threads = 1,
+             ReclaimMode reclaimMode = ReclaimMode::Inline, ReclaimScheme reclaimScheme = ReclaimScheme::EpochBased);
 
         Tree(const Tree &) = delete;
 
-        Tree(Tree &&t) : root(t.root), loadKey(t.loadKey) { }
+        // takes over the nodes, the element count and the settings of t, which is left without a root and may only
+        // be destroyed
+        Tree(Tree &&t);
 
         ~Tree();
 
         ThreadInfo getThreadInfo();
 
+        // retired nodes that are not freed yet, per thread, and the thread that holds back their reclamation
+        EpocheStats getEpocheStats() const;
+
+        // with ReclaimScheme::QuiescentState, called by every thread regularly between its operations
+        void quiescent(ThreadInfo &threadInfo);
+
+        // Pins the thread until the session is destroyed, e.g. auto s = tree.pin(threadInfo), so that the
+        // operations in between don't store its epoche. The session moves on to the current epoche every
+        // repinInterval operations, so that removed nodes still get freed.
+        EpocheSession pin(ThreadInfo &threadInfo, uint32_t repinInterval = 1024) const;
+
+        // bytes of removed nodes that may wait to be freed before writers get throttled, 0 for no limit, see
+        // Epoche::setRetiredBudget
+        void setRetiredBudget(std::size_t bytes);
+
+        // Number of keys, from a counter per thread that insert and remove maintain after they have changed the
+        // tree. The counters are summed in O(threads), the operations that run meanwhile may be missing from it.
+        // The keys of the bulk-load constructor are counted by the tree.
+        uint64_t size() const;
+
+        // Walks the whole tree without blocking writers, nodes that they replace during the walk are skipped, so the
+        // result is no snapshot. The thread stays in its epoche for the walk, which holds back the reclamation of
+        // all threads.
+        TreeStats stats(ThreadInfo &threadEpocheInfo) const;
+
         TID lookup(const Key &k, ThreadInfo &threadEpocheInfo) const;
 
+        // Finds the TIDs of the keys in [start, end) in ascending key order, of all keys >= start if end is empty.
+        // Returns true if there are more than resultLen of them, continueKey is then set to the first key that did
+        // not fit, which is the start for the next call.
         bool lookupRange(const Key &start, const Key &end, Key &continueKey, TID result[], std::size_t resultLen,
                          std::size_t &resultCount, ThreadInfo &threadEpocheInfo) const;
 
+        // Finds the TIDs of the keys in [start, end) in descending key order, of all keys >= start if end is empty.
+        // Returns true if there are more than resultLen of them, continueKey is then set to the last key in result,
+        // which is the end for the next call.
+        bool lookupRangeReverse(const Key &start, const Key &end, Key &continueKey, TID result[], std::size_t resultLen,
+                                std::size_t &resultCount, ThreadInfo &threadEpocheInfo) const;
+
         void insert(const Key &k, TID tid, ThreadInfo &epocheInfo);
 
         void remove(const Key &k, TID tid, ThreadInfo &epocheInfo);
@@ -0,0 +1,717 @@
+//
+// Workload driver for all three trees: YCSB-style operation mixes, key and request distributions, threads,
+// warmup and duration are chosen on the command line, the results are printed as CSV or JSON. With --latency each
+// thread records the latency of every operation into a histogram (Latency.h), their percentiles are printed after the
+// throughput. With --perf each thread counts cycles, instructions, cache, TLB and branch misses of the load and of the
+// measured run with perf_event_open (PerfCounters.h), per operation. With --restarts and a build with
+// ART_OLC_RESTART_STATS=1, the restarts of ART_OLC::Tree in the measured run are printed by call site.
+//
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <getopt.h>
+
+#include "OptimisticLockCoupling/Tree.h"
+#include "ROWEX/Tree.h"
+#include "ART/Tree.h"
+#include "KeyGenerator.h"
+#include "Latency.h"
+#include "PerfCounters.h"
+#include "Epoche.cpp"
+
+enum Operation {
+    Read,
+    Insert,
+    Update,
+    Scan,
+    Delete,
+    ReadModifyWrite,
+    operationCount
+};
+
+const char *operationNames[operationCount] = {"read", "insert", "update", "scan", "delete", "rmw"};
+
+struct Options {
+    std::string tree = "olc";
+    std::string workload = "c";
+    // see ART::KeyType
+    std::string keys = "dense";
+    // of binary keys
+    uint32_t keyLength = 256;
+    // request distribution: uniform, zipfian or latest
+    std::string distribution;
+    double theta = 0.99;
+    uint64_t records = 1000000;
+    unsigned threads = 1;
+    // fractions of the operations, normalized to their sum
+    double ratios[operationCount] = {0, 0, 0, 0, 0, 0};
+    bool ratiosSet = false;
+    uint32_t scanLength = 100;
+    double warmup = 1;
+    double duration = 5;
+    std::string format = "csv";
+    bool header = true;
+    uint64_t seed = 1;
+    bool latency = false;
+    bool perf = false;
+    bool restarts = false;
+};
+
+// YCSB core workloads, with zipfian requests unless they read the latest records
+void applyWorkload(Options &options) {
+    double *r = options.ratios;
+    std::string distribution = "zipfian";
+    if (options.workload == "a") {
+        r[Read] = 0.5;
+        r[Update] = 0.5;
+    } else if (options.workload == "b") {
+        r[Read] = 0.95;
+        r[Update] = 0.05;
+    } else if (options.workload == "c") {
+        r[Read] = 1;
+    } else if (options.workload == "d") {
+        r[Read] = 0.95;
+        r[Insert] = 0.05;
+        distribution = "latest";
+    } else if (options.workload == "e") {
+        r[Scan] = 0.95;
+        r[Insert] = 0.05;
+    } else if (options.workload == "f") {
+        r[Read] = 0.5;
+        r[ReadModifyWrite] = 0.5;
+    } else {
+        throw std::invalid_argument("unknown workload " + options.workload);
+    }
+    if (options.distribution.empty()) {
+        options.distribution = distribution;
+    }
+}
+
+using ART::mix;
+using ART::Random;
+using ART::Zipfian;
+
+// keys of the records, record i has TID i + 1
+ART::KeyGenerator *keyGenerator = nullptr;
+
+void loadKey(TID tid, Key &key) {
+    keyGenerator->load(tid, key);
+}
+
+// records that exist, the loaded ones and those inserted since
+std::atomic<uint64_t> recordCount{0};
+
+// record to request: uniform over all, zipfian over the loaded ones with the hot ones spread over the key space
+// like YCSB's scrambled zipfian, or zipfian over the most recently inserted ones
+uint64_t nextRecord(const Options &options, const Zipfian &zipfian, Random &random) {
+    uint64_t count = recordCount.load(std::memory_order_relaxed);
+    if (options.distribution == "uniform") {
+        return random.next() % count;
+    }
+    uint64_t rank = zipfian.next(random);
+    if (options.distribution == "latest") {
+        return count - 1 - std::min(rank, count - 1);
+    }
+    return mix(rank) % std::min(count, options.records);
+}
+
+// adapters that give the trees the same interface, Context is what a thread needs to use the tree
+struct OlcTree {
+    using Context = ART::ThreadInfo;
+    ART_OLC::Tree tree{loadKey};
+
+    Context context() {
+        return tree.getThreadInfo();
+    }
+
+    TID lookup(const Key &k, Context &c) {
+        return tree.lookup(k, c);
+    }
+
+    void insert(const Key &k, TID tid, Context &c) {
+        tree.insert(k, tid, c);
+    }
+
+    void update(const Key &k, TID tid, Context &c) {
+        tree.upsert(k, tid, c);
+    }
+
+    void remove(const Key &k, TID tid, Context &c) {
+        tree.remove(k, tid, c);
+    }
+
+    std::size_t scan(const Key &start, const Key &end, TID *results, std::size_t n, Context &c) {
+        Key continueKey;
+        std::size_t found = 0;
+        tree.lookupRange(start, end, continueKey, results, n, found, c);
+        return found;
+    }
+};
+
+// ROWEX and the unsynchronized tree must not insert keys that exist, and they can't change the TID of one. An update
+// removes the key and inserts it again, the writes of a key are serialized by a striped lock, so that no key gets
+// inserted twice.
+struct RowexTree {
+    using Context = ART::ThreadInfo;
+    ART_ROWEX::Tree tree{loadKey};
+    std::mutex locks[1024];
+
+    std::mutex &lockOf(TID tid) {
+        return locks[mix(tid) % 1024];
+    }
+
+    Context context() {
+        return tree.getThreadInfo();
+    }
+
+    TID lookup(const Key &k, Context &c) {
+        return tree.lookup(k, c);
+    }
+
+    void insert(const Key &k, TID tid, Context &c) {
+        std::lock_guard<std::mutex> lock(lockOf(tid));
+        if (tree.lookup(k, c) == 0) {
+            tree.insert(k, tid, c);
+        }
+    }
+
+    void update(const Key &k, TID tid, Context &c) {
+        std::lock_guard<std::mutex> lock(lockOf(tid));
+        if (tree.lookup(k, c) != 0) {
+            tree.remove(k, tid, c);
+            tree.insert(k, tid, c);
+        }
+    }
+
+    void remove(const Key &k, TID tid, Context &c) {
+        std::lock_guard<std::mutex> lock(lockOf(tid));
+        tree.remove(k, tid, c);
+    }
+
+    std::size_t scan(const Key &start, const Key &end, TID *results, std::size_t n, Context &c) {
+        Key continueKey;
+        std::size_t found = 0;
+        tree.lookupRange(start, end, continueKey, results, n, found, c);
+        return found;
+    }
+};
+
+// single-threaded
+struct UnsynchronizedTree {
+    struct Context { };
+    ART_unsynchronized::Tree tree{loadKey};
+
+    Context context() {
+        return Context();
+    }
+
+    TID lookup(const Key &k, Context &) {
+        return tree.lookup(k);
+    }
+
+    void insert(const Key &k, TID tid, Context &) {
+        if (tree.lookup(k) == 0) {
+            tree.insert(k, tid);
+        }
+    }
+
+    void update(const Key &k, TID tid, Context &) {
+        if (tree.lookup(k) != 0) {
+            tree.remove(k, tid);
+            tree.insert(k, tid);
+        }
+    }
+
+    void remove(const Key &k, TID tid, Context &) {
+        tree.remove(k, tid);
+    }
+
+    std::size_t scan(const Key &start, const Key &end, TID *results, std::size_t n, Context &) {
+        Key continueKey;
+        std::size_t found = 0;
+        tree.lookupRange(start, end, continueKey, results, n, found);
+        return found;
+    }
+};
+
+struct ThreadResult {
+    uint64_t operations[operationCount];
+    // reads and read-modify-writes of records that were not found, e.g. deleted ones
+    uint64_t misses;
+    uint64_t scannedKeys;
+};
+
+// one row of the latency table, thread -1 are all threads
+void printLatencies(const Options &options, int op, int thread, const ART::LatencyHistogram &h, bool first) {
+    auto ns = [](double ticks) { return ART::Clock::toNs(ticks); };
+    char threadName[16];
+    snprintf(threadName, sizeof(threadName), thread < 0 ? "all" : "%d", thread);
+    if (options.format == "json") {
+        printf("%s{\"operation\":\"%s\",\"thread\":\"%s\",\"count\":%lu,\"mean_ns\":%.1f,\"p50_ns\":%.0f,"
+               "\"p99_ns\":%.0f,\"p999_ns\":%.0f,\"max_ns\":%.0f}", first ? "" : ",", operationNames[op], threadName,
+               h.getCount(), ns(h.getMean()), ns(h.percentile(0.5)), ns(h.percentile(0.99)), ns(h.percentile(0.999)),
+               ns(h.getMax()));
+    } else {
+        printf("%s,%s,%lu,%.1f,%.0f,%.0f,%.0f,%.0f\n", operationNames[op], threadName, h.getCount(), ns(h.getMean()),
+               ns(h.percentile(0.5)), ns(h.percentile(0.99)), ns(h.percentile(0.999)), ns(h.getMax()));
+    }
+}
+
+// one row of the counter table, thread -1 are all threads, counts that are not available are empty or null
+void printCounters(const Options &options, const char *phase, int thread, uint64_t operations,
+                   const ART::PerfValues &values, bool first) {
+    char threadName[16];
+    snprintf(threadName, sizeof(threadName), thread < 0 ? "all" : "%d", thread);
+    if (options.format == "json") {
+        static const char *keys[ART::perfEventCount] = {"cycles", "instructions", "cache_misses", "tlb_misses",
+                                                        "branch_misses"};
+        printf("%s{\"phase\":\"%s\",\"thread\":\"%s\",\"operations\":%lu", first ? "" : ",", phase, threadName,
+               operations);
+        for (unsigned e = 0; e < ART::perfEventCount; ++e) {
+            if (values.counts[e] < 0 || operations == 0) {
+                printf(",\"%s_per_op\":null", keys[e]);
+            } else {
+                printf(",\"%s_per_op\":%.3f", keys[e], values.counts[e] / operations);
+            }
+        }
+        printf("}");
+    } else {
+        printf("%s,%s,%lu", phase, threadName, operations);
+        for (unsigned e = 0; e < ART::perfEventCount; ++e) {
+            if (values.counts[e] < 0 || operations == 0) {
+                printf(",");
+            } else {
+                printf(",%.3f", values.counts[e] / operations);
+            }
+        }
+        printf("\n");
+    }
+}
+
+template<typename TREE>
+void runWorkload(const Options &options) {
+    TREE tree;
+
+    // per thread, of the load and of the measured run
+    std::vector<ART::PerfValues> loadCounters(options.threads), runCounters(options.threads);
+    std::vector<uint64_t> loadOperations(options.threads, 0);
+    std::string perfError;
+    auto loadStart = std::chrono::steady_clock::now();
+    {
+        std::vector<std::thread> loaders;
+        for (unsigned t = 0; t < options.threads; ++t) {
+            loaders.emplace_back([&, t]() {
+                auto c = tree.context();
+                std::unique_ptr<ART::PerfCounters> counters(options.perf ? new ART::PerfCounters() : nullptr);
+                if (counters) {
+                    if (t == 0) {
+                        perfError = counters->error();
+                    }
+                    counters->start();
+                }
+                for (uint64_t i = t; i < options.records; i += options.threads) {
+                    Key key;
+                    keyGenerator->key(i, key);
+                    tree.insert(key, i + 1, c);
+                    loadOperations[t]++;
+                }
+                if (counters) {
+                    loadCounters[t] = counters->stop();
+                }
+            });
+        }
+        for (auto &l : loaders) {
+            l.join();
+        }
+    }
+    double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+    recordCount.store(options.records);
+
+    // thresholds of a uniform number in [0, 1) for each operation
+    double cumulative[operationCount];
+    double sum = 0;
+    for (int op = 0; op < operationCount; ++op) {
+        sum += options.ratios[op];
+    }
+    double acc = 0;
+    for (int op = 0; op < operationCount; ++op) {
+        acc += options.ratios[op] / sum;
+        cumulative[op] = acc;
+    }
+
+    Zipfian zipfian(options.records, options.theta);
+    // 0: warmup, 1: measured, 2: stop
+    std::atomic<int> phase{0};
+    std::vector<ThreadResult> results(options.threads);
+    // per thread and operation, in ticks of ART::Clock
+    std::vector<std::vector<ART::LatencyHistogram>> latencies(options.threads);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < options.threads; ++t) {
+        workers.emplace_back([&, t]() {
+            auto c = tree.context();
+            Random random(options.seed * 1000003 + t);
+            std::vector<TID> scanResults(options.scanLength);
+            Key maxKey;
+            maxKey.setKeyLen(sizeof(uint64_t));
+            memset(&maxKey[0], 0xff, sizeof(uint64_t));
+            ThreadResult result{};
+            std::vector<ART::LatencyHistogram> histograms(options.latency ? operationCount : 0);
+            std::unique_ptr<ART::PerfCounters> counters(options.perf ? new ART::PerfCounters() : nullptr);
+            bool measuring = false;
+            int currentPhase;
+            while ((currentPhase = phase.load(std::memory_order_relaxed)) != 2) {
+                if (currentPhase == 1 && !measuring) {
+                    measuring = true;
+                    result = ThreadResult{};
+                    for (auto &h : histograms) {
+                        h.reset();
+                    }
+                    if (counters) {
+                        counters->start();
+                    }
+                }
+                double u = random.nextDouble();
+                int op = 0;
+                while (op < operationCount - 1 && u >= cumulative[op]) {
+                    op++;
+                }
+                Key key;
+                uint64_t startTicks = options.latency ? ART::Clock::now() : 0;
+                if (op == Insert) {
+                    uint64_t i = recordCount.fetch_add(1, std::memory_order_relaxed);
+                    keyGenerator->key(i, key);
+                    tree.insert(key, i + 1, c);
+                } else {
+                    TID k = nextRecord(options, zipfian, random) + 1;
+                    keyGenerator->load(k, key);
+                    switch (op) {
+                        case Read:
+                            result.misses += tree.lookup(key, c) != k;
+                            break;
+                        case Update:
+                            tree.update(key, k, c);
+                            break;
+                        case Scan:
+                            result.scannedKeys += tree.scan(key, maxKey, scanResults.data(),
+                                                            1 + random.next() % options.scanLength, c);
+                            break;
+                        case Delete:
+                            tree.remove(key, k, c);
+                            break;
+                        case ReadModifyWrite:
+                            if (tree.lookup(key, c) == k) {
+                                tree.update(key, k, c);
+                            } else {
+                                result.misses++;
+                            }
+                            break;
+                    }
+                }
+                if (options.latency) {
+                    histograms[op].record(ART::Clock::now() - startTicks);
+                }
+                result.operations[op]++;
+            }
+            if (counters) {
+                runCounters[t] = counters->stop();
+            }
+            if (!measuring) {
+                result = ThreadResult{};
+                for (auto &h : histograms) {
+                    h.reset();
+                }
+            }
+            results[t] = result;
+            latencies[t] = std::move(histograms);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.warmup));
+    if (options.restarts) {
+        ART_OLC::Tree::resetRestartStats();
+    }
+    phase.store(1);
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.duration));
+    phase.store(2);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    ThreadResult total{};
+    uint64_t operations = 0;
+    for (auto &r : results) {
+        for (int op = 0; op < operationCount; ++op) {
+            total.operations[op] += r.operations[op];
+            operations += r.operations[op];
+        }
+        total.misses += r.misses;
+        total.scannedKeys += r.scannedKeys;
+    }
+
+    if (options.format == "json") {
+        printf("{\"tree\":\"%s\",\"workload\":\"%s\",\"keys\":\"%s\",\"distribution\":\"%s\",\"theta\":%g,"
+               "\"records\":%lu,\"threads\":%u,\"load_s\":%f,\"seconds\":%f,\"operations\":%lu,\"mops\":%f,",
+               options.tree.c_str(), options.workload.c_str(), options.keys.c_str(), options.distribution.c_str(),
+               options.theta, options.records, options.threads, loadSeconds, seconds, operations,
+               operations / seconds / 1e6);
+        for (int op = 0; op < operationCount; ++op) {
+            printf("\"%s\":%lu,", operationNames[op], total.operations[op]);
+        }
+        printf("\"misses\":%lu,\"scanned_keys\":%lu", total.misses, total.scannedKeys);
+    } else {
+        if (options.header) {
+            printf("tree,workload,keys,distribution,theta,records,threads,load s,seconds,operations,Mops/s");
+            for (int op = 0; op < operationCount; ++op) {
+                printf(",%s", operationNames[op]);
+            }
+            printf(",misses,scanned keys\n");
+        }
+        printf("%s,%s,%s,%s,%g,%lu,%u,%f,%f,%lu,%f", options.tree.c_str(), options.workload.c_str(),
+               options.keys.c_str(), options.distribution.c_str(), options.theta, options.records, options.threads,
+               loadSeconds, seconds, operations, operations / seconds / 1e6);
+        for (int op = 0; op < operationCount; ++op) {
+            printf(",%lu", total.operations[op]);
+        }
+        printf(",%lu,%lu\n", total.misses, total.scannedKeys);
+    }
+
+    if (options.latency) {
+        if (options.format == "json") {
+            printf(",\"latency\":[");
+        } else if (options.header) {
+            printf("\noperation,thread,count,mean ns,p50 ns,p99 ns,p99.9 ns,max ns\n");
+        }
+        bool first = true;
+        for (int op = 0; op < operationCount; ++op) {
+            if (total.operations[op] == 0) {
+                continue;
+            }
+            ART::LatencyHistogram merged;
+            for (auto &threadLatencies : latencies) {
+                merged.merge(threadLatencies[op]);
+            }
+            printLatencies(options, op, -1, merged, first);
+            first = false;
+            if (options.threads > 1) {
+                for (unsigned t = 0; t < options.threads; ++t) {
+                    printLatencies(options, op, t, latencies[t][op], false);
+                }
+            }
+        }
+        if (options.format == "json") {
+            printf("]");
+        }
+    }
+
+    if (options.perf) {
+        if (!perfError.empty()) {
+            fprintf(stderr, "performance counters: %s\n", perfError.c_str());
+        }
+        if (options.format == "json") {
+            printf(",\"counters\":[");
+        } else if (options.header) {
+            printf("\nphase,thread,operations");
+            for (unsigned e = 0; e < ART::perfEventCount; ++e) {
+                printf(",%s/op", ART::PerfValues::name(e));
+            }
+            printf("\n");
+        }
+        std::vector<uint64_t> runOperations(options.threads, 0);
+        for (unsigned t = 0; t < options.threads; ++t) {
+            runOperations[t] = std::accumulate(results[t].operations, results[t].operations + operationCount,
+                                               uint64_t(0));
+        }
+        const char *phases[] = {"load", "run"};
+        for (int p = 0; p < 2; ++p) {
+            auto &counters = p == 0 ? loadCounters : runCounters;
+            auto &ops = p == 0 ? loadOperations : runOperations;
+            ART::PerfValues all;
+            for (auto &c : counters) {
+                all.add(c);
+            }
+            printCounters(options, phases[p], -1, std::accumulate(ops.begin(), ops.end(), uint64_t(0)), all, p == 0);
+            if (options.threads > 1) {
+                for (unsigned t = 0; t < options.threads; ++t) {
+                    printCounters(options, phases[p], t, ops[t], counters[t], false);
+                }
+            }
+        }
+        if (options.format == "json") {
+            printf("]");
+        }
+    }
+    if (options.restarts) {
+        if (options.tree != "olc" || !ART_OLC_RESTART_STATS) {
+            fprintf(stderr, "restarts are only counted by ART_OLC::Tree built with -DART_OLC_RESTART_STATS=1\n");
+        }
+        std::vector<ART_OLC::RestartSite> sites = ART_OLC::Tree::getRestartStats();
+        if (options.format == "json") {
+            printf(",\"restarts\":[");
+            for (std::size_t i = 0; i < sites.size(); ++i) {
+                static const char *typeNames[] = {"N4", "N16", "N48", "N256", "N32"};
+                printf("%s{\"operation\":\"%s\",\"cause\":\"%s\",\"line\":%u,\"level\":%u,\"node_type\":\"%s\","
+                       "\"count\":%lu}", i == 0 ? "" : ",", ART_OLC::Tree::restartOperationName(sites[i].operation),
+                       ART_OLC::Tree::restartCauseName(sites[i].cause), sites[i].line, sites[i].level,
+                       typeNames[static_cast<unsigned>(sites[i].nodeType)], sites[i].count);
+            }
+            printf("]");
+        } else {
+            printf("\n");
+            ART_OLC::Tree::printRestartStats(stdout);
+        }
+    }
+    if (options.format == "json") {
+        printf("}\n");
+    }
+}
+
+void usage(const char *program) {
+    printf("usage: %s [options]\n"
+           "  --tree olc|rowex|art       tree variant, art is unsynchronized and single-threaded (olc)\n"
+           "  --workload a|b|c|d|e|f     YCSB core workload (c)\n"
+           "  --read, --insert, --update, --scan, --delete, --rmw r\n"
+           "                             operation ratios instead of the workload's, e.g. --read 0.9 --insert 0.1\n"
+           "  --distribution uniform|zipfian|latest\n"
+           "                             records requested, default of the workload\n"
+           "  --theta t                  skew of zipfian and latest (0.99)\n"
+           "  --keys dense|sparse|timestamp|email|url|binary\n"
+           "                             8 byte integers 1..n or 63 bit hashes of them, 8 byte timestamps with\n"
+           "                             jitter, email addresses, URLs or random bytes of 6 to --key-length (dense)\n"
+           "  --key-length n             maximum length of binary keys (256)\n"
+           "  --records n                records loaded before the run (1000000)\n"
+           "  --threads n                threads that load and run the workload (1)\n"
+           "  --scan-length n            scans read 1..n keys (100)\n"
+           "  --warmup s, --duration s   seconds before and of the measurement (1, 5)\n"
+           "  --format csv|json          output (csv)\n"
+           "  --no-header                no csv header line, e.g. for sweeps\n"
+           "  --seed n                   seed of the request generators (1)\n"
+           "  --latency                  p50, p99, p99.9 and max latency per operation type, of all and each thread\n"
+           "  --perf                     hardware counters per operation of the load and the run, of all and each\n"
+           "                             thread, empty if the system doesn't provide them\n"
+           "  --restarts                 restarts of olc by call site, operation, key level and node type, needs a\n"
+           "                             build with -DART_OLC_RESTART_STATS=1\n",
+           program);
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    static const struct option longOptions[] = {
+            {"tree",         required_argument, nullptr, 't'},
+            {"workload",     required_argument, nullptr, 'w'},
+            {"read",         required_argument, nullptr, 'R'},
+            {"insert",       required_argument, nullptr, 'I'},
+            {"update",       required_argument, nullptr, 'U'},
+            {"scan",         required_argument, nullptr, 'S'},
+            {"delete",       required_argument, nullptr, 'D'},
+            {"rmw",          required_argument, nullptr, 'M'},
+            {"distribution", required_argument, nullptr, 'd'},
+            {"theta",        required_argument, nullptr, 'z'},
+            {"keys",         required_argument, nullptr, 'k'},
+            {"key-length",   required_argument, nullptr, 'K'},
+            {"records",      required_argument, nullptr, 'n'},
+            {"threads",      required_argument, nullptr, 'p'},
+            {"scan-length",  required_argument, nullptr, 'l'},
+            {"warmup",       required_argument, nullptr, 'u'},
+            {"duration",     required_argument, nullptr, 's'},
+            {"format",       required_argument, nullptr, 'f'},
+            {"no-header",    no_argument,       nullptr, 'H'},
+            {"seed",         required_argument, nullptr, 'e'},
+            {"latency",      no_argument,       nullptr, 'L'},
+            {"perf",         no_argument,       nullptr, 'P'},
+            {"restarts",     no_argument,       nullptr, 'r'},
+            {"help",         no_argument,       nullptr, 'h'},
+            {nullptr, 0,                        nullptr, 0}
+    };
+    double ratios[operationCount] = {0, 0, 0, 0, 0, 0};
+    int c;
+    while ((c = getopt_long(argc, argv, "", longOptions, nullptr)) != -1) {
+        switch (c) {
+            case 't': options.tree = optarg; break;
+            case 'w': options.workload = optarg; break;
+            case 'R': ratios[Read] = atof(optarg); options.ratiosSet = true; break;
+            case 'I': ratios[Insert] = atof(optarg); options.ratiosSet = true; break;
+            case 'U': ratios[Update] = atof(optarg); options.ratiosSet = true; break;
+            case 'S': ratios[Scan] = atof(optarg); options.ratiosSet = true; break;
+            case 'D': ratios[Delete] = atof(optarg); options.ratiosSet = true; break;
+            case 'M': ratios[ReadModifyWrite] = atof(optarg); options.ratiosSet = true; break;
+            case 'd': options.distribution = optarg; break;
+            case 'z': options.theta = atof(optarg); break;
+            case 'k': options.keys = optarg; break;
+            case 'K': options.keyLength = static_cast<uint32_t>(atoi(optarg)); break;
+            case 'n': options.records = std::strtoull(optarg, nullptr, 10); break;
+            case 'p': options.threads = static_cast<unsigned>(atoi(optarg)); break;
+            case 'l': options.scanLength = static_cast<uint32_t>(atoi(optarg)); break;
+            case 'u': options.warmup = atof(optarg); break;
+            case 's': options.duration = atof(optarg); break;
+            case 'f': options.format = optarg; break;
+            case 'H': options.header = false; break;
+            case 'e': options.seed = std::strtoull(optarg, nullptr, 10); break;
+            case 'L': options.latency = true; break;
+            case 'P': options.perf = true; break;
+            case 'r': options.restarts = true; break;
+            default:
+                usage(argv[0]);
+                return c == 'h' ? 0 : 1;
+        }
+    }
+
+    try {
+        if (options.ratiosSet) {
+            std::copy(ratios, ratios + operationCount, options.ratios);
+            options.workload = "custom";
+            if (options.distribution.empty()) {
+                options.distribution = "zipfian";
+            }
+        } else {
+            applyWorkload(options);
+        }
+        if (options.distribution != "uniform" && options.distribution != "zipfian" &&
+            options.distribution != "latest") {
+            throw std::invalid_argument("unknown distribution " + options.distribution);
+        }
+        ART::KeyGenerator keys(ART::KeyGenerator::parse(options.keys), options.keyLength);
+        keyGenerator = &keys;
+        if (options.format != "csv" && options.format != "json") {
+            throw std::invalid_argument("unknown format " + options.format);
+        }
+        if (options.theta <= 0 || options.theta >= 1) {
+            throw std::invalid_argument("theta has to be between 0 and 1");
+        }
+        if (options.records < 2 || options.threads == 0 || options.scanLength == 0 ||
+            std::accumulate(options.ratios, options.ratios + operationCount, 0.0) <= 0) {
+            throw std::invalid_argument("records, threads, scan length and the ratios have to be positive");
+        }
+        if (options.latency) {
+            ART::Clock::calibrate();
+        }
+        if (options.tree == "olc") {
+            runWorkload<OlcTree>(options);
+        } else if (options.tree == "rowex") {
+            runWorkload<RowexTree>(options);
+        } else if (options.tree == "art") {
+            if (options.threads != 1) {
+                throw std::invalid_argument("the unsynchronized tree runs with a single thread");
+            }
+            runWorkload<UnsynchronizedTree>(options);
+        } else {
+            throw std::invalid_argument("unknown tree " + options.tree);
+        }
+    } catch (const std::invalid_argument &e) {
+        printf("%s\n", e.what());
+        usage(argv[0]);
+        return 1;
+    }
+    return 0;
+}
@@ -1,5 +1,13 @@
 #include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <immintrin.h>
 #include "tbb/tbb.h"
 
 using namespace std;
@@ -7,6 +15,9 @@ using namespace std;
 #include "OptimisticLockCoupling/Tree.h"
 #include "ROWEX/Tree.h"
 #include "ART/Tree.h"
+#include "Epoche.cpp"
+#include "KeyGenerator.h"
+#include "PerfCounters.h"
 
 void loadKey(TID tid, Key &key) {
     // Store the key of the tuple into the key vector
@@ -15,23 +26,79 @@ void loadKey(TID tid, Key &key) {
     reinterpret_cast<uint64_t *>(&key[0])[0] = __builtin_bswap64(tid);
 }
 
-void singlethreaded(char **argv) {
-    std::cout << "single threaded:" << std::endl;
+// the TIDs of the update benchmark carry a version above the key in their lower 32 bits
+void loadVersionedKey(TID tid, Key &key) {
+    loadKey(tid & 0xffffffff, key);
+}
 
-    uint64_t n = std::atoll(argv[1]);
-    uint64_t *keys = new uint64_t[n];
+// the TIDs of string keys are their position in stringKeys + 1
+std::vector<std::string> stringKeys;
+
+void loadStringKey(TID tid, Key &key) {
+    // with the terminating 0, no key is a prefix of another one
+    const std::string &s = stringKeys[tid - 1];
+    key.set(s.c_str(), s.size() + 1);
+}
+
+// keys of the nodes benchmark from KeyGenerator.h, the TIDs are the record + 1
+ART::KeyGenerator *generatedKeys = nullptr;
 
-    // Generate keys
+void loadGeneratedKey(TID tid, Key &key) {
+    generatedKeys->load(tid, key);
+}
+
+// composite keys of the prefix benchmark: a 4 byte tenant, compositePadding constant bytes and an 8 byte id,
+// the TID is the id + 1
+uint32_t compositePadding = 0;
+thread_local uint64_t loadKeyCalls = 0;
+
+void loadCompositeKey(TID tid, Key &key) {
+    loadKeyCalls++;
+    uint64_t id = tid - 1;
+    key.setKeyLen(4 + compositePadding + 8);
+    // the id is not aligned for most paddings
+    uint32_t tenant = __builtin_bswap32(id % 4);
+    uint64_t bigEndianId = __builtin_bswap64(id);
+    memcpy(&key[0], &tenant, sizeof(tenant));
+    memset(&key[4], 'p', compositePadding);
+    memcpy(&key[4 + compositePadding], &bigEndianId, sizeof(bigEndianId));
+}
+
+// tuples of the leaves benchmark, one per cache line, the TIDs are their positions
+struct Tuple {
+    uint64_t key;
+    uint8_t payload[56];
+};
+Tuple *tuples = nullptr;
+
+// a loadKey that misses the cache on every call, like a database that dereferences cold tuples
+void loadColdKey(TID tid, Key &key) {
+    loadKeyCalls++;
+    _mm_clflush(&tuples[tid]);
+    _mm_mfence();
+    loadKey(tuples[tid].key, key);
+}
+
+void generateKeys(uint64_t *keys, uint64_t n, int type) {
     for (uint64_t i = 0; i < n; i++)
         // dense, sorted
         keys[i] = i + 1;
-    if (atoi(argv[2]) == 1)
+    if (type == 1)
         // dense, random
         std::random_shuffle(keys, keys + n);
-    if (atoi(argv[2]) == 2)
+    if (type == 2)
         // "pseudo-sparse" (the most-significant leaf bit gets lost)
         for (uint64_t i = 0; i < n; i++)
             keys[i] = (static_cast<uint64_t>(rand()) << 32) | static_cast<uint64_t>(rand());
+}
+
+void singlethreaded(char **argv) {
+    std::cout << "single threaded:" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *keys = new uint64_t[n];
+
+    generateKeys(keys, n, atoi(argv[2]));
 
     printf("operation,n,ops/s\n");
     ART_unsynchronized::Tree tree(loadKey);
@@ -89,17 +156,7 @@ void multithreaded(char **argv) {
     uint64_t n = std::atoll(argv[1]);
     uint64_t *keys = new uint64_t[n];
 
-    // Generate keys
-    for (uint64_t i = 0; i < n; i++)
-        // dense, sorted
-        keys[i] = i + 1;
-    if (atoi(argv[2]) == 1)
-        // dense, random
-        std::random_shuffle(keys, keys + n);
-    if (atoi(argv[2]) == 2)
-        // "pseudo-sparse" (the most-significant leaf bit gets lost)
-        for (uint64_t i = 0; i < n; i++)
-            keys[i] = (static_cast<uint64_t>(rand()) << 32) | static_cast<uint64_t>(rand());
+    generateKeys(keys, n, atoi(argv[2]));
 
     printf("operation,n,ops/s\n");
     ART_OLC::Tree tree(loadKey);
@@ -159,12 +216,1361 @@ void multithreaded(char **argv) {
     delete[] keys;
 }
 
+void batched(char **argv) {
+    std::cout << "batched lookup:" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *keys = new uint64_t[n];
+    generateKeys(keys, n, atoi(argv[2]));
+
+    ART_OLC::Tree tree(loadKey);
+    auto t = tree.getThreadInfo();
+    for (uint64_t i = 0; i != n; i++) {
+        Key key;
+        loadKey(keys[i], key);
+        tree.insert(key, keys[i], t);
+    }
+    // look the keys up in a different order than they were inserted
+    std::random_shuffle(keys, keys + n);
+
+    printf("operation,batch,n,ops/us\n");
+    {
+        auto starttime = std::chrono::system_clock::now();
+        for (uint64_t i = 0; i != n; i++) {
+            Key key;
+            loadKey(keys[i], key);
+            auto val = tree.lookup(key, t);
+            if (val != keys[i]) {
+                std::cout << "wrong key read: " << val << " expected:" << keys[i] << std::endl;
+                throw;
+            }
+        }
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now() - starttime);
+        printf("lookup,1,%ld,%f\n", n, (n * 1.0) / duration.count());
+    }
+
+    const uint64_t maxBatch = 256;
+    Key *batchKeys = new Key[maxBatch];
+    TID results[maxBatch];
+    for (uint64_t batch = 32; batch <= maxBatch; batch *= 2) {
+        auto starttime = std::chrono::system_clock::now();
+        for (uint64_t i = 0; i < n; i += batch) {
+            uint64_t count = std::min(batch, n - i);
+            for (uint64_t j = 0; j != count; j++) {
+                loadKey(keys[i + j], batchKeys[j]);
+            }
+            tree.lookupBatch(batchKeys, count, results, t);
+            for (uint64_t j = 0; j != count; j++) {
+                if (results[j] != keys[i + j]) {
+                    std::cout << "wrong key read: " << results[j] << " expected:" << keys[i + j] << std::endl;
+                    throw;
+                }
+            }
+        }
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now() - starttime);
+        printf("lookupBatch,%ld,%ld,%f\n", batch, n, (n * 1.0) / duration.count());
+    }
+    delete[] batchKeys;
+    delete[] keys;
+}
+
+void scan(char **argv) {
+    std::cout << "range scan:" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *keys = new uint64_t[n];
+    generateKeys(keys, n, atoi(argv[2]));
+
+    ART_OLC::Tree tree(loadKey);
+    auto t = tree.getThreadInfo();
+    for (uint64_t i = 0; i != n; i++) {
+        Key key;
+        loadKey(keys[i], key);
+        tree.insert(key, keys[i], t);
+    }
+    std::random_shuffle(keys, keys + n);
+
+    Key end;
+    loadKey(~0ul, end);
+    TID *result = new TID[n];
+
+    printf("operation,length,scans,keys/us\n");
+    const uint64_t lengths[] = {10, 1000, n};
+    for (uint64_t length : lengths) {
+        uint64_t scans = std::max<uint64_t>(1, std::min<uint64_t>(n / length, 100000));
+        {
+            uint64_t found = 0;
+            auto starttime = std::chrono::system_clock::now();
+            for (uint64_t i = 0; i != scans; i++) {
+                Key start;
+                if (length == n) {
+                    start.setKeyLen(0);
+                } else {
+                    loadKey(keys[i], start);
+                }
+                ART_OLC::Tree::Cursor cursor(tree, t);
+                cursor.seek(start);
+                TID tid;
+                for (uint64_t j = 0; j != length && cursor.next(tid); j++) {
+                    found++;
+                }
+            }
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now() - starttime);
+            printf("cursor,%ld,%ld,%f\n", length, scans, (found * 1.0) / duration.count());
+        }
+        {
+            uint64_t found = 0;
+            auto starttime = std::chrono::system_clock::now();
+            for (uint64_t i = 0; i != scans; i++) {
+                Key start, continueKey;
+                if (length == n) {
+                    start.setKeyLen(0);
+                } else {
+                    loadKey(keys[i], start);
+                }
+                std::size_t resultCount;
+                tree.lookupRange(start, end, continueKey, result, length, resultCount, t);
+                found += resultCount;
+            }
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now() - starttime);
+            printf("lookupRange,%ld,%ld,%f\n", length, scans, (found * 1.0) / duration.count());
+        }
+        {
+            // the latest keys before a key
+            uint64_t found = 0;
+            auto starttime = std::chrono::system_clock::now();
+            for (uint64_t i = 0; i != scans; i++) {
+                Key start;
+                if (length == n) {
+                    loadKey(~0ul, start);
+                } else {
+                    loadKey(keys[i], start);
+                }
+                ART_OLC::Tree::Cursor cursor(tree, t, true);
+                cursor.seek(start, false);
+                TID tid;
+                for (uint64_t j = 0; j != length && cursor.next(tid); j++) {
+                    found++;
+                }
+            }
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now() - starttime);
+            printf("reverseCursor,%ld,%ld,%f\n", length, scans, (found * 1.0) / duration.count());
+        }
+        {
+            uint64_t found = 0;
+            Key first;
+            first.setKeyLen(0);
+            auto starttime = std::chrono::system_clock::now();
+            for (uint64_t i = 0; i != scans; i++) {
+                Key start, continueKey;
+                if (length == n) {
+                    loadKey(~0ul, start);
+                } else {
+                    loadKey(keys[i], start);
+                }
+                std::size_t resultCount;
+                tree.lookupRangeReverse(first, start, continueKey, result, length, resultCount, t);
+                found += resultCount;
+            }
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now() - starttime);
+            printf("lookupRangeReverse,%ld,%ld,%f\n", length, scans, (found * 1.0) / duration.count());
+        }
+    }
+    delete[] result;
+    delete[] keys;
+}
+
+void allocation(char **argv) {
+    std::cout << "node allocation (ART_NODE_ALLOCATOR=" << ART_NODE_ALLOCATOR << ", ART_NUMA=" << ART_NUMA << ", "
+              << ART::NumaTopology::get().nodeCount() << " memory nodes):" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *keys = new uint64_t[n];
+
+    generateKeys(keys, n, atoi(argv[2]));
+
+    // local and remote allocations are counted with -DART_NUMA_STATS=1
+    printf("operation,n,ops/us,allocations/s,peak rss kB,local allocations,remote allocations,remote frees\n");
+    ART_OLC::Tree tree(loadKey);
+
+    // insert, remove everything and insert again, so the second round can reuse the reclaimed nodes
+    const char *phases[] = {"insert", "remove", "reinsert"};
+    for (int phase = 0; phase < 3; ++phase) {
+        ART::NodeAllocatorStats before = ART::NodeAllocator::getStats();
+        auto starttime = std::chrono::system_clock::now();
+        tbb::parallel_for(tbb::blocked_range<uint64_t>(0, n), [&](const tbb::blocked_range<uint64_t> &range) {
+            auto t = tree.getThreadInfo();
+            for (uint64_t i = range.begin(); i != range.end(); i++) {
+                Key key;
+                loadKey(keys[i], key);
+                if (phase == 1) {
+                    tree.remove(key, keys[i], t);
+                } else {
+                    tree.insert(key, keys[i], t);
+                }
+            }
+        });
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now() - starttime);
+        ART::NodeAllocatorStats after = ART::NodeAllocator::getStats();
+        auto allocations = after.allocations - before.allocations;
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        printf("%s,%ld,%f,%f,%ld,%lu,%lu,%lu\n", phases[phase], n, (n * 1.0) / duration.count(),
+               allocations * 1000000.0 / duration.count(), usage.ru_maxrss,
+               after.localAllocations - before.localAllocations, after.remoteAllocations - before.remoteAllocations,
+               after.remoteDeallocations - before.remoteDeallocations);
+    }
+    delete[] keys;
+}
+
+void bulkLoad(char **argv) {
+    std::cout << "bulk load:" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *keys = new uint64_t[n];
+    generateKeys(keys, n, atoi(argv[2]));
+    // bulk loading needs sorted keys without duplicates
+    std::sort(keys, keys + n);
+    n = std::unique(keys, keys + n) - keys;
+
+    Key *keyArray = new Key[n];
+    TID *tids = new TID[n];
+    for (uint64_t i = 0; i != n; i++) {
+        loadKey(keys[i], keyArray[i]);
+        tids[i] = keys[i];
+    }
+    std::vector<unsigned> threadCounts{1};
+    if (std::thread::hardware_concurrency() > 1) {
+        threadCounts.push_back(std::thread::hardware_concurrency());
+    }
+
+    printf("tree,operation,threads,n,ops/us\n");
+    auto report = [&](const char *tree, const char *operation, unsigned threads,
+                      std::chrono::system_clock::time_point starttime) {
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now() - starttime);
+        printf("%s,%s,%u,%ld,%f\n", tree, operation, threads, n, (n * 1.0) / duration.count());
+    };
+    auto check = [&](TID val, uint64_t i) {
+        if (val != keys[i]) {
+            std::cout << "wrong key read: " << val << " expected:" << keys[i] << std::endl;
+            throw;
+        }
+    };
+
+    {
+        auto starttime = std::chrono::system_clock::now();
+        ART_OLC::Tree tree(loadKey);
+        tbb::parallel_for(tbb::blocked_range<uint64_t>(0, n), [&](const tbb::blocked_range<uint64_t> &range) {
+            auto t = tree.getThreadInfo();
+            for (uint64_t i = range.begin(); i != range.end(); i++) {
+                tree.insert(keyArray[i], tids[i], t);
+            }
+        });
+        report("ART_OLC", "insert", tbb::this_task_arena::max_concurrency(), starttime);
+    }
+    for (unsigned threadCount : threadCounts) {
+        auto starttime = std::chrono::system_clock::now();
+        ART_OLC::Tree tree(loadKey, keyArray, tids, n, threadCount);
+        report("ART_OLC", "bulkLoad", threadCount, starttime);
+        auto t = tree.getThreadInfo();
+        for (uint64_t i = 0; i != n; i++) {
+            check(tree.lookup(keyArray[i], t), i);
+        }
+    }
+
+    {
+        auto starttime = std::chrono::system_clock::now();
+        ART_ROWEX::Tree tree(loadKey);
+        tbb::parallel_for(tbb::blocked_range<uint64_t>(0, n), [&](const tbb::blocked_range<uint64_t> &range) {
+            auto t = tree.getThreadInfo();
+            for (uint64_t i = range.begin(); i != range.end(); i++) {
+                tree.insert(keyArray[i], tids[i], t);
+            }
+        });
+        report("ART_ROWEX", "insert", tbb::this_task_arena::max_concurrency(), starttime);
+    }
+    for (unsigned threadCount : threadCounts) {
+        auto starttime = std::chrono::system_clock::now();
+        ART_ROWEX::Tree tree(loadKey, keyArray, tids, n, threadCount);
+        report("ART_ROWEX", "bulkLoad", threadCount, starttime);
+        auto t = tree.getThreadInfo();
+        for (uint64_t i = 0; i != n; i++) {
+            check(tree.lookup(keyArray[i], t), i);
+        }
+    }
+
+    {
+        auto starttime = std::chrono::system_clock::now();
+        ART_unsynchronized::Tree tree(loadKey);
+        for (uint64_t i = 0; i != n; i++) {
+            tree.insert(keyArray[i], tids[i]);
+        }
+        report("ART_unsynchronized", "insert", 1, starttime);
+    }
+    for (unsigned threadCount : threadCounts) {
+        auto starttime = std::chrono::system_clock::now();
+        ART_unsynchronized::Tree tree(loadKey, keyArray, tids, n, threadCount);
+        report("ART_unsynchronized", "bulkLoad", threadCount, starttime);
+        for (uint64_t i = 0; i != n; i++) {
+            check(tree.lookup(keyArray[i]), i);
+        }
+    }
+    delete[] tids;
+    delete[] keyArray;
+    delete[] keys;
+}
+
+void update(char **argv) {
+    std::cout << "updates of hot keys:" << std::endl;
+
+    // the versioned TIDs leave 32 bits for the keys
+    uint64_t n = std::min<uint64_t>(std::atoll(argv[1]), 0xffffffff);
+    uint64_t *keys = new uint64_t[n];
+    generateKeys(keys, n, std::min(atoi(argv[2]), 1));
+
+    ART_OLC::Tree tree(loadVersionedKey);
+    tbb::parallel_for(tbb::blocked_range<uint64_t>(0, n), [&](const tbb::blocked_range<uint64_t> &range) {
+        auto t = tree.getThreadInfo();
+        for (uint64_t i = range.begin(); i != range.end(); i++) {
+            Key key;
+            loadKey(keys[i], key);
+            tree.insert(key, keys[i], t);
+        }
+    });
+
+    printf("operation,hot keys,n,ops/us,restarts/op\n");
+    const uint64_t hotKeys[] = {1, 16, 1024, n};
+    // lookup+insert is the racy read-modify-write without the new operations
+    const char *operations[] = {"lookup+insert", "upsert", "insertIfAbsent", "compareAndSwap"};
+    for (uint64_t hot : hotKeys) {
+        for (int operation = 0; operation < 4; ++operation) {
+            std::atomic<uint64_t> restarts{0};
+            auto starttime = std::chrono::system_clock::now();
+            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, n), [&](const tbb::blocked_range<uint64_t> &range) {
+                auto t = tree.getThreadInfo();
+                uint64_t restartsBefore = ART_OLC::Tree::getUpdateRestarts();
+                for (uint64_t i = range.begin(); i != range.end(); i++) {
+                    uint64_t k = keys[i % hot];
+                    Key key;
+                    loadKey(k, key);
+                    if (operation == 0) {
+                        TID tid = tree.lookup(key, t);
+                        tree.insert(key, (tid + (1ul << 32)) & 0x7fffffffffffffff, t);
+                    } else if (operation == 1) {
+                        tree.upsert(key, k | (i << 32 & 0x7fffffff00000000), t);
+                    } else if (operation == 2) {
+                        tree.insertIfAbsent(key, k, t);
+                    } else {
+                        // increment the version
+                        TID tid = tree.lookup(key, t);
+                        while (!tree.compareAndSwap(key, tid, (tid + (1ul << 32)) & 0x7fffffffffffffff, t)) {
+                        }
+                    }
+                }
+                restarts += ART_OLC::Tree::getUpdateRestarts() - restartsBefore;
+            });
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now() - starttime);
+            // insert doesn't count its restarts
+            printf("%s,%ld,%ld,%f,%s\n", operations[operation], hot, n, (n * 1.0) / duration.count(),
+                   operation == 0 ? "" : std::to_string((restarts * 1.0) / n).c_str());
+        }
+    }
+    delete[] keys;
+}
+
+void nodeScan(char **argv) {
+    std::cout << "range scans over sparse N48/N256 nodes:" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    TID *result = new TID[n];
+    Key start, end, continueKey;
+    start.setKeyLen(0);
+    loadKey(~0ul, end);
+
+    NodeScanIsa defaultIsa = NodeScan::getIsa();
+    printf("node,children,n,isa,tree,keys/us\n");
+    // every inner node gets the same number of children in random, sorted keyslices, i.e. N48 with up to
+    // 48 children and N256 above
+    const unsigned childrenCounts[] = {24, 40, 64, 128};
+    for (unsigned childrenCount : childrenCounts) {
+        unsigned levels = std::max(1.0, std::floor(std::log(n) / std::log(childrenCount)));
+        std::vector<uint8_t> slices(255);
+        for (unsigned i = 0; i < 255; i++) {
+            slices[i] = i + 1;
+        }
+        std::random_shuffle(slices.begin(), slices.end());
+        slices.resize(childrenCount);
+        std::sort(slices.begin(), slices.end());
+
+        std::vector<TID> tids{0};
+        for (unsigned l = 0; l < levels; l++) {
+            std::vector<TID> next;
+            for (TID prefix : tids) {
+                for (uint8_t slice : slices) {
+                    next.push_back(prefix << 8 | slice);
+                }
+            }
+            tids.swap(next);
+        }
+        uint64_t count = std::min<uint64_t>(tids.size(), n);
+        Key *keys = new Key[tids.size()];
+        for (uint64_t i = 0; i != tids.size(); i++) {
+            loadKey(tids[i], keys[i]);
+        }
+        ART_OLC::Tree olc(loadKey, keys, tids.data(), tids.size());
+        ART_ROWEX::Tree rowex(loadKey, keys, tids.data(), tids.size());
+        ART_unsynchronized::Tree unsynchronized(loadKey, keys, tids.data(), tids.size());
+        auto olcInfo = olc.getThreadInfo();
+        auto rowexInfo = rowex.getThreadInfo();
+
+        const NodeScanIsa isas[] = {NodeScanIsa::Scalar, NodeScanIsa::AVX2, NodeScanIsa::AVX512};
+        const char *isaNames[] = {"scalar", "avx2", "avx512"};
+        for (NodeScanIsa isa : isas) {
+            if (NodeScan::setIsa(isa) != isa) {
+                continue;
+            }
+            const char *trees[] = {"ART_OLC", "ART_ROWEX", "ART_unsynchronized"};
+            for (int tree = 0; tree < 3; ++tree) {
+                // scans of the first n keys
+                std::size_t resultCount = 0;
+                auto starttime = std::chrono::system_clock::now();
+                for (int repetition = 0; repetition < 10; ++repetition) {
+                    if (tree == 0) {
+                        olc.lookupRange(start, end, continueKey, result, count, resultCount, olcInfo);
+                    } else if (tree == 1) {
+                        rowex.lookupRange(start, end, continueKey, result, count, resultCount, rowexInfo);
+                    } else {
+                        unsynchronized.lookupRange(start, end, continueKey, result, count, resultCount);
+                    }
+                }
+                auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::system_clock::now() - starttime);
+                if (resultCount != count) {
+                    std::cout << "wrong scan result: " << resultCount << " expected:" << count << std::endl;
+                    throw;
+                }
+                printf("%s,%u,%ld,%s,%s,%f\n", childrenCount <= 48 ? "N48" : "N256", childrenCount, count,
+                       isaNames[static_cast<int>(isa)], trees[tree], (10 * count * 1.0) / duration.count());
+            }
+        }
+        delete[] keys;
+    }
+    NodeScan::setIsa(defaultIsa);
+    delete[] result;
+}
+
+void nodeTypes(char **argv) {
+    std::cout << "node types (ART_OLC_N32=" << ART_OLC_N32 << "):" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *values = new uint64_t[n];
+    Key *keys = new Key[n];
+
+    printf("dataset,n,N4,N16,N32,N48,N256,lookup ns/op\n");
+    const char *datasets[] = {"dense", "sparse", "string", "timestamp", "email", "url", "binary"};
+    for (int dataset = 0; dataset < 7; ++dataset) {
+        uint64_t count = n;
+        std::unique_ptr<ART::KeyGenerator> generator;
+        if (dataset < 2) {
+            generateKeys(values, n, dataset + 1);
+            for (uint64_t i = 0; i != n; i++) {
+                loadKey(values[i], keys[i]);
+            }
+        } else if (dataset == 2) {
+            // lowercase words of 6 to 12 letters, i.e. up to 26 children per node
+            stringKeys.resize(n);
+            for (uint64_t i = 0; i != n; i++) {
+                stringKeys[i].resize(6 + rand() % 7);
+                for (auto &c : stringKeys[i]) {
+                    c = 'a' + rand() % 26;
+                }
+            }
+            std::sort(stringKeys.begin(), stringKeys.end());
+            stringKeys.erase(std::unique(stringKeys.begin(), stringKeys.end()), stringKeys.end());
+            std::random_shuffle(stringKeys.begin(), stringKeys.end());
+            count = stringKeys.size();
+            for (uint64_t i = 0; i != count; i++) {
+                values[i] = i + 1;
+                loadStringKey(values[i], keys[i]);
+            }
+        } else {
+            generator.reset(new ART::KeyGenerator(ART::KeyGenerator::parse(datasets[dataset])));
+            generatedKeys = generator.get();
+            for (uint64_t i = 0; i != n; i++) {
+                values[i] = i + 1;
+                generator->key(i, keys[i]);
+            }
+        }
+
+        ART_OLC::Tree tree(dataset < 2 ? loadKey : dataset == 2 ? loadStringKey : loadGeneratedKey);
+        auto t = tree.getThreadInfo();
+        for (uint64_t i = 0; i != count; i++) {
+            tree.insert(keys[i], values[i], t);
+        }
+        uint64_t nodeCounts[ART_OLC::nodeTypeCount];
+        tree.getNodeTypeHistogram(nodeCounts, t);
+
+        auto starttime = std::chrono::system_clock::now();
+        for (uint64_t i = 0; i != count; i++) {
+            auto val = tree.lookup(keys[i], t);
+            if (val != values[i]) {
+                std::cout << "wrong key read: " << val << " expected:" << values[i] << std::endl;
+                throw;
+            }
+        }
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now() - starttime);
+        using ART_OLC::NTypes;
+        printf("%s,%ld,%ld,%ld,%ld,%ld,%ld,%f\n", datasets[dataset], count,
+               nodeCounts[static_cast<unsigned>(NTypes::N4)], nodeCounts[static_cast<unsigned>(NTypes::N16)],
+               nodeCounts[static_cast<unsigned>(NTypes::N32)], nodeCounts[static_cast<unsigned>(NTypes::N48)],
+               nodeCounts[static_cast<unsigned>(NTypes::N256)], (duration.count() * 1.0) / count);
+    }
+    delete[] keys;
+    delete[] values;
+}
+
+void prefixes(char **argv) {
+    std::cout << "long prefixes (ART_OLC_LONG_PREFIXES=" << ART_OLC_LONG_PREFIXES << "):" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *values = new uint64_t[n];
+    generateKeys(values, n, std::min(atoi(argv[2]), 1));
+    Key *keys = new Key[n];
+    TID *result = new TID[100];
+
+    printf("key length,operation,ops,loadKey/op,Mops/s\n");
+    const uint32_t paddings[] = {0, 8, 28};
+    for (uint32_t padding : paddings) {
+        compositePadding = padding;
+        for (uint64_t i = 0; i != n; i++) {
+            loadCompositeKey(values[i], keys[i]);
+        }
+        ART_OLC::Tree tree(loadCompositeKey);
+        auto t = tree.getThreadInfo();
+        auto report = [&](const char *operation, uint64_t ops, std::chrono::system_clock::time_point starttime) {
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now() - starttime);
+            printf("%u,%s,%ld,%f,%f\n", 12 + padding, operation, ops, (loadKeyCalls * 1.0) / ops,
+                   (ops * 1.0) / duration.count());
+            loadKeyCalls = 0;
+        };
+
+        loadKeyCalls = 0;
+        auto starttime = std::chrono::system_clock::now();
+        for (uint64_t i = 0; i != n; i++) {
+            tree.insert(keys[i], values[i], t);
+        }
+        report("insert", n, starttime);
+
+        starttime = std::chrono::system_clock::now();
+        for (uint64_t i = 0; i != n; i++) {
+            auto val = tree.lookup(keys[i], t);
+            if (val != values[i]) {
+                std::cout << "wrong key read: " << val << " expected:" << values[i] << std::endl;
+                throw;
+            }
+        }
+        report("lookup", n, starttime);
+
+        // scans of 100 keys from a tenant's key to the end of the tenant
+        uint64_t scans = std::max<uint64_t>(1, n / 100);
+        starttime = std::chrono::system_clock::now();
+        for (uint64_t i = 0; i != scans; i++) {
+            Key end, continueKey;
+            end.set(reinterpret_cast<const char *>(&keys[i][0]), keys[i].getKeyLen());
+            memset(&end[4], 0xff, end.getKeyLen() - 4);
+            std::size_t resultCount;
+            tree.lookupRange(keys[i], end, continueKey, result, 100, resultCount, t);
+        }
+        report("scan", scans, starttime);
+    }
+    delete[] result;
+    delete[] keys;
+    delete[] values;
+}
+
+void leaves(char **argv) {
+    std::cout << "leaf modes with a cache-cold loadKey:" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *values = new uint64_t[n];
+    Key *keys = new Key[n];
+    tuples = static_cast<Tuple *>(aligned_alloc(64, (n + 1) * sizeof(Tuple)));
+
+    printf("dataset,leaves,insert ns/op,lookup ns/op,loadKey/lookup\n");
+    const char *datasets[] = {"dense", "sparse"};
+    const char *leafModes[] = {"TidOnly", "EmbeddedKey"};
+    for (int dataset = 0; dataset < 2; ++dataset) {
+        generateKeys(values, n, dataset + 1);
+        for (uint64_t i = 0; i != n; i++) {
+            tuples[i + 1].key = values[i];
+            loadKey(values[i], keys[i]);
+        }
+        for (auto leafMode : {ART_OLC::LeafMode::TidOnly, ART_OLC::LeafMode::EmbeddedKey}) {
+            ART_OLC::Tree tree(loadColdKey, leafMode);
+            auto t = tree.getThreadInfo();
+            auto starttime = std::chrono::system_clock::now();
+            for (uint64_t i = 0; i != n; i++) {
+                tree.insert(keys[i], i + 1, t);
+            }
+            auto insertDuration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now() - starttime);
+
+            loadKeyCalls = 0;
+            starttime = std::chrono::system_clock::now();
+            for (uint64_t i = 0; i != n; i++) {
+                auto val = tree.lookup(keys[i], t);
+                if (val != i + 1) {
+                    std::cout << "wrong key read: " << val << " expected:" << i + 1 << std::endl;
+                    throw;
+                }
+            }
+            auto lookupDuration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now() - starttime);
+            printf("%s,%s,%f,%f,%f\n", datasets[dataset], leafModes[static_cast<int>(leafMode)],
+                   (insertDuration.count() * 1.0) / n, (lookupDuration.count() * 1.0) / n, (loadKeyCalls * 1.0) / n);
+        }
+    }
+    free(tuples);
+    tuples = nullptr;
+    delete[] keys;
+    delete[] values;
+}
+
+void epoche(char **argv) {
+    std::cout << "epoch-based reclamation:" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+
+    // every operation retires one node, as removes that shrink a node do, and the time of exitEpocheAndCleanup
+    // includes the scan over the slots of all threads for the oldest epoche. First all threads run operations,
+    // then one thread runs them while the others stay attached between their operations.
+    printf("threads,n,all active exitEpocheAndCleanup ns/op,one active exitEpocheAndCleanup ns/op\n");
+    for (unsigned threads : {1, 16, 64}) {
+        double nsPerOp[2];
+        for (int oneActive = 0; oneActive < 2; ++oneActive) {
+            ART::Epoche epoche{256};
+            std::atomic<uint64_t> exitNs{0};
+            std::atomic<unsigned> attached{0};
+            std::atomic<bool> done{false};
+            std::vector<std::thread> workers;
+            for (unsigned w = 0; w < threads; ++w) {
+                workers.emplace_back([&, w]() {
+                    ART::ThreadInfo t(epoche);
+                    epoche.enterEpoche(t);
+                    epoche.exitEpocheAndCleanup(t);
+                    attached++;
+                    if (oneActive && w != 0) {
+                        while (!done) {
+                            std::this_thread::yield();
+                        }
+                        return;
+                    }
+                    while (attached != threads) {
+                        std::this_thread::yield();
+                    }
+                    std::chrono::nanoseconds ns{0};
+                    for (uint64_t i = 0; i != n; i++) {
+                        epoche.enterEpoche(t);
+                        epoche.markNodeForDeletion(ART::NodeAllocator::allocate(64), t);
+                        auto starttime = std::chrono::steady_clock::now();
+                        epoche.exitEpocheAndCleanup(t);
+                        ns += std::chrono::steady_clock::now() - starttime;
+                    }
+                    exitNs += ns.count();
+                    done = true;
+                });
+            }
+            for (auto &w : workers) {
+                w.join();
+            }
+            nsPerOp[oneActive] = (exitNs * 1.0) / (n * (oneActive ? 1 : threads));
+        }
+        printf("%u,%ld,%f,%f\n", threads, n, nsPerOp[0], nsPerOp[1]);
+    }
+}
+
+void reclaim(char **argv) {
+    std::cout << "inline vs. background reclamation:" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *keys = new uint64_t[n];
+
+    generateKeys(keys, n, atoi(argv[2]));
+
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    printf("reclamation,operation,threads,p50 ns,p99 ns,p99.9 ns,p99.99 ns,max ns\n");
+    const char *reclaimModes[] = {"inline", "background"};
+    for (auto reclaimMode : {ReclaimMode::Inline, ReclaimMode::Background}) {
+        ART_OLC::Tree tree(loadKey, ART_OLC::LeafMode::TidOnly, reclaimMode);
+        // inserts retire the nodes they grow, removes the nodes they shrink and their leaves' nodes
+        const char *phases[] = {"insert", "remove"};
+        for (int phase = 0; phase < 2; ++phase) {
+            std::vector<uint64_t> latencies(n);
+            std::vector<std::thread> workers;
+            for (unsigned w = 0; w < threads; ++w) {
+                workers.emplace_back([&, w]() {
+                    auto t = tree.getThreadInfo();
+                    for (uint64_t i = w; i < n; i += threads) {
+                        Key key;
+                        loadKey(keys[i], key);
+                        auto starttime = std::chrono::steady_clock::now();
+                        if (phase == 0) {
+                            tree.insert(key, keys[i], t);
+                        } else {
+                            tree.remove(key, keys[i], t);
+                        }
+                        latencies[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - starttime).count();
+                    }
+                });
+            }
+            for (auto &w : workers) {
+                w.join();
+            }
+            std::sort(latencies.begin(), latencies.end());
+            auto percentile = [&](double p) { return latencies[std::min<uint64_t>(n - 1, n * p)]; };
+            printf("%s,%s,%u,%ld,%ld,%ld,%ld,%ld\n", reclaimModes[static_cast<int>(reclaimMode)], phases[phase],
+                   threads, percentile(0.5), percentile(0.99), percentile(0.999), percentile(0.9999),
+                   latencies[n - 1]);
+        }
+    }
+    delete[] keys;
+}
+
+void advance(char **argv) {
+    std::cout << "epoche advancement (ART_EPOCHE_ADAPTIVE=" << ART_EPOCHE_ADAPTIVE << "):" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *keys = new uint64_t[n];
+
+    generateKeys(keys, n, atoi(argv[2]));
+
+    printf("writes %%,threads,Mops/s,epoche advances/s,avg pending kB,max pending kB\n");
+    std::vector<unsigned> threadCounts = {1};
+    if (std::thread::hardware_concurrency() > 1) {
+        threadCounts.push_back(std::thread::hardware_concurrency());
+    }
+    for (unsigned writePercent : {100, 5}) {
+        for (unsigned threads : threadCounts) {
+            ART_OLC::Tree tree(loadKey);
+            ART::Epoche *epochePtr;
+            {
+                // the ThreadInfo detaches at the end of the scope, otherwise its epoche would hold back reclamation
+                auto t = tree.getThreadInfo();
+                for (uint64_t i = 0; i != n; i++) {
+                    Key key;
+                    loadKey(keys[i], key);
+                    tree.insert(key, keys[i], t);
+                }
+                epochePtr = &t.getEpoche();
+            }
+            ART::Epoche &epoche = *epochePtr;
+            uint64_t advancesBefore = epoche.getEpocheAdvances();
+
+            // writes remove a key and insert it again, which retires the nodes that shrink and grow
+            std::atomic<unsigned> running{threads};
+            auto starttime = std::chrono::system_clock::now();
+            std::vector<std::thread> workers;
+            for (unsigned w = 0; w < threads; ++w) {
+                workers.emplace_back([&, w]() {
+                    auto t = tree.getThreadInfo();
+                    for (uint64_t i = w; i < n; i += threads) {
+                        Key key;
+                        loadKey(keys[i], key);
+                        if ((i * 0x9E3779B97F4A7C15ul >> 32) % 100 < writePercent) {
+                            tree.remove(key, keys[i], t);
+                            tree.insert(key, keys[i], t);
+                        } else if (tree.lookup(key, t) != keys[i]) {
+                            std::cout << "wrong key read: " << keys[i] << std::endl;
+                            throw;
+                        }
+                    }
+                    running--;
+                });
+            }
+            uint64_t samples = 0, pendingSum = 0, pendingMax = 0;
+            while (running > 0) {
+                uint64_t pending = epoche.getPendingBytes();
+                pendingSum += pending;
+                pendingMax = std::max(pendingMax, pending);
+                samples++;
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            for (auto &w : workers) {
+                w.join();
+            }
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now() - starttime);
+            printf("%u,%u,%f,%f,%f,%f\n", writePercent, threads, (n * 1.0) / duration.count(),
+                   (epoche.getEpocheAdvances() - advancesBefore) * 1000000.0 / duration.count(),
+                   pendingSum / 1024.0 / std::max<uint64_t>(samples, 1), pendingMax / 1024.0);
+        }
+    }
+    delete[] keys;
+}
+
+void epocheStats(char **argv) {
+    std::cout << "epoche stats with a stalling reader:" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *keys = new uint64_t[n];
+
+    generateKeys(keys, n, atoi(argv[2]));
+
+    ART_OLC::Tree tree(loadKey);
+    {
+        auto t = tree.getThreadInfo();
+        for (uint64_t i = 0; i != n; i++) {
+            Key key;
+            loadKey(keys[i], key);
+            tree.insert(key, keys[i], t);
+        }
+    }
+
+    // the writers remove keys and insert them again, the reader stays in the epoche of its last lookup while it
+    // sleeps 20 ms after every 10000 lookups
+    unsigned writers = std::max(2u, std::thread::hardware_concurrency());
+    std::atomic<unsigned> running{writers};
+    std::thread::id readerId;
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < writers; ++w) {
+        workers.emplace_back([&, w]() {
+            auto t = tree.getThreadInfo();
+            for (uint64_t i = w; i < n; i += writers) {
+                Key key;
+                loadKey(keys[i], key);
+                tree.remove(key, keys[i], t);
+                tree.insert(key, keys[i], t);
+            }
+            running--;
+        });
+    }
+    std::thread reader([&]() {
+        auto t = tree.getThreadInfo();
+        for (uint64_t i = 0; running > 0; i = (i + 1) % n) {
+            Key key;
+            loadKey(keys[i], key);
+            tree.lookup(key, t);
+            if (i % 10000 == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        }
+    });
+    readerId = reader.get_id();
+
+    printf("ms,current epoche,oldest epoche,lag,held back by,threads,pending nodes,pending kB,passes,"
+           "avg pass us,max pass us\n");
+    auto starttime = std::chrono::steady_clock::now();
+    while (running > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ART::EpocheStats stats = tree.getEpocheStats();
+        const char *holder = stats.oldestThread == std::thread::id() ? "-" :
+                             stats.oldestThread == readerId ? "reader" : "writer";
+        printf("%ld,%lu,%lu,%lu,%s,%zu,%zu,%f,%lu,%f,%f\n",
+               std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                     starttime).count(),
+               stats.currentEpoche, stats.oldestEpoche, stats.epocheLag, holder, stats.threads.size(),
+               stats.pendingNodes, stats.pendingBytes / 1024.0, stats.reclaimPasses,
+               stats.reclaimNs / 1000.0 / std::max<uint64_t>(stats.reclaimPasses, 1), stats.maxPassNs / 1000.0);
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    reader.join();
+    delete[] keys;
+}
+
+template<typename TREE>
+double lookupThroughput(TREE &tree, const uint64_t *keys, uint64_t n, unsigned threads) {
+    auto starttime = std::chrono::system_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < threads; ++w) {
+        workers.emplace_back([&, w]() {
+            auto t = tree.getThreadInfo();
+            for (uint64_t i = w; i < n; i += threads) {
+                Key key;
+                loadKey(keys[i], key);
+                if (tree.lookup(key, t) != keys[i]) {
+                    std::cout << "wrong key read: " << keys[i] << std::endl;
+                    throw;
+                }
+                // no effect with ReclaimScheme::EpochBased
+                if ((i & (1024 - 1)) == w) {
+                    tree.quiescent(t);
+                }
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now() - starttime);
+    return (n * 1.0) / duration.count();
+}
+
+void qsbr(char **argv) {
+    std::cout << "epoch-based vs. quiescent-state-based reclamation:" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *keys = new uint64_t[n];
+
+    generateKeys(keys, n, atoi(argv[2]));
+
+    ART_OLC::Tree olcEbr(loadKey), olcQsbr(loadKey, ART_OLC::LeafMode::TidOnly, ReclaimMode::Inline,
+                                          ReclaimScheme::QuiescentState);
+    ART_ROWEX::Tree rowexEbr(loadKey), rowexQsbr(loadKey, ReclaimMode::Inline, ReclaimScheme::QuiescentState);
+    {
+        auto t1 = olcEbr.getThreadInfo();
+        auto t2 = olcQsbr.getThreadInfo();
+        auto t3 = rowexEbr.getThreadInfo();
+        auto t4 = rowexQsbr.getThreadInfo();
+        for (uint64_t i = 0; i != n; i++) {
+            Key key;
+            loadKey(keys[i], key);
+            olcEbr.insert(key, keys[i], t1);
+            olcQsbr.insert(key, keys[i], t2);
+            rowexEbr.insert(key, keys[i], t3);
+            rowexQsbr.insert(key, keys[i], t4);
+        }
+    }
+
+    // the trees take turns, the best of 3 rounds is reported
+    printf("tree,reclamation,threads,lookup Mops/s\n");
+    std::vector<unsigned> threadCounts = {1};
+    if (std::thread::hardware_concurrency() > 1) {
+        threadCounts.push_back(std::thread::hardware_concurrency());
+    }
+    for (unsigned threads : threadCounts) {
+        double best[4] = {0, 0, 0, 0};
+        for (int round = 0; round < 3; ++round) {
+            best[0] = std::max(best[0], lookupThroughput(olcEbr, keys, n, threads));
+            best[1] = std::max(best[1], lookupThroughput(olcQsbr, keys, n, threads));
+            best[2] = std::max(best[2], lookupThroughput(rowexEbr, keys, n, threads));
+            best[3] = std::max(best[3], lookupThroughput(rowexQsbr, keys, n, threads));
+        }
+        printf("olc,EBR,%u,%f\nolc,QSBR,%u,%f\nrowex,EBR,%u,%f\nrowex,QSBR,%u,%f\n", threads, best[0], threads,
+               best[1], threads, best[2], threads, best[3]);
+    }
+    delete[] keys;
+}
+
+void budget(char **argv) {
+    std::cout << "retired memory budget with a slow range scan:" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *keys = new uint64_t[n];
+
+    generateKeys(keys, n, atoi(argv[2]));
+
+    // budget in bytes, scan re-pin interval in keys
+    const std::vector<std::pair<std::size_t, uint64_t>> configs = {{0, 0}, {1 << 20, 0}, {1 << 20, 1000}};
+    printf("budget kB,repin keys,writer Mops/s,scanned keys,peak pending kB,throttled ops,throttled ms,"
+           "blocked by\n");
+    for (auto &config : configs) {
+        // every removed key retires its leaf
+        ART_OLC::Tree tree(loadKey, ART_OLC::LeafMode::EmbeddedKey);
+        {
+            auto t = tree.getThreadInfo();
+            for (uint64_t i = 0; i != n; i++) {
+                Key key;
+                loadKey(keys[i], key);
+                tree.insert(key, keys[i], t);
+            }
+        }
+        tree.setRetiredBudget(config.first);
+
+        // for one second the writers remove keys and insert them again, the scanner sleeps 1 ms every 1000 keys
+        unsigned writers = std::max(2u, std::thread::hardware_concurrency());
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> ops{0}, scanned{0};
+        std::vector<std::thread> workers;
+        for (unsigned w = 0; w < writers; ++w) {
+            workers.emplace_back([&, w]() {
+                auto t = tree.getThreadInfo();
+                uint64_t done = 0;
+                for (uint64_t i = w; !stop; i = (i + writers) % n) {
+                    Key key;
+                    loadKey(keys[i], key);
+                    tree.remove(key, keys[i], t);
+                    tree.insert(key, keys[i], t);
+                    done += 2;
+                }
+                ops += done;
+            });
+        }
+        std::thread scanner([&]() {
+            auto t = tree.getThreadInfo();
+            while (!stop) {
+                ART_OLC::Tree::Cursor cursor(tree, t);
+                cursor.setRepinInterval(config.second);
+                cursor.seek(Key());
+                TID tid;
+                for (uint64_t i = 1; !stop && cursor.next(tid); ++i) {
+                    if (i % 1000 == 0) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                    scanned++;
+                }
+            }
+        });
+        std::thread::id scannerId = scanner.get_id();
+
+        std::size_t peak = 0;
+        auto starttime = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - starttime < std::chrono::seconds(1)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            peak = std::max(peak, tree.getEpocheStats().pendingBytes);
+        }
+        stop = true;
+        for (auto &w : workers) {
+            w.join();
+        }
+        scanner.join();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - starttime);
+
+        ART::EpocheStats stats = tree.getEpocheStats();
+        const char *blocker = stats.lastBlockingThread == std::thread::id() ? "-" :
+                              stats.lastBlockingThread == scannerId ? "scanner" : "writer";
+        printf("%zu,%lu,%f,%lu,%f,%lu,%f,%s\n", config.first / 1024, config.second, ops * 1.0 / duration.count(),
+               scanned.load(), peak / 1024.0, stats.throttledOperations, stats.throttleNs / 1000000.0, blocker);
+    }
+    delete[] keys;
+}
+
+template<typename TREE>
+double sessionLookupThroughput(TREE &tree, const uint64_t *keys, uint64_t n, unsigned threads,
+                               uint32_t repinInterval) {
+    auto starttime = std::chrono::system_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < threads; ++w) {
+        workers.emplace_back([&, w]() {
+            auto t = tree.getThreadInfo();
+            auto lookups = [&]() {
+                for (uint64_t i = w; i < n; i += threads) {
+                    Key key;
+                    loadKey(keys[i], key);
+                    if (tree.lookup(key, t) != keys[i]) {
+                        std::cout << "wrong key read: " << keys[i] << std::endl;
+                        throw;
+                    }
+                }
+            };
+            if (repinInterval == 0) {
+                lookups();
+            } else {
+                auto session = tree.pin(t, repinInterval);
+                lookups();
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now() - starttime);
+    return (n * 1.0) / duration.count();
+}
+
+void session(char **argv) {
+    std::cout << "per-operation epoche guards vs. sessions:" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *keys = new uint64_t[n];
+
+    generateKeys(keys, n, atoi(argv[2]));
+
+    ART_OLC::Tree olc(loadKey);
+    ART_ROWEX::Tree rowex(loadKey);
+    {
+        auto t1 = olc.getThreadInfo();
+        auto t2 = rowex.getThreadInfo();
+        for (uint64_t i = 0; i != n; i++) {
+            Key key;
+            loadKey(keys[i], key);
+            olc.insert(key, keys[i], t1);
+            rowex.insert(key, keys[i], t2);
+        }
+    }
+
+    // 0: a guard per lookup, else a session per thread that re-pins every so many lookups. The configurations take
+    // turns, the best of 3 rounds is reported.
+    const std::vector<uint32_t> repinIntervals = {0, 64, 1024};
+    printf("tree,threads,repin interval,lookup Mops/s\n");
+    std::vector<unsigned> threadCounts = {1};
+    if (std::thread::hardware_concurrency() > 1) {
+        threadCounts.push_back(std::thread::hardware_concurrency());
+    }
+    for (unsigned threads : threadCounts) {
+        std::vector<double> bestOlc(repinIntervals.size()), bestRowex(repinIntervals.size());
+        for (int round = 0; round < 3; ++round) {
+            for (std::size_t r = 0; r < repinIntervals.size(); ++r) {
+                bestOlc[r] = std::max(bestOlc[r], sessionLookupThroughput(olc, keys, n, threads, repinIntervals[r]));
+                bestRowex[r] = std::max(bestRowex[r],
+                                        sessionLookupThroughput(rowex, keys, n, threads, repinIntervals[r]));
+            }
+        }
+        for (std::size_t r = 0; r < repinIntervals.size(); ++r) {
+            printf("olc,%u,%u,%f\n", threads, repinIntervals[r], bestOlc[r]);
+        }
+        for (std::size_t r = 0; r < repinIntervals.size(); ++r) {
+            printf("rowex,%u,%u,%f\n", threads, repinIntervals[r], bestRowex[r]);
+        }
+    }
+    delete[] keys;
+}
+
+// one line per statistic, NTYPES is the NTypes of the tree variant
+template<typename NTYPES, typename STATS>
+void printTreeStats(const char *tree, const char *keys, uint64_t n, const STATS &s, const char *const typeNames[],
+                    unsigned typeCount) {
+    auto histogram = [](const std::vector<uint64_t> &counts) {
+        std::string h;
+        for (std::size_t i = 0; i < counts.size(); ++i) {
+            if (counts[i] != 0) {
+                h += (h.empty() ? "" : " ") + std::to_string(i) + ":" + std::to_string(counts[i]);
+            }
+        }
+        return h;
+    };
+    uint64_t nodes = 0;
+    for (unsigned t = 0; t < typeCount; ++t) {
+        printf("%s,%s,%s nodes,%lu,fanout %.1f\n", tree, keys, typeNames[t], s.nodes[t],
+               s.averageFanout(static_cast<NTYPES>(t)));
+        nodes += s.nodes[t];
+    }
+    printf("%s,%s,leaves,%lu\n", tree, keys, s.leaves);
+    printf("%s,%s,leaf depths,%s\n", tree, keys, histogram(s.leafDepths).c_str());
+    printf("%s,%s,prefix lengths,%s\n", tree, keys, histogram(s.prefixLengths).c_str());
+    printf("%s,%s,prefixes beyond stored,%lu,%.1f%%\n", tree, keys, s.prefixesBeyondStored,
+           nodes == 0 ? 0 : 100.0 * s.prefixesBeyondStored / nodes);
+    printf("%s,%s,bytes,%zu,%.1f per key\n", tree, keys, s.bytes, (s.bytes * 1.0) / n);
+}
+
+void treeStats(char **argv) {
+    std::cout << "tree statistics:" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *values = new uint64_t[n];
+    Key *keys = new Key[n];
+    const char *olcTypes[ART_OLC::nodeTypeCount] = {"N4", "N16", "N48", "N256", "N32"};
+    const char *rowexTypes[ART_ROWEX::nodeTypeCount] = {"N4", "N16", "N48", "N256"};
+    // N32 is the last type, it has no row if the build has no N32
+    const unsigned olcTypeCount = ART_OLC_N32 ? ART_OLC::nodeTypeCount : ART_OLC::nodeTypeCount - 1;
+
+    printf("tree,keys,statistic,value\n");
+    for (const char *dataset : {"integer", "email", "url"}) {
+        std::unique_ptr<ART::KeyGenerator> generator;
+        auto load = loadKey;
+        if (strcmp(dataset, "integer") == 0) {
+            generateKeys(values, n, atoi(argv[2]));
+            for (uint64_t i = 0; i != n; i++) {
+                loadKey(values[i], keys[i]);
+            }
+        } else {
+            generator.reset(new ART::KeyGenerator(ART::KeyGenerator::parse(dataset)));
+            generatedKeys = generator.get();
+            load = loadGeneratedKey;
+            for (uint64_t i = 0; i != n; i++) {
+                values[i] = i + 1;
+                generator->key(i, keys[i]);
+            }
+        }
+        {
+            ART_OLC::Tree tree(load);
+            auto t = tree.getThreadInfo();
+            for (uint64_t i = 0; i != n; i++) {
+                tree.insert(keys[i], values[i], t);
+            }
+            printTreeStats<ART_OLC::NTypes>("olc", dataset, n, tree.stats(t), olcTypes, olcTypeCount);
+        }
+        {
+            ART_ROWEX::Tree tree(load);
+            auto t = tree.getThreadInfo();
+            for (uint64_t i = 0; i != n; i++) {
+                tree.insert(keys[i], values[i], t);
+            }
+            printTreeStats<ART_ROWEX::NTypes>("rowex", dataset, n, tree.stats(t), rowexTypes,
+                                              ART_ROWEX::nodeTypeCount);
+        }
+    }
+    delete[] keys;
+    delete[] values;
+}
+
+void perfCounters(char **argv) {
+    std::cout << "performance counters per operation:" << std::endl;
+
+    uint64_t n = std::atoll(argv[1]);
+    uint64_t *keys = new uint64_t[n];
+    generateKeys(keys, n, atoi(argv[2]));
+
+    const unsigned threads = std::thread::hardware_concurrency();
+    const char *phases[] = {"insert", "lookup", "scan", "remove"};
+    // per phase and thread
+    std::vector<std::vector<ART::PerfValues>> counts(4, std::vector<ART::PerfValues>(threads));
+    std::vector<std::vector<uint64_t>> operations(4, std::vector<uint64_t>(threads));
+    std::string error;
+    ART_OLC::Tree tree(loadKey);
+    std::atomic<unsigned> ready{0};
+
+    // each thread counts its share of the keys, the threads wait for each other between the phases
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            ART::PerfCounters counters;
+            if (t == 0) {
+                error = counters.error();
+            }
+            auto threadInfo = tree.getThreadInfo();
+            TID result[100];
+            for (unsigned phase = 0; phase < 4; ++phase) {
+                ready++;
+                while (ready.load() < threads * (phase + 1)) {
+                    std::this_thread::yield();
+                }
+                uint64_t ops = 0;
+                counters.start();
+                for (uint64_t i = t; i < n; i += threads) {
+                    Key key;
+                    loadKey(keys[i], key);
+                    if (phase == 0) {
+                        tree.insert(key, keys[i], threadInfo);
+                    } else if (phase == 1) {
+                        if (tree.lookup(key, threadInfo) != keys[i]) {
+                            std::cout << "wrong key read: " << keys[i] << std::endl;
+                            throw;
+                        }
+                    } else if (phase == 2) {
+                        Key end, continueKey;
+                        loadKey(~0ull, end);
+                        std::size_t found;
+                        tree.lookupRange(key, end, continueKey, result, 100, found, threadInfo);
+                    } else {
+                        tree.remove(key, keys[i], threadInfo);
+                    }
+                    ops++;
+                }
+                counts[phase][t] = counters.stop();
+                operations[phase][t] = ops;
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    if (!error.empty()) {
+        printf("counters not available: %s\n", error.c_str());
+    }
+    printf("phase,thread,ops");
+    for (unsigned e = 0; e < ART::perfEventCount; ++e) {
+        printf(",%s/op", ART::PerfValues::name(e));
+    }
+    printf("\n");
+    for (unsigned phase = 0; phase < 4; ++phase) {
+        for (unsigned t = 0; t <= threads; ++t) {
+            ART::PerfValues values;
+            uint64_t ops = 0;
+            for (unsigned u = 0; u < threads; ++u) {
+                if (t == threads || t == u) {
+                    values.add(counts[phase][u]);
+                    ops += operations[phase][u];
+                }
+            }
+            printf("%s,%s,%lu", phases[phase], t == threads ? "all" : std::to_string(t).c_str(), ops);
+            for (unsigned e = 0; e < ART::perfEventCount; ++e) {
+                if (values.counts[e] < 0) {
+                    printf(",-");
+                } else {
+                    printf(",%f", values.counts[e] / ops);
+                }
+            }
+            printf("\n");
+        }
+    }
+    delete[] keys;
+}
+
 int main(int argc, char **argv) {
-    if (argc != 3) {
-        printf("usage: %s n 0|1|2\nn: number of keys\n0: sorted keys\n1: dense keys\n2: sparse keys\n", argv[0]);
+    if (argc != 3 && argc != 4) {
+        printf("usage: %s n 0|1|2 [mode]\nn: number of keys\n0: sorted keys\n1: dense keys\n2: sparse keys\n"
+               "mode: batch (batched vs. single lookups), scan (range scans), alloc (node allocation rate and peak memory),\n"
+               "      bulk (bulk load vs. insert), update (upsert, insertIfAbsent and compareAndSwap on hot keys),\n"
+               "      nodescan (range scans over sparse N48/N256 with each NodeScan implementation),\n"
+               "      nodes (ART_OLC node types and lookup latency for integer, string, timestamp, email, URL and binary keys),\n"
+               "      prefixes (ART_OLC loadKey calls per operation for composite keys with long common prefixes),\n"
+               "      leaves (ART_OLC lookups with TID and key-embedding leaves and a cache-cold loadKey),\n"
+               "      epoche (cost of exitEpocheAndCleanup with 1, 16 and 64 threads retiring nodes),\n"
+               "      reclaim (ART_OLC insert and remove latency percentiles with inline and background reclamation),\n"
+               "      advance (ART_OLC epoche advances/s and memory waiting for reclamation, write-heavy and read-mostly),\n"
+               "      epochestats (ART_OLC::Tree::getEpocheStats every 10 ms while a reader stalls reclamation),\n"
+               "      qsbr (ART_OLC and ART_ROWEX lookup throughput with epoch-based and quiescent-state-based reclamation),\n"
+               "      budget (ART_OLC writers and a slow scan without and with a retired memory budget and scan re-pinning),\n"
+               "      session (ART_OLC and ART_ROWEX lookup throughput with an epoche guard per lookup and with sessions),\n"
+               "      perf (ART_OLC cycles, instructions, cache, TLB and branch misses per insert, lookup, scan and remove),\n"
+               "      stats (ART_OLC and ART_ROWEX node types, fanout, leaf depths, prefix lengths and bytes)\n",
+               argv[0]);
         return 1;
     }
 
+    if (argc == 4) {
+        std::string mode(argv[3]);
+        if (mode == "batch") {
+            batched(argv);
+        } else if (mode == "scan") {
+            scan(argv);
+        } else if (mode == "alloc") {
+            allocation(argv);
+        } else if (mode == "bulk") {
+            bulkLoad(argv);
+        } else if (mode == "update") {
+            update(argv);
+        } else if (mode == "nodescan") {
+            nodeScan(argv);
+        } else if (mode == "nodes") {
+            nodeTypes(argv);
+        } else if (mode == "prefixes") {
+            prefixes(argv);
+        } else if (mode == "leaves") {
+            leaves(argv);
+        } else if (mode == "epoche") {
+            epoche(argv);
+        } else if (mode == "reclaim") {
+            reclaim(argv);
+        } else if (mode == "advance") {
+            advance(argv);
+        } else if (mode == "epochestats") {
+            epocheStats(argv);
+        } else if (mode == "qsbr") {
+            qsbr(argv);
+        } else if (mode == "budget") {
+            budget(argv);
+        } else if (mode == "session") {
+            session(argv);
+        } else if (mode == "perf") {
+            perfCounters(argv);
+        } else if (mode == "stats") {
+            treeStats(argv);
+        } else {
+            printf("unknown mode %s\n", argv[3]);
+            return 1;
+        }
+        return 0;
+    }
+
     singlethreaded(argv);
 
     multithreaded(argv);
@@ -0,0 +1,890 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "OptimisticLockCoupling/Tree.h"
+#include "ROWEX/Tree.h"
+#include "ART/Tree.h"
+#include "Epoche.cpp"
+
+// checks of the trees against a std::map of the same keys, exits with 1 if any fails
+
+static unsigned failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+void loadKey(TID tid, Key &key) {
+    key.setKeyLen(sizeof(tid));
+    reinterpret_cast<uint64_t *>(&key[0])[0] = __builtin_bswap64(tid);
+}
+
+Key keyOf(TID tid) {
+    Key k;
+    loadKey(tid, k);
+    return k;
+}
+
+// keys 1..n, sorted for the bulk load
+void sortedKeys(uint64_t n, std::vector<Key> &keys, std::vector<TID> &tids) {
+    keys = std::vector<Key>(n);
+    tids.resize(n);
+    for (uint64_t i = 0; i < n; i++) {
+        tids[i] = i + 1;
+        loadKey(tids[i], keys[i]);
+    }
+}
+
+// String keys that share prefixes of all lengths, some longer than the prefix a node stores and than the 128 bytes
+// Key keeps on the stack. They end with a 0, so that none is a prefix of another. The TID of strings[i] is i + 1, or
+// i + 1 plus a multiple of strings.size() for the updates, which give a key other TIDs.
+std::vector<std::string> strings;
+uint64_t loadKeyCalls = 0;
+
+void loadStringKey(TID tid, Key &key) {
+    loadKeyCalls++;
+    const std::string &s = strings[(tid - 1) % strings.size()];
+    key.set(s.data(), s.size());
+}
+
+void setKey(Key &k, const std::string &s) {
+    if (s.empty()) {
+        k.setKeyLen(0);
+    } else {
+        k.set(s.data(), s.size());
+    }
+}
+
+std::string keyString(const Key &k) {
+    return k.getKeyLen() == 0 ? std::string() : std::string(reinterpret_cast<const char *>(&k[0]), k.getKeyLen());
+}
+
+// a bound between the keys
+std::string terminated(std::string s) {
+    s.push_back('\0');
+    return s;
+}
+
+std::map<std::string, TID> generateStrings(std::size_t count) {
+    std::mt19937_64 random(42);
+    const char *parts[] = {"a", "ab", "abc", "b", "ba", "bab", "c", "zz", "q"};
+    std::map<std::string, TID> keys;
+    strings.clear();
+    while (strings.size() < count) {
+        std::string s;
+        if (random() % 16 == 0) {
+            s = std::string(20 + random() % 150, 'p');
+        }
+        for (unsigned i = 0, n = 1 + random() % 4; i < n; i++) {
+            s += parts[random() % 9];
+        }
+        s += std::to_string(random() % 50);
+        s.push_back('\0');
+        if (keys.count(s) == 0) {
+            strings.push_back(s);
+            keys[s] = strings.size();
+        }
+    }
+    return keys;
+}
+
+// the TIDs of the keys in [start, end), descending if reverse, an empty end is no bound
+std::vector<TID> expectedRange(const std::map<std::string, TID> &keys, const std::string &start,
+                               const std::string &end, bool reverse) {
+    std::vector<TID> tids;
+    for (auto it = keys.lower_bound(start); it != keys.end() && (end.empty() || it->first < end); ++it) {
+        tids.push_back(it->second);
+    }
+    if (reverse) {
+        std::reverse(tids.begin(), tids.end());
+    }
+    return tids;
+}
+
+// pages through [start, end) with scan, a lookupRange or lookupRangeReverse, continuing at continueKey
+template<typename SCAN>
+std::vector<TID> scanPages(SCAN scan, std::string start, std::string end, bool reverse, std::size_t pageSize) {
+    std::vector<TID> tids, page(pageSize);
+    for (std::size_t pages = 0; pages <= strings.size(); pages++) {
+        Key startKey, endKey, continueKey;
+        setKey(startKey, start);
+        setKey(endKey, end);
+        std::size_t found = 0;
+        bool more = scan(startKey, endKey, continueKey, page.data(), pageSize, found);
+        tids.insert(tids.end(), page.begin(), page.begin() + found);
+        if (!more) {
+            break;
+        }
+        CHECK(found == pageSize);
+        (reverse ? end : start) = keyString(continueKey);
+    }
+    return tids;
+}
+
+// pages through [start, end) with Cursors, each seeking behind the last key of the one before
+std::vector<TID> cursorPages(const ART_OLC::Tree &tree, ART::ThreadInfo &t, const std::string &start,
+                             const std::string &end, bool reverse, std::size_t pageSize) {
+    std::vector<TID> tids;
+    // reverse starts before end, which is not in the range
+    std::string from = reverse ? end : start;
+    bool inclusive = !reverse;
+    while (true) {
+        ART_OLC::Tree::Cursor cursor(tree, t, reverse);
+        Key k;
+        if (reverse) {
+            setKey(k, start);
+            cursor.setStart(k);
+        } else if (!end.empty()) {
+            setKey(k, end);
+            cursor.setEnd(k);
+        }
+        setKey(k, from);
+        cursor.seek(k, inclusive);
+        TID tid;
+        std::size_t count = 0;
+        while (count < pageSize && cursor.next(tid)) {
+            tids.push_back(tid);
+            count++;
+        }
+        if (count < pageSize) {
+            return tids;
+        }
+        from = strings[tid - 1];
+        inclusive = false;
+    }
+}
+
+std::vector<std::pair<std::string, std::string>> testRanges(const std::map<std::string, TID> &keys) {
+    std::vector<std::pair<std::string, std::string>> ranges = {
+            {"", ""}, {terminated("a"), terminated("b")}, {terminated("ab"), terminated("abc")},
+            {terminated("b"), terminated("zz")}, {"", terminated("c")}, {terminated("abab"), terminated("q")},
+            {terminated("zz"), terminated("zzz")}, {terminated("q"), ""}, {terminated("ba"), terminated("ba")},
+            {terminated("pppp"), terminated("ppppppppppppppppppppppppppppppppppppppppppq")}};
+    std::mt19937_64 random(7);
+    for (unsigned i = 0; i < 20; i++) {
+        auto a = std::next(keys.begin(), random() % keys.size())->first;
+        auto b = std::next(keys.begin(), random() % keys.size())->first;
+        if (a > b) {
+            std::swap(a, b);
+        }
+        ranges.push_back({a, b});
+        ranges.push_back({terminated(a.substr(0, 3)), terminated(b.substr(0, 2))});
+    }
+    return ranges;
+}
+
+// lookupRange and lookupRangeReverse of all trees and the OLC Cursor, in pages of several sizes
+void checkRanges(ART_OLC::LeafMode leafMode) {
+    printf("ranges, %s leaves\n", leafMode == ART_OLC::LeafMode::EmbeddedKey ? "embedded key" : "TID");
+    auto keys = generateStrings(3000);
+    ART_OLC::Tree olc(loadStringKey, leafMode);
+    ART_ROWEX::Tree rowex(loadStringKey);
+    ART_unsynchronized::Tree art(loadStringKey);
+    auto olcThread = olc.getThreadInfo();
+    auto rowexThread = rowex.getThreadInfo();
+    for (const auto &key : keys) {
+        Key k;
+        setKey(k, key.first);
+        olc.insert(k, key.second, olcThread);
+        rowex.insert(k, key.second, rowexThread);
+        art.insert(k, key.second);
+    }
+    for (const auto &range : testRanges(keys)) {
+        for (std::size_t pageSize : {1, 7, 100, 5000}) {
+            for (bool reverse : {false, true}) {
+                auto expected = expectedRange(keys, range.first, range.second, reverse);
+                CHECK(cursorPages(olc, olcThread, range.first, range.second, reverse, pageSize) == expected);
+                auto olcScan = [&](const Key &start, const Key &end, Key &continueKey, TID result[],
+                                   std::size_t resultLen, std::size_t &found) {
+                    return reverse ? olc.lookupRangeReverse(start, end, continueKey, result, resultLen, found,
+                                                            olcThread)
+                                   : olc.lookupRange(start, end, continueKey, result, resultLen, found, olcThread);
+                };
+                auto rowexScan = [&](const Key &start, const Key &end, Key &continueKey, TID result[],
+                                     std::size_t resultLen, std::size_t &found) {
+                    return reverse ? rowex.lookupRangeReverse(start, end, continueKey, result, resultLen, found,
+                                                              rowexThread)
+                                   : rowex.lookupRange(start, end, continueKey, result, resultLen, found,
+                                                       rowexThread);
+                };
+                auto artScan = [&](const Key &start, const Key &end, Key &continueKey, TID result[],
+                                   std::size_t resultLen, std::size_t &found) {
+                    return reverse ? art.lookupRangeReverse(start, end, continueKey, result, resultLen, found)
+                                   : art.lookupRange(start, end, continueKey, result, resultLen, found);
+                };
+                CHECK(scanPages(olcScan, range.first, range.second, reverse, pageSize) == expected);
+                CHECK(scanPages(rowexScan, range.first, range.second, reverse, pageSize) == expected);
+                CHECK(scanPages(artScan, range.first, range.second, reverse, pageSize) == expected);
+            }
+        }
+    }
+}
+
+// all keys in order and each key's TID
+template<typename LOOKUP, typename SCAN>
+void checkContent(const std::map<std::string, TID> &keys, LOOKUP lookup, SCAN scan) {
+    CHECK(scanPages(scan, "", "", true, 1000) == expectedRange(keys, "", "", true));
+    bool found = true;
+    for (const auto &key : keys) {
+        Key k;
+        setKey(k, key.first);
+        found = found && lookup(k) == key.second;
+        // absent keys in between
+        setKey(k, key.first.substr(0, key.first.size() - 1) + "x");
+        found = found && lookup(k) == 0;
+    }
+    CHECK(found);
+}
+
+template<typename STATS>
+bool sameShape(const STATS &a, const STATS &b) {
+    return a.leaves == b.leaves && a.leafDepths == b.leafDepths && a.prefixLengths == b.prefixLengths;
+}
+
+// bulk-loaded trees against trees of the same keys built by inserts, which have the same shape
+void checkBulkLoad(ART_OLC::LeafMode leafMode) {
+    printf("bulk load, %s leaves\n", leafMode == ART_OLC::LeafMode::EmbeddedKey ? "embedded key" : "TID");
+    auto keys = generateStrings(20000);
+    std::vector<Key> sorted(keys.size());
+    std::vector<TID> tids;
+    for (const auto &key : keys) {
+        setKey(sorted[tids.size()], key.first);
+        tids.push_back(key.second);
+    }
+    ART_OLC::Tree olcInserted(loadStringKey, leafMode);
+    ART_ROWEX::Tree rowexInserted(loadStringKey);
+    auto olcThread = olcInserted.getThreadInfo();
+    auto rowexThread = rowexInserted.getThreadInfo();
+    for (std::size_t i = 0; i < sorted.size(); i++) {
+        olcInserted.insert(sorted[i], tids[i], olcThread);
+        rowexInserted.insert(sorted[i], tids[i], rowexThread);
+    }
+    for (unsigned threads : {1u, 4u}) {
+        ART_OLC::Tree olc(loadStringKey, sorted.data(), tids.data(), sorted.size(), threads, leafMode);
+        auto t = olc.getThreadInfo();
+        CHECK(sameShape(olc.stats(t), olcInserted.stats(olcThread)));
+        checkContent(keys, [&](const Key &k) { return olc.lookup(k, t); },
+                     [&](const Key &start, const Key &end, Key &continueKey, TID result[], std::size_t resultLen,
+                         std::size_t &found) {
+                         return olc.lookupRangeReverse(start, end, continueKey, result, resultLen, found, t);
+                     });
+
+        ART_ROWEX::Tree rowex(loadStringKey, sorted.data(), tids.data(), sorted.size(), threads);
+        auto r = rowex.getThreadInfo();
+        CHECK(sameShape(rowex.stats(r), rowexInserted.stats(rowexThread)));
+        checkContent(keys, [&](const Key &k) { return rowex.lookup(k, r); },
+                     [&](const Key &start, const Key &end, Key &continueKey, TID result[], std::size_t resultLen,
+                         std::size_t &found) {
+                         return rowex.lookupRangeReverse(start, end, continueKey, result, resultLen, found, r);
+                     });
+
+        ART_unsynchronized::Tree art(loadStringKey, sorted.data(), tids.data(), sorted.size(), threads);
+        checkContent(keys, [&](const Key &k) { return art.lookup(k); },
+                     [&](const Key &start, const Key &end, Key &continueKey, TID result[], std::size_t resultLen,
+                         std::size_t &found) {
+                         return art.lookupRangeReverse(start, end, continueKey, result, resultLen, found);
+                     });
+    }
+}
+
+// bulk loads reject keys out of order and duplicates
+void checkBulkLoadValidation() {
+    printf("bulk load validation\n");
+    std::vector<Key> keys;
+    std::vector<TID> tids;
+    sortedKeys(1000, keys, tids);
+    auto rejects = [&]() {
+        unsigned rejected = 0;
+        for (unsigned threads : {1u, 4u}) {
+            try {
+                ART_OLC::Tree tree(loadKey, keys.data(), tids.data(), keys.size(), threads);
+            } catch (const std::invalid_argument &) {
+                rejected++;
+            }
+            try {
+                ART_ROWEX::Tree tree(loadKey, keys.data(), tids.data(), keys.size(), threads);
+            } catch (const std::invalid_argument &) {
+                rejected++;
+            }
+            try {
+                ART_unsynchronized::Tree tree(loadKey, keys.data(), tids.data(), keys.size(), threads);
+            } catch (const std::invalid_argument &) {
+                rejected++;
+            }
+        }
+        return rejected;
+    };
+    CHECK(rejects() == 0);
+    // a duplicate of the next key
+    loadKey(501, keys[499]);
+    CHECK(rejects() == 6);
+    loadKey(900, keys[499]);
+    CHECK(rejects() == 6);
+    // shuffled
+    std::mt19937_64 random(5);
+    std::shuffle(tids.begin(), tids.end(), random);
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        loadKey(tids[i], keys[i]);
+    }
+    CHECK(rejects() == 6);
+}
+
+// random insertIfAbsent, upsert, compareAndSwap and remove calls on few keys against a map of their TIDs
+void checkUpdates(ART_OLC::LeafMode leafMode) {
+    printf("updates, %s leaves\n", leafMode == ART_OLC::LeafMode::EmbeddedKey ? "embedded key" : "TID");
+    auto keys = generateStrings(500);
+    const uint64_t keyCount = strings.size();
+    std::map<std::string, TID> current;
+    ART_OLC::Tree tree(loadStringKey, leafMode);
+    auto t = tree.getThreadInfo();
+    std::mt19937_64 random(3);
+    for (unsigned i = 0; i < 200000; i++) {
+        uint64_t index = random() % keyCount;
+        const std::string &s = strings[index];
+        Key k;
+        setKey(k, s);
+        TID tid = index + 1 + keyCount * (random() % 8);
+        auto it = current.find(s);
+        TID before = it == current.end() ? 0 : it->second;
+        switch (random() % 5) {
+            case 0:
+                CHECK(tree.insertIfAbsent(k, tid, t) == before);
+                if (before == 0) {
+                    current[s] = tid;
+                }
+                break;
+            case 1:
+                CHECK(tree.upsert(k, tid, t) == before);
+                current[s] = tid;
+                break;
+            case 2: {
+                // the current TID, another one, or absent
+                TID expected = random() % 2 ? before : random() % 2 ? 0 : tid;
+                bool swapped = expected == before;
+                CHECK(tree.compareAndSwap(k, expected, tid, t) == swapped);
+                CHECK(expected == before);
+                if (swapped) {
+                    current[s] = tid;
+                }
+                break;
+            }
+            case 3:
+                // removes only the given TID
+                tree.remove(k, tid, t);
+                if (before == tid) {
+                    current.erase(s);
+                }
+                break;
+            case 4:
+                CHECK(tree.lookup(k, t) == before);
+                break;
+        }
+    }
+    CHECK(tree.size() == current.size());
+    checkContent(current, [&](const Key &k) { return tree.lookup(k, t); },
+                 [&](const Key &start, const Key &end, Key &continueKey, TID result[], std::size_t resultLen,
+                     std::size_t &found) {
+                     return tree.lookupRangeReverse(start, end, continueKey, result, resultLen, found, t);
+                 });
+}
+
+// lookupBatch finds what lookup finds, for batches shorter than, as long as and longer than the 16 descents it keeps
+// in flight, with keys that are missing or repeated
+void checkLookupBatch(ART_OLC::LeafMode leafMode) {
+    printf("olc lookupBatch, %s leaves\n", leafMode == ART_OLC::LeafMode::EmbeddedKey ? "embedded key" : "TID");
+    auto keys = generateStrings(3000);
+    ART_OLC::Tree tree(loadStringKey, leafMode);
+    auto t = tree.getThreadInfo();
+    std::map<std::string, TID> inserted;
+    // every fifth key is missing, it shares prefixes with the others
+    for (const auto &key : keys) {
+        if (key.second % 5 != 0) {
+            Key k;
+            setKey(k, key.first);
+            tree.insert(k, key.second, t);
+            inserted.insert(key);
+        }
+    }
+    std::mt19937_64 random(3);
+    std::vector<std::string> queries;
+    for (unsigned i = 0; i < 1000; i++) {
+        queries.push_back(strings[random() % strings.size()]);
+    }
+    std::vector<std::string> repeated;
+    for (unsigned i = 0; i < 40; i++) {
+        repeated.push_back(i % 3 == 0 ? terminated("ab") : strings[i % 2]);
+    }
+    auto check = [&](const std::vector<std::string> &batch) {
+        std::vector<Key> batchKeys(batch.size());
+        for (std::size_t i = 0; i < batch.size(); i++) {
+            setKey(batchKeys[i], batch[i]);
+        }
+        // one more result that must stay untouched
+        std::vector<TID> results(batch.size() + 1, 12345);
+        tree.lookupBatch(batchKeys.data(), batch.size(), results.data(), t);
+        for (std::size_t i = 0; i < batch.size(); i++) {
+            auto it = inserted.find(batch[i]);
+            CHECK(results[i] == (it != inserted.end() ? it->second : 0));
+            CHECK(results[i] == tree.lookup(batchKeys[i], t));
+        }
+        CHECK(results[batch.size()] == 12345);
+    };
+    for (std::size_t n : {0, 1, 15, 16, 17, 33, 1000}) {
+        check(std::vector<std::string>(queries.begin(), queries.begin() + n));
+    }
+    check(repeated);
+}
+
+// lookups in an EmbeddedKey tree compare the keys of the leaves and never load one
+void checkEmbeddedKeyLoads() {
+    printf("embedded key loads\n");
+    auto keys = generateStrings(5000);
+    ART_OLC::Tree tree(loadStringKey, ART_OLC::LeafMode::EmbeddedKey);
+    auto t = tree.getThreadInfo();
+    for (const auto &key : keys) {
+        Key k;
+        setKey(k, key.first);
+        tree.insert(k, key.second, t);
+    }
+    loadKeyCalls = 0;
+    bool found = true;
+    for (const auto &key : keys) {
+        Key k;
+        setKey(k, key.first);
+        found = found && tree.lookup(k, t) == key.second;
+        setKey(k, key.first.substr(0, key.first.size() - 1) + "x");
+        found = found && tree.lookup(k, t) == 0;
+    }
+    CHECK(found);
+    CHECK(loadKeyCalls == 0);
+}
+
+// size() after inserts and removes of several threads, after updates that don't add keys and after a bulk load
+template<typename TREE>
+void checkSize(const char *name) {
+    printf("%s size\n", name);
+    const unsigned threads = 4;
+    const uint64_t perThread = 10000;
+    {
+        TREE tree(loadKey);
+        std::vector<std::thread> workers;
+        for (unsigned w = 0; w < threads; w++) {
+            workers.emplace_back([&, w]() {
+                auto t = tree.getThreadInfo();
+                for (uint64_t i = 1; i <= perThread; i++) {
+                    TID tid = w * perThread + i;
+                    tree.insert(keyOf(tid), tid, t);
+                }
+                // every other key again
+                for (uint64_t i = 1; i <= perThread; i += 2) {
+                    TID tid = w * perThread + i;
+                    tree.remove(keyOf(tid), tid, t);
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        CHECK(tree.size() == threads * perThread / 2);
+        auto t = tree.getThreadInfo();
+        // absent keys
+        tree.remove(keyOf(1), 1, t);
+        tree.remove(keyOf(threads * perThread + 1), threads * perThread + 1, t);
+        CHECK(tree.size() == threads * perThread / 2);
+    }
+    {
+        std::vector<Key> keys;
+        std::vector<TID> tids;
+        sortedKeys(5000, keys, tids);
+        for (unsigned threadCount : {1u, 4u}) {
+            TREE tree(loadKey, keys.data(), tids.data(), keys.size(), threadCount);
+            CHECK(tree.size() == 5000);
+            auto t = tree.getThreadInfo();
+            for (uint64_t i = 1; i <= 1000; i++) {
+                tree.remove(keyOf(i), i, t);
+            }
+            CHECK(tree.size() == 4000);
+            tree.insert(keyOf(1), 1, t);
+            CHECK(tree.size() == 4001);
+            // the moved tree keeps the bulk-loaded keys and the counts of the threads
+            TREE moved(std::move(tree));
+            CHECK(moved.size() == 4001);
+            auto movedThreadInfo = moved.getThreadInfo();
+            moved.remove(keyOf(1001), 1001, movedThreadInfo);
+            CHECK(moved.size() == 4000);
+            CHECK(moved.lookup(keyOf(5000), movedThreadInfo) == 5000);
+        }
+    }
+}
+
+// Inserts and removes of several threads with ReclaimMode::Background. Once the threads are done, the reclaimer
+// thread frees all the nodes they removed, also the ones they did not hand off before they detached.
+template<typename TREE>
+void checkBackground(TREE &tree, const char *name) {
+    printf("%s background reclamation\n", name);
+    const unsigned threads = 4;
+    const uint64_t perThread = 20000;
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < threads; w++) {
+        workers.emplace_back([&, w]() {
+            auto t = tree.getThreadInfo();
+            for (uint64_t i = 1; i <= perThread; i++) {
+                TID tid = w * perThread + i;
+                tree.insert(keyOf(tid), tid, t);
+            }
+            for (uint64_t i = 1; i <= perThread; i++) {
+                TID tid = w * perThread + i;
+                if (tid % 3 != 0) {
+                    tree.remove(keyOf(tid), tid, t);
+                }
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    std::map<uint64_t, TID> expected;
+    for (uint64_t tid = 3; tid <= threads * perThread; tid += 3) {
+        expected[tid] = tid;
+    }
+    {
+        auto t = tree.getThreadInfo();
+        for (uint64_t tid = 1; tid <= threads * perThread; tid++) {
+            TID found = tree.lookup(keyOf(tid), t);
+            CHECK(found == (expected.count(tid) != 0 ? tid : 0));
+        }
+    }
+    CHECK(tree.size() == expected.size());
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (tree.getEpocheStats().pendingBytes != 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(tree.getEpocheStats().pendingBytes == 0);
+}
+
+// Lookups while other threads remove every even key, with ReclaimScheme::QuiescentState. The readers don't store
+// their epoche, only quiescent() between their lookups keeps the removed nodes alive while they may read them.
+template<typename TREE>
+void checkQuiescentState(TREE &tree, const char *name) {
+    printf("%s quiescent state\n", name);
+    const uint64_t n = 40000;
+    const unsigned removers = 2, readers = 2;
+    {
+        auto t = tree.getThreadInfo();
+        for (uint64_t i = 1; i <= n; i++) {
+            tree.insert(keyOf(i), i, t);
+        }
+    }
+    std::atomic<bool> removing{true};
+    std::atomic<uint64_t> wrong{0};
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < readers; w++) {
+        workers.emplace_back([&, w]() {
+            auto t = tree.getThreadInfo();
+            std::mt19937_64 random(w);
+            do {
+                for (unsigned i = 0; i < 1000; i++) {
+                    TID tid = 1 + random() % n;
+                    TID found = tree.lookup(keyOf(tid), t);
+                    if (found != tid && (tid % 2 == 1 || found != 0)) {
+                        wrong++;
+                    }
+                    tree.quiescent(t);
+                }
+            } while (removing);
+        });
+    }
+    std::vector<std::thread> removerThreads;
+    for (unsigned w = 0; w < removers; w++) {
+        removerThreads.emplace_back([&, w]() {
+            auto t = tree.getThreadInfo();
+            for (uint64_t i = 2 + 2 * w; i <= n; i += 2 * removers) {
+                tree.remove(keyOf(i), i, t);
+                tree.quiescent(t);
+            }
+        });
+    }
+    for (auto &remover : removerThreads) {
+        remover.join();
+    }
+    removing = false;
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    CHECK(wrong == 0);
+    std::map<uint64_t, TID> expected;
+    for (uint64_t i = 1; i <= n; i += 2) {
+        expected[i] = i;
+    }
+    auto t = tree.getThreadInfo();
+    for (uint64_t i = 1; i <= n; i++) {
+        TID found = tree.lookup(keyOf(i), t);
+        CHECK(found == (expected.count(i) != 0 ? i : 0));
+    }
+    CHECK(tree.size() == expected.size());
+}
+
+// Scans of the OLC tree that re-pin after every key while another thread removes most keys. The removes free the
+// nodes of whole subtrees and shrink the node below the root, which is on the path of every scan. A retired budget
+// throttles the remover. The scans must return the kept keys in order, and may skip the removed ones.
+void checkScanRepin() {
+    printf("olc scan re-pinning\n");
+    ART_OLC::Tree tree(loadKey, ART_OLC::LeafMode::EmbeddedKey);
+    tree.setScanRepinInterval(1);
+    tree.setRetiredBudget(1 << 16);
+    // The four keys of a group differ in the last byte only, 256 groups share the byte before. The first key of the
+    // groups in every fourth block of 256 is kept.
+    const uint64_t groups = 10000;
+    auto isKept = [](TID tid) {
+        return tid % 256 == 0 && (tid >> 16) % 4 == 0;
+    };
+    std::map<uint64_t, TID> kept;
+    {
+        auto t = tree.getThreadInfo();
+        for (uint64_t group = 1; group <= groups; group++) {
+            for (uint64_t tid = group << 8; tid < (group << 8) + 4; tid++) {
+                tree.insert(keyOf(tid), tid, t);
+                if (isKept(tid)) {
+                    kept[tid] = tid;
+                }
+            }
+        }
+    }
+    auto scan = [&](ART::ThreadInfo &t, bool reverse) {
+        std::vector<TID> tids, page(1000);
+        Key start = keyOf(1), end, continueKey;
+        end.setKeyLen(0);
+        while (true) {
+            std::size_t found = 0;
+            bool more = reverse ? tree.lookupRangeReverse(start, end, continueKey, page.data(), page.size(), found, t)
+                                : tree.lookupRange(start, end, continueKey, page.data(), page.size(), found, t);
+            tids.insert(tids.end(), page.begin(), page.begin() + found);
+            if (!more) {
+                return tids;
+            }
+            (reverse ? end : start).set(reinterpret_cast<const char *>(&continueKey[0]), continueKey.getKeyLen());
+        }
+    };
+    auto consistent = [&](const std::vector<TID> &tids, bool reverse) {
+        std::size_t keptFound = 0;
+        for (std::size_t i = 0; i < tids.size(); i++) {
+            if (tids[i] % 256 > 3 || (i > 0 && (reverse ? tids[i] >= tids[i - 1] : tids[i] <= tids[i - 1]))) {
+                return false;
+            }
+            keptFound += kept.count(tids[i]);
+        }
+        return keptFound == kept.size();
+    };
+    std::atomic<bool> scanning{false}, removing{true};
+    std::atomic<uint64_t> wrong{0};
+    // a Cursor that lets the remover run every few keys, so that it frees nodes that were on the path of the cursor
+    auto cursorScan = [&](ART::ThreadInfo &t, bool reverse) {
+        std::vector<TID> tids;
+        ART_OLC::Tree::Cursor cursor(tree, t, reverse);
+        Key k;
+        loadKey(1, k);
+        if (reverse) {
+            // from the last key on
+            cursor.setStart(k);
+            k.setKeyLen(0);
+        }
+        cursor.seek(k, !reverse);
+        TID tid;
+        while (cursor.next(tid)) {
+            tids.push_back(tid);
+            if (tids.size() % 64 == 0) {
+                std::this_thread::yield();
+            }
+        }
+        return tids;
+    };
+    std::thread scanner([&]() {
+        auto t = tree.getThreadInfo();
+        scanning = true;
+        do {
+            for (bool reverse : {false, true}) {
+                if (!consistent(cursorScan(t, reverse), reverse) || !consistent(scan(t, reverse), reverse)) {
+                    wrong++;
+                }
+            }
+        } while (removing);
+    });
+    while (!scanning) {
+        std::this_thread::yield();
+    }
+    {
+        auto t = tree.getThreadInfo();
+        for (uint64_t group = 1; group <= groups; group++) {
+            if (group % 16 == 0) {
+                std::this_thread::yield();
+            }
+            for (uint64_t tid = group << 8; tid < (group << 8) + 4; tid++) {
+                if (!isKept(tid)) {
+                    tree.remove(keyOf(tid), tid, t);
+                }
+            }
+        }
+    }
+    removing = false;
+    scanner.join();
+    CHECK(wrong == 0);
+    auto t = tree.getThreadInfo();
+    std::vector<TID> expected;
+    for (const auto &key : kept) {
+        expected.push_back(key.second);
+    }
+    CHECK(scan(t, false) == expected);
+    std::reverse(expected.begin(), expected.end());
+    CHECK(scan(t, true) == expected);
+}
+
+// getChildren, getNextChildren and getPrevChildren of sparse and dense N48 and N256 under every NodeScanIsa the CPU
+// supports, against the keyslices the nodes were filled with
+void checkNodeScan() {
+    printf("node scan\n");
+    using namespace ART_OLC;
+    std::vector<std::vector<uint8_t>> fills = {{0, 63, 64, 127, 128, 200, 255}, {}, {}};
+    for (unsigned k = 0; k < 48; k++) {
+        fills[1].push_back(static_cast<uint8_t>(k * 5 + 10));
+    }
+    for (unsigned k = 0; k < 256; k++) {
+        if (k != 64 && k != 191) {
+            fills[2].push_back(static_cast<uint8_t>(k));
+        }
+    }
+    const std::pair<uint8_t, uint8_t> ranges[] = {{0, 255}, {0, 63}, {63, 64}, {64, 127}, {1, 254}, {100, 100},
+                                                 {65, 190}, {128, 255}, {200, 10}};
+    ART::NodeScanIsa isa = ART::NodeScan::getIsa();
+    for (const auto &fill : fills) {
+        std::vector<N *> nodes;
+        if (fill.size() <= 48) {
+            nodes.push_back(new N48(nullptr, 0));
+        }
+        nodes.push_back(new N256(nullptr, 0));
+        for (N *node : nodes) {
+            for (uint8_t k : fill) {
+                if (node->getType() == NTypes::N48) {
+                    static_cast<N48 *>(node)->insert(k, N::setLeaf(k + 1));
+                } else {
+                    static_cast<N256 *>(node)->insert(k, N::setLeaf(k + 1));
+                }
+            }
+        }
+        for (auto scanIsa : {ART::NodeScanIsa::Scalar, ART::NodeScanIsa::AVX2, ART::NodeScanIsa::AVX512}) {
+            if (ART::NodeScan::setIsa(scanIsa) != scanIsa) {
+                continue;
+            }
+            for (N *node : nodes) {
+                for (const auto &range : ranges) {
+                    std::vector<uint8_t> expected;
+                    for (uint8_t k : fill) {
+                        if (k >= range.first && k <= range.second) {
+                            expected.push_back(k);
+                        }
+                    }
+                    std::tuple<uint8_t, N *> children[256];
+                    uint32_t childrenCount = 0;
+                    N::getChildren(node, range.first, range.second, children, childrenCount);
+                    std::vector<uint8_t> found;
+                    for (uint32_t i = 0; i < childrenCount; i++) {
+                        found.push_back(std::get<0>(children[i]));
+                        CHECK(N::getLeaf(std::get<1>(children[i])) == std::get<0>(children[i]) + 1u);
+                    }
+                    CHECK(found == expected);
+
+                    uint8_t keys[256];
+                    N *next[256];
+                    expected.clear();
+                    for (uint8_t k : fill) {
+                        if (k >= range.first) {
+                            expected.push_back(k);
+                        }
+                    }
+                    uint32_t count = N::getNextChildren(node, range.first, keys, next, 256);
+                    CHECK(std::vector<uint8_t>(keys, keys + count) == expected);
+                    expected.clear();
+                    for (uint8_t k : fill) {
+                        if (k <= range.first) {
+                            expected.insert(expected.begin(), k);
+                        }
+                    }
+                    count = N::getPrevChildren(node, range.first, keys, next, 256);
+                    CHECK(std::vector<uint8_t>(keys, keys + count) == expected);
+                }
+            }
+        }
+        for (N *node : nodes) {
+            N::deleteNode(node);
+        }
+    }
+    ART::NodeScan::setIsa(isa);
+}
+
+// the update functions count the keys they add, not the ones they change
+void checkOlcUpdateSize() {
+    printf("olc update size\n");
+    ART_OLC::Tree tree(loadKey);
+    auto t = tree.getThreadInfo();
+    tree.insert(keyOf(1), 1, t);
+    tree.upsert(keyOf(1), 1, t);
+    tree.insertIfAbsent(keyOf(1), 1, t);
+    TID expected = 1;
+    tree.compareAndSwap(keyOf(1), expected, 1, t);
+    CHECK(tree.size() == 1);
+    tree.upsert(keyOf(2), 2, t);
+    tree.insertIfAbsent(keyOf(3), 3, t);
+    expected = 0;
+    tree.compareAndSwap(keyOf(4), expected, 4, t);
+    CHECK(tree.size() == 4);
+}
+
+int main() {
+    for (auto leafMode : {ART_OLC::LeafMode::TidOnly, ART_OLC::LeafMode::EmbeddedKey}) {
+        checkRanges(leafMode);
+        checkBulkLoad(leafMode);
+        checkUpdates(leafMode);
+        checkLookupBatch(leafMode);
+    }
+    checkBulkLoadValidation();
+    checkEmbeddedKeyLoads();
+    checkSize<ART_OLC::Tree>("olc");
+    checkSize<ART_ROWEX::Tree>("rowex");
+    checkOlcUpdateSize();
+    checkNodeScan();
+    checkScanRepin();
+    {
+        ART_OLC::Tree tree(loadKey, ART_OLC::LeafMode::TidOnly, ART::ReclaimMode::Background);
+        checkBackground(tree, "olc");
+    }
+    {
+        ART_ROWEX::Tree tree(loadKey, ART::ReclaimMode::Background);
+        checkBackground(tree, "rowex");
+    }
+    {
+        // the settings move with the tree
+        ART_OLC::Tree tree(loadKey, ART_OLC::LeafMode::TidOnly, ART::ReclaimMode::Inline, ART::ReclaimScheme::QuiescentState);
+        ART_OLC::Tree moved(std::move(tree));
+        checkQuiescentState(moved, "olc");
+    }
+    {
+        ART_ROWEX::Tree tree(loadKey, ART::ReclaimMode::Inline, ART::ReclaimScheme::QuiescentState);
+        checkQuiescentState(tree, "rowex");
+    }
+    if (failures != 0) {
+        printf("%u checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}